@@ -69,7 +69,7 @@ function zcashd_valgrind_stop {
 case "$1" in
     *)
         case "$2" in
-            verifyjoinsplit)
+            verifyjoinsplit|verifyblock)
                 zcashd_start
                 RAWJOINSPLIT=$(zcash_rpc zcsamplejoinsplit)
                 zcashd_stop
@@ -92,6 +92,9 @@ case "$1" in
             verifyjoinsplit)
                 zcash_rpc zcbenchmark verifyjoinsplit 1000 "\"$RAWJOINSPLIT\""
                 ;;
+            verifyblock)
+                zcash_rpc zcbenchmark verifyblock 10 "\"$RAWJOINSPLIT\"" "${@:3}"
+                ;;
             solveequihash)
                 zcash_rpc_slow zcbenchmark solveequihash 50 "${@:3}"
                 ;;
@@ -104,6 +107,9 @@ case "$1" in
             trydecryptnotes)
                 zcash_rpc zcbenchmark trydecryptnotes 1000 "${@:3}"
                 ;;
+            trydecryptblocknotes)
+                zcash_rpc zcbenchmark trydecryptblocknotes 100 "${@:3}"
+                ;;
             incnotewitnesses)
                 zcash_rpc zcbenchmark incnotewitnesses 100 "${@:3}"
                 ;;
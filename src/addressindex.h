@@ -0,0 +1,204 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ADDRESSINDEX_H
+#define BITCOIN_ADDRESSINDEX_H
+
+#include "amount.h"
+#include "script/script.h"
+#include "serialize.h"
+#include "uint256.h"
+
+/** Kinds of transparent address covered by the address index */
+enum AddressIndexType {
+    ADDRESSINDEX_NONE = 0,
+    ADDRESSINDEX_PUBKEYHASH = 1,
+    ADDRESSINDEX_SCRIPTHASH = 2,
+};
+
+/**
+ * Address index entry key: one credit or debit of an address.
+ *
+ * Height and position in the block are serialized big-endian, so that the
+ * entries of an address iterate in chain order.
+ */
+struct CAddressIndexKey {
+    unsigned int type;
+    uint160 hashBytes;
+    int blockHeight;
+    unsigned int txindex;
+    uint256 txhash;
+    unsigned int index;
+    bool spending;
+
+    CAddressIndexKey(unsigned int addressType, const uint160& addressHash, int height, unsigned int blockindex,
+                     const uint256& txid, unsigned int indexValue, bool isSpending) :
+        type(addressType), hashBytes(addressHash), blockHeight(height), txindex(blockindex),
+        txhash(txid), index(indexValue), spending(isSpending) {}
+
+    CAddressIndexKey() { SetNull(); }
+
+    void SetNull()
+    {
+        type = ADDRESSINDEX_NONE;
+        hashBytes.SetNull();
+        blockHeight = 0;
+        txindex = 0;
+        txhash.SetNull();
+        index = 0;
+        spending = false;
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return 66;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s, nType, nVersion);
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        txhash.Serialize(s, nType, nVersion);
+        ser_writedata32(s, index);
+        ser_writedata8(s, spending);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s, nType, nVersion);
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        txhash.Unserialize(s, nType, nVersion);
+        index = ser_readdata32(s);
+        spending = ser_readdata8(s);
+    }
+};
+
+/** Prefix of CAddressIndexKey selecting all entries of an address */
+struct CAddressIndexIteratorKey {
+    unsigned int type;
+    uint160 hashBytes;
+
+    CAddressIndexIteratorKey(unsigned int addressType, const uint160& addressHash) :
+        type(addressType), hashBytes(addressHash) {}
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return 21;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s, nType, nVersion);
+    }
+};
+
+/** Prefix of CAddressIndexKey selecting the entries of an address from a height on */
+struct CAddressIndexIteratorHeightKey {
+    unsigned int type;
+    uint160 hashBytes;
+    int blockHeight;
+
+    CAddressIndexIteratorHeightKey(unsigned int addressType, const uint160& addressHash, int height) :
+        type(addressType), hashBytes(addressHash), blockHeight(height) {}
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return 25;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s, nType, nVersion);
+        ser_writedata32be(s, blockHeight);
+    }
+};
+
+/** Address unspent index key: one unspent output paying to an address */
+struct CAddressUnspentKey {
+    unsigned int type;
+    uint160 hashBytes;
+    uint256 txhash;
+    unsigned int index;
+
+    CAddressUnspentKey(unsigned int addressType, const uint160& addressHash, const uint256& txid, unsigned int indexValue) :
+        type(addressType), hashBytes(addressHash), txhash(txid), index(indexValue) {}
+
+    CAddressUnspentKey() { SetNull(); }
+
+    void SetNull()
+    {
+        type = ADDRESSINDEX_NONE;
+        hashBytes.SetNull();
+        txhash.SetNull();
+        index = 0;
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return 57;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s, nType, nVersion);
+        txhash.Serialize(s, nType, nVersion);
+        ser_writedata32(s, index);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s, nType, nVersion);
+        txhash.Unserialize(s, nType, nVersion);
+        index = ser_readdata32(s);
+    }
+};
+
+/** Address unspent index value; a null value erases the entry */
+struct CAddressUnspentValue {
+    CAmount satoshis;
+    CScript script;
+    int blockHeight;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(satoshis);
+        READWRITE(script);
+        READWRITE(blockHeight);
+    }
+
+    CAddressUnspentValue(CAmount sats, const CScript& scriptPubKey, int height) :
+        satoshis(sats), script(scriptPubKey), blockHeight(height) {}
+
+    CAddressUnspentValue() { SetNull(); }
+
+    void SetNull()
+    {
+        satoshis = -1;
+        script.clear();
+        blockHeight = 0;
+    }
+
+    bool IsNull() const
+    {
+        return satoshis == -1;
+    }
+};
+
+#endif // BITCOIN_ADDRESSINDEX_H
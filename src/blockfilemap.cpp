@@ -0,0 +1,113 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+
+#include "consensus/consensus.h"
+#include "crypto/common.h"
+#include "main.h"
+#include "util.h"
+
+#include <errno.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/** A block file mapped read-only into memory, unmapped with the last reference to it */
+class CBlockFileMap::CMappedFile
+{
+public:
+    const char* data;
+    size_t size;
+
+    CMappedFile(const char* dataIn, size_t sizeIn) : data(dataIn), size(sizeIn) {}
+
+    ~CMappedFile()
+    {
+#ifndef WIN32
+        munmap((void*)data, size);
+#endif
+    }
+};
+
+std::shared_ptr<const CBlockFileMap::CMappedFile> CBlockFileMap::GetFile(int nFile, bool fRemap)
+{
+    LOCK(cs);
+    std::map<int, CEntry>::iterator it = mapFiles.find(nFile);
+    if (it != mapFiles.end() && !fRemap) {
+        it->second.nLastUsed = ++nUseCounter;
+        return it->second.file;
+    }
+
+#ifdef WIN32
+    return std::shared_ptr<const CMappedFile>();
+#else
+    boost::filesystem::path path = GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk");
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return std::shared_ptr<const CMappedFile>();
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 ||
+        (it != mapFiles.end() && (size_t)st.st_size == it->second.file->size)) {
+        // Nothing to map, or nothing more than already mapped
+        close(fd);
+        return it != mapFiles.end() ? it->second.file : std::shared_ptr<const CMappedFile>();
+    }
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        LogPrintf("%s: cannot map %s: %s\n", __func__, path.string(), strerror(errno));
+        return std::shared_ptr<const CMappedFile>();
+    }
+    std::shared_ptr<const CMappedFile> file = std::make_shared<CMappedFile>((const char*)data, (size_t)st.st_size);
+
+    if (it == mapFiles.end() && mapFiles.size() >= MAX_MAPPED_FILES) {
+        std::map<int, CEntry>::iterator itOldest = mapFiles.begin();
+        for (std::map<int, CEntry>::iterator itEntry = mapFiles.begin(); itEntry != mapFiles.end(); ++itEntry) {
+            if (itEntry->second.nLastUsed < itOldest->second.nLastUsed)
+                itOldest = itEntry;
+        }
+        mapFiles.erase(itOldest);
+    }
+    CEntry& entry = mapFiles[nFile];
+    entry.file = file;
+    entry.nLastUsed = ++nUseCounter;
+    return file;
+#endif
+}
+
+bool CBlockFileMap::GetBlock(const CDiskBlockPos& pos, CRawBlock& raw)
+{
+    // Mapping whole files takes the address space of a 64-bit process
+    if (sizeof(void*) < 8 || pos.IsNull() || pos.nPos < 4)
+        return false;
+
+    // Map again at most once, if the file has grown past the mapping
+    for (int nTry = 0; nTry < 2; nTry++) {
+        std::shared_ptr<const CMappedFile> file = GetFile(pos.nFile, nTry > 0);
+        if (!file)
+            return false;
+        if (pos.nPos > file->size)
+            continue;
+        uint32_t nSize = ReadLE32((const unsigned char*)file->data + pos.nPos - 4);
+        if (nSize > MAX_BLOCK_SIZE)
+            return false;
+        if (pos.nPos + nSize > file->size)
+            continue;
+        raw.Set(file, file->data + pos.nPos, nSize);
+        return true;
+    }
+    return false;
+}
+
+void CBlockFileMap::Release(int nFile)
+{
+    LOCK(cs);
+    mapFiles.erase(nFile);
+}
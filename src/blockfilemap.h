@@ -0,0 +1,103 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEMAP_H
+#define BITCOIN_BLOCKFILEMAP_H
+
+#include "chain.h"
+#include "streams.h"
+#include "sync.h"
+
+#include <map>
+#include <memory>
+
+/**
+ * The serialized bytes of a block as stored in its block file, which are
+ * also its network serialization. They stay valid as long as this object
+ * (or a copy) lives, whether they are in a mapped block file or in a buffer
+ * of their own.
+ */
+class CRawBlock
+{
+private:
+    std::shared_ptr<const void> owner;
+    const char* pbegin;
+    const char* pend;
+
+public:
+    CRawBlock() : pbegin(NULL), pend(NULL) {}
+
+    void Set(const std::shared_ptr<const void>& ownerIn, const char* pbeginIn, size_t nSize)
+    {
+        owner = ownerIn;
+        pbegin = pbeginIn;
+        pend = pbeginIn + nSize;
+    }
+
+    const char* begin() const { return pbegin; }
+    const char* end() const { return pend; }
+    size_t size() const { return pend - pbegin; }
+    bool empty() const { return pbegin == pend; }
+
+    //! A stream deserializing the block straight from these bytes
+    CByteReader GetReader(int nType, int nVersion) const { return CByteReader(pbegin, pend, nType, nVersion); }
+
+    unsigned int GetSerializeSize(int, int=0) const
+    {
+        return size();
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int, int=0) const
+    {
+        s.write(pbegin, size());
+    }
+};
+
+/**
+ * Read-only memory mappings of the block files, so that blocks can be
+ * handed out as they are on disk, without a read into a buffer of their
+ * own, nor a round trip through CBlock for callers wanting the bytes.
+ *
+ * A file is mapped whole on first use and mapped again if a block beyond
+ * the end of the mapping is asked for, as files grow while blocks are
+ * appended. At most MAX_MAPPED_FILES are kept, the least recently used are
+ * dropped; a mapping lives on while a CRawBlock into it does. Mapping is
+ * only done on 64-bit POSIX systems; elsewhere GetBlock always fails and
+ * callers read the file instead.
+ */
+class CBlockFileMap
+{
+public:
+    static const size_t MAX_MAPPED_FILES = 64;
+
+    class CMappedFile;
+
+private:
+    struct CEntry
+    {
+        std::shared_ptr<const CMappedFile> file;
+        uint64_t nLastUsed;
+    };
+
+    CCriticalSection cs;
+    std::map<int, CEntry> mapFiles;
+    uint64_t nUseCounter;
+
+    std::shared_ptr<const CMappedFile> GetFile(int nFile, bool fRemap);
+
+public:
+    CBlockFileMap() : nUseCounter(0) {}
+
+    /**
+     * Point raw at the block stored at pos (just after its size prefix).
+     * Returns false if the file cannot be mapped or holds no block there.
+     */
+    bool GetBlock(const CDiskBlockPos& pos, CRawBlock& raw);
+
+    //! Drop the mapping of a file, such as one about to be deleted
+    void Release(int nFile);
+};
+
+#endif // BITCOIN_BLOCKFILEMAP_H
@@ -174,11 +174,16 @@ public:
     unsigned int nTime;
     unsigned int nBits;
     uint256 nNonce;
+    //! Equihash solution. Dropped from memory once the entry is in the
+    //! block tree database, use GetSolution() to read it.
     std::vector<unsigned char> nSolution;
 
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     uint32_t nSequenceId;
 
+    //! (memory only) Whether nSolution has been trimmed and must be read from the block tree database.
+    bool fSolutionTrimmed;
+
     void SetNull()
     {
         phashBlock = NULL;
@@ -211,6 +216,7 @@ public:
         nBits          = 0;
         nNonce         = uint256();
         nSolution.clear();
+        fSolutionTrimmed = false;
     }
 
     CBlockIndex()
@@ -280,10 +286,22 @@ public:
         block.nTime          = nTime;
         block.nBits          = nBits;
         block.nNonce         = nNonce;
-        block.nSolution      = nSolution;
+        block.nSolution      = GetSolution();
         return block;
     }
 
+    //! Equihash solution of this block, read back from the block tree
+    //! database if it is no longer held in memory.
+    std::vector<unsigned char> GetSolution() const;
+
+    //! Release the in-memory copy of the Equihash solution. Only valid once
+    //! this entry has been written to the block tree database.
+    void TrimSolution()
+    {
+        std::vector<unsigned char>().swap(nSolution);
+        fSolutionTrimmed = true;
+    }
+
     uint256 GetBlockHash() const
     {
         return *phashBlock;
@@ -408,6 +426,12 @@ public:
 
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        // An entry being rewritten may already have had its solution
+        // trimmed; fetch it from the previous version on disk.
+        if (fSolutionTrimmed) {
+            nSolution = pindex->GetSolution();
+            fSolutionTrimmed = false;
+        }
     }
 
     ADD_SERIALIZE_METHODS;
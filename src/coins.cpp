@@ -9,6 +9,7 @@
 #include "version.h"
 #include "policy/fees.h"
 
+#include <algorithm>
 #include <assert.h>
 
 /**
@@ -39,6 +40,8 @@ bool CCoins::Spend(uint32_t nPos)
     if (nPos >= vout.size() || vout[nPos].IsNull())
         return false;
     vout[nPos].SetNull();
+    // SetNull keeps the capacity of the script; spent outputs should not
+    CScript().swap(vout[nPos].scriptPubKey);
     Cleanup();
     return true;
 }
@@ -107,6 +110,40 @@ CCoinsMap::const_iterator CCoinsViewCache::FetchCoins(const uint256 &txid) const
 }
 
 
+void CCoinsViewCache::FilterCached(std::vector<uint256> &txids, std::vector<uint256> &nullifiers, std::vector<uint256> &anchors) const {
+    txids.erase(std::remove_if(txids.begin(), txids.end(),
+                               [this](const uint256 &txid) { return cacheCoins.count(txid) > 0; }), txids.end());
+    nullifiers.erase(std::remove_if(nullifiers.begin(), nullifiers.end(),
+                                    [this](const uint256 &nf) { return cacheNullifiers.count(nf) > 0; }), nullifiers.end());
+    anchors.erase(std::remove_if(anchors.begin(), anchors.end(),
+                                 [this](const uint256 &rt) { return cacheAnchors.count(rt) > 0; }), anchors.end());
+}
+
+void CCoinsViewCache::AddFetchedCoins(const uint256 &txid, CCoins &coins) {
+    std::pair<CCoinsMap::iterator, bool> ret = cacheCoins.insert(std::make_pair(txid, CCoinsCacheEntry()));
+    if (!ret.second)
+        return;
+    coins.swap(ret.first->second.coins);
+    if (ret.first->second.coins.IsPruned())
+        ret.first->second.flags = CCoinsCacheEntry::FRESH;
+    cachedCoinsUsage += ret.first->second.coins.DynamicMemoryUsage();
+}
+
+void CCoinsViewCache::AddFetchedNullifier(const uint256 &nullifier, bool spent) {
+    CNullifiersCacheEntry entry;
+    entry.entered = spent;
+    cacheNullifiers.insert(std::make_pair(nullifier, entry));
+}
+
+void CCoinsViewCache::AddFetchedAnchor(const uint256 &rt, const ZCIncrementalMerkleTree &tree) {
+    std::pair<CAnchorsMap::iterator, bool> ret = cacheAnchors.insert(std::make_pair(rt, CAnchorsCacheEntry()));
+    if (!ret.second)
+        return;
+    ret.first->second.entered = true;
+    ret.first->second.tree = tree;
+    cachedCoinsUsage += ret.first->second.tree.DynamicMemoryUsage();
+}
+
 bool CCoinsViewCache::GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree) const {
     CAnchorsMap::const_iterator it = cacheAnchors.find(rt);
     if (it != cacheAnchors.end()) {
@@ -360,9 +397,10 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins,
 
 bool CCoinsViewCache::Flush() {
     bool fOk = base->BatchWrite(cacheCoins, hashBlock, hashAnchor, cacheAnchors, cacheNullifiers);
-    cacheCoins.clear();
+    // Swapping with new maps, unlike clear(), also releases their pools.
+    CCoinsMap().swap(cacheCoins);
     cacheAnchors.clear();
-    cacheNullifiers.clear();
+    CNullifiersMap().swap(cacheNullifiers);
     cachedCoinsUsage = 0;
     return fOk;
 }
@@ -120,8 +120,10 @@ public:
 
     void ClearUnspendable() {
         BOOST_FOREACH(CTxOut &txout, vout) {
-            if (txout.scriptPubKey.IsUnspendable())
+            if (txout.scriptPubKey.IsUnspendable()) {
                 txout.SetNull();
+                CScript().swap(txout.scriptPubKey);
+            }
         }
         Cleanup();
     }
@@ -321,9 +323,16 @@ struct CNullifiersCacheEntry
     CNullifiersCacheEntry() : entered(false), flags(0) {}
 };
 
-typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher> CCoinsMap;
+/**
+ * The coins and nullifiers maps allocate their nodes from a pool of their own
+ * (see CPoolAllocator), which is released when the map is destroyed or
+ * swapped with a new one, not on clear(). Anchors are few and large.
+ */
+typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher, std::equal_to<uint256>,
+                             CPoolAllocator<std::pair<const uint256, CCoinsCacheEntry> > > CCoinsMap;
 typedef boost::unordered_map<uint256, CAnchorsCacheEntry, CCoinsKeyHasher> CAnchorsMap;
-typedef boost::unordered_map<uint256, CNullifiersCacheEntry, CCoinsKeyHasher> CNullifiersMap;
+typedef boost::unordered_map<uint256, CNullifiersCacheEntry, CCoinsKeyHasher, std::equal_to<uint256>,
+                             CPoolAllocator<std::pair<const uint256, CNullifiersCacheEntry> > > CNullifiersMap;
 
 struct CCoinsStats
 {
@@ -489,6 +498,21 @@ public:
      */
     CCoinsModifier ModifyCoins(const uint256 &txid);
 
+    /**
+     * Remove the txids, nullifiers and anchors this cache already has entries
+     * for from the lists, leaving those that would be read from the base.
+     */
+    void FilterCached(std::vector<uint256> &txids, std::vector<uint256> &nullifiers, std::vector<uint256> &anchors) const;
+
+    /**
+     * Add entries read from the base view elsewhere, such as on the input
+     * prefetching threads, unless the cache has them already. They are added
+     * unmodified, as AccessCoins, GetNullifier and GetAnchorAt add them.
+     */
+    void AddFetchedCoins(const uint256 &txid, CCoins &coins);
+    void AddFetchedNullifier(const uint256 &nullifier, bool spent);
+    void AddFetchedAnchor(const uint256 &rt, const ZCIncrementalMerkleTree &tree);
+
     /**
      * Push the modifications applied to this cache to its base.
      * Failure to call this method before destruction will cause the changes to be forgotten.
@@ -46,6 +46,14 @@
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+// Sockets are waited on with epoll() and poll() rather than select(), so
+// they are not limited to FD_SETSIZE
+#define USE_EPOLL
+#include <poll.h>
+#include <sys/epoll.h>
+#endif
+
 #ifdef WIN32
 #define MSG_DONTWAIT        0
 #else
@@ -94,7 +102,7 @@ size_t strnlen( const char *start, size_t max_len);
 #endif // HAVE_DECL_STRNLEN
 
 bool static inline IsSelectableSocket(SOCKET s) {
-#ifdef WIN32
+#if defined(WIN32) || defined(USE_EPOLL)
     return true;
 #else
     return (s < FD_SETSIZE);
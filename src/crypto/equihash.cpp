@@ -721,7 +721,7 @@ invalidsolution:
 #endif // ENABLE_MINING
 
 template<unsigned int N, unsigned int K>
-bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln)
+bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln)
 {
     if (soln.size() != SolutionWidth) {
         LogPrint("pow", "Invalid solution length: %d (expected %d)\n",
@@ -729,43 +729,77 @@ bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, std::vector<
         return false;
     }
 
-    std::vector<FullStepRow<FinalFullWidth>> X;
-    X.reserve(1 << K);
+    // Everything below works in buffers sized by the parameter set, so that
+    // verification does not touch the heap.
+    const size_t nIndices = 1 << K;
+    const size_t bytePad = sizeof(eh_index) - ((CollisionBitLength+1)+7)/8;
+    unsigned char expanded[(1 << K)*sizeof(eh_index)];
+    ExpandArray(soln.data(), soln.size(), expanded, sizeof(expanded),
+                CollisionBitLength+1, bytePad);
+    eh_index indices[1 << K];
+    for (size_t i = 0; i < nIndices; i++) {
+        indices[i] = ArrayToEhIndex(expanded+(i*sizeof(eh_index)));
+    }
+
+    // Every pair of leaves is merged at some level of the tree, so checking
+    // them all once up front is the same as checking each merge.
+    eh_index sorted[1 << K];
+    std::copy(indices, indices+nIndices, sorted);
+    std::sort(sorted, sorted+nIndices);
+    if (std::adjacent_find(sorted, sorted+nIndices) != sorted+nIndices) {
+        LogPrint("pow", "Invalid solution: duplicate indices\n");
+        return false;
+    }
+
+    // Compute all the leaf hashes in one pass before walking the tree. Leaves
+    // sharing a BLAKE2b output (i/IndicesPerHashOutput) reuse it.
+    unsigned char rows[(1 << K)*HashLength];
     unsigned char tmpHash[HashOutput];
-    for (eh_index i : GetIndicesFromMinimal(soln, CollisionBitLength)) {
-        GenerateHash(base_state, i/IndicesPerHashOutput, tmpHash, HashOutput);
-        X.emplace_back(tmpHash+((i % IndicesPerHashOutput) * N/8),
-                       N/8, HashLength, CollisionBitLength, i);
+    eh_index lastGroup = 0;
+    bool fHaveGroup = false;
+    for (size_t i = 0; i < nIndices; i++) {
+        eh_index group = indices[i]/IndicesPerHashOutput;
+        if (!fHaveGroup || group != lastGroup) {
+            GenerateHash(base_state, group, tmpHash, HashOutput);
+            lastGroup = group;
+            fHaveGroup = true;
+        }
+        ExpandArray(tmpHash+((indices[i] % IndicesPerHashOutput) * N/8), N/8,
+                    rows+(i*HashLength), HashLength, CollisionBitLength);
     }
 
-    size_t hashLen = HashLength;
-    size_t lenIndices = sizeof(eh_index);
-    while (X.size() > 1) {
-        std::vector<FullStepRow<FinalFullWidth>> Xc;
-        for (int i = 0; i < X.size(); i += 2) {
-            if (!HasCollision(X[i], X[i+1], CollisionByteLength)) {
+    // Merge the rows pairwise in place. Row j of a level is the XOR of rows
+    // 2j and 2j+1 of the level below, and its leading index is that of its
+    // left subtree, because the right one must come after it.
+    size_t trim = 0;
+    for (size_t level = 0; level < K; level++) {
+        size_t nRows = nIndices >> level;
+        for (size_t j = 0; j < nRows; j += 2) {
+            const unsigned char* a = rows+(j*HashLength);
+            const unsigned char* b = rows+((j+1)*HashLength);
+            if (memcmp(a+trim, b+trim, CollisionByteLength) != 0) {
                 LogPrint("pow", "Invalid solution: invalid collision length between StepRows\n");
-                LogPrint("pow", "X[i]   = %s\n", X[i].GetHex(hashLen));
-                LogPrint("pow", "X[i+1] = %s\n", X[i+1].GetHex(hashLen));
+                LogPrint("pow", "X[i]   = %s\n", HexStr(a+trim, a+HashLength));
+                LogPrint("pow", "X[i+1] = %s\n", HexStr(b+trim, b+HashLength));
                 return false;
             }
-            if (X[i+1].IndicesBefore(X[i], hashLen, lenIndices)) {
+            if (indices[(j+1) << level] < indices[j << level]) {
                 LogPrint("pow", "Invalid solution: Index tree incorrectly ordered\n");
                 return false;
             }
-            if (!DistinctIndices(X[i], X[i+1], hashLen, lenIndices)) {
-                LogPrint("pow", "Invalid solution: duplicate indices\n");
-                return false;
+            unsigned char* out = rows+((j/2)*HashLength);
+            for (size_t x = trim+CollisionByteLength; x < HashLength; x++) {
+                out[x] = a[x] ^ b[x];
             }
-            Xc.emplace_back(X[i], X[i+1], hashLen, lenIndices, CollisionByteLength);
         }
-        X = Xc;
-        hashLen -= CollisionByteLength;
-        lenIndices *= 2;
+        trim += CollisionByteLength;
     }
 
-    assert(X.size() == 1);
-    return X[0].IsZero(hashLen);
+    for (size_t x = trim; x < HashLength; x++) {
+        if (rows[x] != 0)
+            return false;
+    }
+    return true;
 }
 
 // Explicit instantiations for Equihash<96,3>
@@ -778,7 +812,7 @@ template bool Equihash<96,3>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<96,3>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<96,3>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<200,9>
 template int Equihash<200,9>::InitialiseState(eh_HashState& base_state);
@@ -790,7 +824,7 @@ template bool Equihash<200,9>::OptimisedSolve(const eh_HashState& base_state,
                                               const std::function<bool(std::vector<unsigned char>)> validBlock,
                                               const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<200,9>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<200,9>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<96,5>
 template int Equihash<96,5>::InitialiseState(eh_HashState& base_state);
@@ -802,7 +836,7 @@ template bool Equihash<96,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<96,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<96,5>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<48,5>
 template int Equihash<48,5>::InitialiseState(eh_HashState& base_state);
@@ -814,4 +848,4 @@ template bool Equihash<48,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(std::vector<unsigned char>)> validBlock,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-template bool Equihash<48,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<48,5>::IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
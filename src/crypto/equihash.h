@@ -190,7 +190,7 @@ public:
                         const std::function<bool(std::vector<unsigned char>)> validBlock,
                         const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
-    bool IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+    bool IsValidSolution(const eh_HashState& base_state, const std::vector<unsigned char>& soln);
 };
 
 #include "equihash.tcc"
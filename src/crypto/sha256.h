@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -29,4 +30,31 @@ private:
     void FinalizeNoPadding(unsigned char hash[OUTPUT_SIZE], bool enforce_compression);
 };
 
+namespace sha256_implementation {
+enum UseImplementation : uint8_t {
+    STANDARD = 0,
+    USE_AVX2 = 1 << 0,
+    USE_SHANI = 1 << 1,
+    USE_ALL = USE_AVX2 | USE_SHANI,
+};
+}
+
+/** Autodetect the best available SHA256 implementation, among those allowed
+ *  by use_implementation, and use it from now on. Returns its name.
+ */
+std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implementation = sha256_implementation::USE_ALL);
+
+/** Compute the double SHA256 of each of a number of 64-byte inputs, as for
+ *  the levels of a block merkle tree.
+ *  output: pointer to a blocks*32 byte output buffer
+ *  input:  pointer to a blocks*64 byte input buffer
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
+/** Apply the SHA256 compression function, without padding, to each of a
+ *  number of 64-byte inputs, as SHA256Compress does for note commitment
+ *  trees. Buffers are laid out as for SHA256D64.
+ */
+void SHA256Compress64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
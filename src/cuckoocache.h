@@ -0,0 +1,142 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CUCKOOCACHE_H
+#define BITCOIN_CUCKOOCACHE_H
+
+#include "uint256.h"
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string.h>
+
+#include <boost/thread/mutex.hpp>
+
+/**
+ * Fixed-size, cuckoo-style set of 32-byte digests.
+ *
+ * Every digest has two candidate slots, derived from its first two 32-bit
+ * words, so digests are expected to be salted hashes. Inserting into two
+ * occupied slots displaces an occupant to its other slot, up to
+ * MAX_DISPLACEMENTS times; whatever is left over is dropped, so the memory
+ * used never grows past what was given to Setup().
+ *
+ * Contains() takes no lock. Slots are made of relaxed atomic words, so a
+ * lookup racing with Insert() may see a torn or displaced digest; that can
+ * only turn a hit into a miss, since a torn digest equal to the one looked
+ * up would be a hash collision. Writers are serialized by a mutex.
+ */
+class CCuckooCache
+{
+public:
+    static const int MAX_DISPLACEMENTS = 8;
+
+private:
+    static const size_t WORDS = sizeof(uint256) / sizeof(uint64_t);
+
+    std::unique_ptr<std::atomic<uint64_t>[]> words;
+    uint32_t nSlots;
+    std::atomic<size_t> nEntries;
+    boost::mutex cs_insert;
+
+    //! Candidate slot n (0 or 1) of a digest, mapped onto [0, nSlots)
+    uint32_t Position(const uint64_t* digest, int n) const
+    {
+        uint32_t h = (uint32_t)(digest[0] >> (32 * n));
+        return (uint32_t)(((uint64_t)h * nSlots) >> 32);
+    }
+
+    void Load(uint32_t pos, uint64_t* digest) const
+    {
+        for (size_t i = 0; i < WORDS; i++)
+            digest[i] = words[pos * WORDS + i].load(std::memory_order_relaxed);
+    }
+
+    void Store(uint32_t pos, const uint64_t* digest)
+    {
+        for (size_t i = 0; i < WORDS; i++)
+            words[pos * WORDS + i].store(digest[i], std::memory_order_relaxed);
+    }
+
+    bool IsEmpty(uint32_t pos) const
+    {
+        for (size_t i = 0; i < WORDS; i++)
+            if (words[pos * WORDS + i].load(std::memory_order_relaxed) != 0)
+                return false;
+        return true;
+    }
+
+    bool Matches(uint32_t pos, const uint64_t* digest) const
+    {
+        for (size_t i = 0; i < WORDS; i++)
+            if (words[pos * WORDS + i].load(std::memory_order_relaxed) != digest[i])
+                return false;
+        return true;
+    }
+
+public:
+    CCuckooCache() : nSlots(0), nEntries(0) {}
+
+    /**
+     * Allocate (and empty) the table, using at most nBytes of memory.
+     * Not safe to call while other threads use the cache.
+     */
+    void Setup(size_t nBytes)
+    {
+        size_t nMaxSlots = nBytes / sizeof(uint256);
+        nSlots = nMaxSlots > UINT32_MAX ? UINT32_MAX : (uint32_t)nMaxSlots;
+        words.reset(nSlots ? new std::atomic<uint64_t>[(size_t)nSlots * WORDS]() : NULL);
+        nEntries = 0;
+    }
+
+    bool Contains(const uint256& entry) const
+    {
+        if (nSlots == 0)
+            return false;
+        uint64_t digest[WORDS];
+        memcpy(digest, entry.begin(), sizeof(digest));
+        return Matches(Position(digest, 0), digest) || Matches(Position(digest, 1), digest);
+    }
+
+    void Insert(const uint256& entry)
+    {
+        // The all-zero digest marks empty slots
+        if (nSlots == 0 || entry.IsNull())
+            return;
+        boost::unique_lock<boost::mutex> lock(cs_insert);
+        if (Contains(entry))
+            return;
+
+        uint64_t digest[WORDS];
+        memcpy(digest, entry.begin(), sizeof(digest));
+        uint32_t posFrom = nSlots;
+        for (int i = 0; i <= MAX_DISPLACEMENTS; i++) {
+            uint32_t pos0 = Position(digest, 0);
+            uint32_t pos1 = Position(digest, 1);
+            if (IsEmpty(pos0) || IsEmpty(pos1)) {
+                Store(IsEmpty(pos0) ? pos0 : pos1, digest);
+                nEntries++;
+                return;
+            }
+            // Take the slot the digest was not just displaced from, and
+            // move its occupant on
+            uint32_t pos = pos0 == posFrom ? pos1 : pos0;
+            uint64_t displaced[WORDS];
+            Load(pos, displaced);
+            Store(pos, digest);
+            memcpy(digest, displaced, sizeof(digest));
+            posFrom = pos;
+        }
+        // The last displaced digest is evicted
+    }
+
+    //! Number of digests held
+    size_t Size() const { return nEntries; }
+    //! Number of digests the table can hold
+    size_t Capacity() const { return nSlots; }
+    size_t DynamicMemoryUsage() const { return (size_t)nSlots * sizeof(uint256); }
+};
+
+#endif // BITCOIN_CUCKOOCACHE_H
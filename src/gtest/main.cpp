@@ -1,5 +1,6 @@
 #include "gtest/gtest.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "pubkey.h"
 
 #include "libsnark/common/default_types/r1cs_ppzksnark_pp.hpp"
@@ -14,6 +15,7 @@ ECCryptoClosure instance_of_eccryptoclosure;
 
 int main(int argc, char **argv) {
   assert(init_and_check_sodium() != -1);
+  SHA256AutoDetect();
   libsnark::default_r1cs_ppzksnark_pp::init_public_params();
   libsnark::inhibit_profiling_info = true;
   libsnark::inhibit_profiling_counters = true;
@@ -83,6 +83,61 @@ void test_full_api(ZCJoinSplit* js)
         rt
     ));
 
+    // The proof of a JoinSplit set up without one can be computed later,
+    // from the phi sampled during the set up
+    {
+        boost::array<JSInput, 2> inputs = {
+            JSInput(), // dummy input
+            JSInput() // dummy input
+        };
+
+        boost::array<JSOutput, 2> outputs = {
+            JSOutput(recipient_addr, 10),
+            JSOutput() // dummy output
+        };
+
+        boost::array<Note, 2> output_notes;
+        uint256 deferredEphemeralKey;
+        uint256 deferredRandomSeed;
+        boost::array<uint256, 2> deferredMacs;
+        boost::array<uint256, 2> deferredNullifiers;
+        boost::array<uint256, 2> deferredCommitments;
+        boost::array<ZCNoteEncryption::Ciphertext, 2> deferredCiphertexts;
+        uint252 phi;
+
+        ZCProof deferredProof = js->prove(
+            inputs,
+            outputs,
+            output_notes,
+            deferredCiphertexts,
+            deferredEphemeralKey,
+            pubKeyHash,
+            deferredRandomSeed,
+            deferredMacs,
+            deferredNullifiers,
+            deferredCommitments,
+            vpub_old,
+            vpub_new,
+            rt,
+            false,
+            &phi
+        );
+        ASSERT_FALSE(js->verify(deferredProof, verifier, pubKeyHash, deferredRandomSeed, deferredMacs,
+                                deferredNullifiers, deferredCommitments, vpub_old, vpub_new, rt));
+
+        deferredProof = js->proveDeferred(
+            inputs,
+            output_notes,
+            phi,
+            js->h_sig(deferredRandomSeed, deferredNullifiers, pubKeyHash),
+            vpub_old,
+            vpub_new,
+            rt
+        );
+        ASSERT_TRUE(js->verify(deferredProof, verifier, pubKeyHash, deferredRandomSeed, deferredMacs,
+                               deferredNullifiers, deferredCommitments, vpub_old, vpub_new, rt));
+    }
+
     // Recipient should decrypt
     // Now the recipient should spend the money again
     auto h_sig = js->h_sig(randomSeed, nullifiers, pubKeyHash);
@@ -157,6 +212,39 @@ void test_full_api(ZCJoinSplit* js)
         vpub_new,
         rt
     ));
+
+    // A batch verifier accepts every proof up front and hands
+    // back the real checks to be run later.
+    auto batchVerifier = libzcash::ProofVerifier::Batch();
+    ASSERT_TRUE(js->verify(
+        proof,
+        batchVerifier,
+        pubKeyHash,
+        randomSeed,
+        macs,
+        nullifiers,
+        commitments,
+        vpub_old,
+        vpub_new,
+        rt
+    ));
+    ASSERT_TRUE(js->verify(
+        proof,
+        batchVerifier,
+        pubKeyHash,
+        randomSeed,
+        macs,
+        nullifiers,
+        commitments,
+        vpub_old,
+        vpub_new + 1,
+        rt
+    ));
+    auto checks = batchVerifier.TakeDeferredChecks();
+    ASSERT_EQ(checks.size(), 2);
+    ASSERT_TRUE(checks[0]());
+    ASSERT_FALSE(checks[1]());
+    ASSERT_TRUE(batchVerifier.TakeDeferredChecks().empty());
 }
 
 // Invokes the API (but does not compute a proof)
@@ -48,6 +48,12 @@ TEST(noteencryption, api)
             // Test wrong nonce
             ASSERT_THROW(decrypter.decrypt(ciphertext, b.get_epk(), uint256(), (i == 0) ? 1 : (i - 1)),
                          libzcash::note_decryption_failed);
+
+            // Test non-throwing decryption
+            ZCNoteDecryption::Plaintext plaintext2;
+            ASSERT_TRUE(decrypter.try_decrypt(ciphertext, b.get_epk(), uint256(), i, plaintext2));
+            ASSERT_TRUE(plaintext2 == message);
+            ASSERT_FALSE(decrypter.try_decrypt(ciphertext, b.get_epk(), uint256(), (i == 0) ? 1 : (i - 1), plaintext2));
         
             // Test wrong ephemeral key
             {
@@ -122,7 +122,17 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
+            // Results written as JSON text are sent as they are, around the
+            // reply members
+            JSONChunks chunks;
+            UniValue result;
+            if (tableRPC.executeJSON(jreq.strMethod, jreq.params, chunks, result)) {
+                chunks.insert(chunks.begin(), std::make_shared<const std::string>("{\"result\":"));
+                chunks.push_back(std::make_shared<const std::string>(",\"error\":null,\"id\":" + jreq.id.write() + "}\n"));
+                req->WriteHeader("Content-Type", "application/json");
+                req->WriteReplyChunked(HTTP_OK, chunks);
+                return true;
+            }
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
@@ -536,6 +536,39 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+static void ReleaseReplyChunk(const void*, size_t, void* extra)
+{
+    delete static_cast<std::shared_ptr<const std::string>*>(extra);
+}
+
+/** Send a reply in chunks; runs in the main http thread */
+static void SendReplyChunked(struct evhttp_request* req, int nStatus, const std::vector<std::shared_ptr<const std::string> >& chunks)
+{
+    evhttp_send_reply_start(req, nStatus, NULL);
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    BOOST_FOREACH(const std::shared_ptr<const std::string>& chunk, chunks) {
+        // An empty chunk would end the reply
+        if (chunk->empty())
+            continue;
+        evbuffer_add_reference(evb, chunk->data(), chunk->size(), ReleaseReplyChunk, new std::shared_ptr<const std::string>(chunk));
+        evhttp_send_reply_chunk(req, evb);
+    }
+    evbuffer_free(evb);
+    evhttp_send_reply_end(req);
+}
+
+void HTTPRequest::WriteReplyChunked(int nStatus, const std::vector<std::shared_ptr<const std::string> >& chunks)
+{
+    assert(!replySent && req);
+    // Send event to main http thread to send reply message
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        boost::bind(SendReplyChunked, req, nStatus, chunks));
+    ev->trigger(0);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
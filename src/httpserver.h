@@ -5,7 +5,9 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include <memory>
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include <boost/thread.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -112,6 +114,15 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Write HTTP reply in chunked transfer encoding, one chunk per string.
+     * The strings are sent without being copied, and released once written
+     * to the socket.
+     *
+     * @note Can be called only once, like WriteReply.
+     */
+    void WriteReplyChunked(int nStatus, const std::vector<std::shared_ptr<const std::string> >& chunks);
 };
 
 /** Event handler closure.
@@ -5,6 +5,10 @@
 #include "leveldbwrapper.h"
 
 #include "util.h"
+#include "utiltime.h"
+
+#include <sstream>
+#include <stdio.h>
 
 #include <boost/filesystem.hpp>
 
@@ -27,12 +31,13 @@ void HandleError(const leveldb::Status& status)
     throw leveldb_error("Unknown database error");
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static leveldb::Options GetOptions(const CLevelDBOptions& dbOptions)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = leveldb::NewLRUCache(dbOptions.GetBlockCacheSize());
+    options.write_buffer_size = dbOptions.GetWriteBufferSize(); // up to two write buffers may be held in memory simultaneously
+    options.max_file_size = dbOptions.nMaxFileSize;
+    options.filter_policy = dbOptions.nBloomBits > 0 ? leveldb::NewBloomFilterPolicy(dbOptions.nBloomBits) : NULL;
     options.compression = leveldb::kNoCompression;
     options.max_open_files = 64;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
@@ -43,14 +48,20 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe)
+CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe) :
+    CLevelDBWrapper(path, CLevelDBOptions(nCacheSize), fMemory, fWipe)
+{
+}
+
+CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path& path, const CLevelDBOptions& dbOptionsIn, bool fMemory, bool fWipe) :
+    strPath(path.string()), dbOptions(dbOptionsIn), nWrites(0), nWriteMicros(0), nMaxWriteMicros(0), nSlowWrites(0)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(dbOptions);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -64,6 +75,9 @@ CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path& path, size_t nCa
         TryCreateDirectory(path);
         LogPrintf("Opening LevelDB in %s\n", path.string());
     }
+    LogPrint("leveldb", "LevelDB %s: block cache %.1fMiB, write buffer %.1fMiB, max file size %.1fMiB, bloom filter bits %d\n",
+             path.string(), dbOptions.GetBlockCacheSize() * (1.0 / 1024 / 1024), dbOptions.GetWriteBufferSize() * (1.0 / 1024 / 1024),
+             dbOptions.nMaxFileSize * (1.0 / 1024 / 1024), dbOptions.nBloomBits);
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
@@ -83,7 +97,58 @@ CLevelDBWrapper::~CLevelDBWrapper()
 
 bool CLevelDBWrapper::WriteBatch(CLevelDBBatch& batch, bool fSync)
 {
+    int64_t nTimeStart = GetTimeMicros();
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    uint64_t nMicros = GetTimeMicros() - nTimeStart;
+
+    // Writes stall while LevelDB waits for compactions to catch up
+    nWrites++;
+    nWriteMicros += nMicros;
+    uint64_t nMax = nMaxWriteMicros;
+    while (nMicros > nMax && !nMaxWriteMicros.compare_exchange_weak(nMax, nMicros)) {}
+    if (nMicros >= LEVELDB_SLOW_WRITE_MS * 1000) {
+        nSlowWrites++;
+        LogPrint("leveldb", "Slow LevelDB write to %s: %u bytes in %.2fms\n",
+                 strPath, batch.SizeEstimate(), nMicros * 0.001);
+    }
+
     HandleError(status);
     return true;
 }
+
+std::string CLevelDBWrapper::GetProperty(const std::string& strProperty) const
+{
+    std::string strValue;
+    if (!pdb->GetProperty(strProperty, &strValue))
+        return "";
+    return strValue;
+}
+
+void CLevelDBWrapper::GetStats(CLevelDBStats& stats) const
+{
+    stats.nWrites = nWrites;
+    stats.nWriteMicros = nWriteMicros;
+    stats.nMaxWriteMicros = nMaxWriteMicros;
+    stats.nSlowWrites = nSlowWrites;
+
+    // All keys of the databases start with a one byte prefix below 0xff
+    static const char LAST_KEY[] = "\xff\xff\xff\xff";
+    leveldb::Range range(leveldb::Slice(), leveldb::Slice(LAST_KEY, sizeof(LAST_KEY) - 1));
+    stats.nApproximateSize = 0;
+    pdb->GetApproximateSizes(&range, 1, &stats.nApproximateSize);
+
+    // Parse the compaction table of "leveldb.stats":
+    //   Level  Files Size(MB) Time(sec) Read(MB) Write(MB)
+    //   --------------------------------------------------
+    //     0        2        4         0        0         4
+    stats.vLevels.clear();
+    std::istringstream ss(GetProperty("leveldb.stats"));
+    std::string strLine;
+    while (std::getline(ss, strLine)) {
+        CLevelDBLevelStats level;
+        if (sscanf(strLine.c_str(), "%d %d %lf %lf %lf %lf", &level.nLevel, &level.nFiles, &level.dSizeMB,
+                   &level.dCompactionSeconds, &level.dReadMB, &level.dWrittenMB) == 6) {
+            stats.vLevels.push_back(level);
+        }
+    }
+}
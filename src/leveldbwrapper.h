@@ -11,6 +11,8 @@
 #include "util.h"
 #include "version.h"
 
+#include <atomic>
+
 #include <boost/filesystem/path.hpp>
 
 #include <leveldb/db.h>
@@ -31,8 +33,14 @@ class CLevelDBBatch
 
 private:
     leveldb::WriteBatch batch;
+    size_t nSizeEstimate;
 
 public:
+    CLevelDBBatch() : nSizeEstimate(0) {}
+
+    //! Bytes of keys and values queued so far
+    size_t SizeEstimate() const { return nSizeEstimate; }
+
     template <typename K, typename V>
     void Write(const K& key, const V& value)
     {
@@ -47,6 +55,7 @@ public:
         leveldb::Slice slValue(&ssValue[0], ssValue.size());
 
         batch.Put(slKey, slValue);
+        nSizeEstimate += ssKey.size() + ssValue.size();
     }
 
     template <typename K>
@@ -58,12 +67,80 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         batch.Delete(slKey);
+        nSizeEstimate += ssKey.size();
     }
 };
 
+//! Share of a database's cache used for its block cache (percent)
+static const int DEFAULT_LEVELDB_BLOCK_CACHE_PERCENT = 50;
+//! Size of the table files LevelDB writes (MiB)
+static const int DEFAULT_LEVELDB_MAX_FILE_SIZE = 2;
+//! Bits per key of the bloom filter
+static const int DEFAULT_LEVELDB_BLOOM_BITS = 10;
+//! Writes taking longer than this are counted (and logged) as slow (milliseconds)
+static const int LEVELDB_SLOW_WRITE_MS = 100;
+
+/** Tuning of a single LevelDB database. */
+struct CLevelDBOptions
+{
+    //! memory for the block cache and the write buffers
+    size_t nCacheSize;
+    //! share of nCacheSize used for the block cache, in percent
+    int nBlockCachePercent;
+    //! size of a memtable, up to two of which may be held at once (0: a quarter of nCacheSize)
+    size_t nWriteBufferSize;
+    //! size of the table files written
+    size_t nMaxFileSize;
+    //! bits per key of the bloom filter, 0 to disable it
+    int nBloomBits;
+
+    CLevelDBOptions(size_t nCacheSizeIn = 0) :
+        nCacheSize(nCacheSizeIn), nBlockCachePercent(DEFAULT_LEVELDB_BLOCK_CACHE_PERCENT),
+        nWriteBufferSize(0), nMaxFileSize(DEFAULT_LEVELDB_MAX_FILE_SIZE << 20),
+        nBloomBits(DEFAULT_LEVELDB_BLOOM_BITS) {}
+
+    size_t GetBlockCacheSize() const { return nCacheSize * nBlockCachePercent / 100; }
+    size_t GetWriteBufferSize() const { return nWriteBufferSize ? nWriteBufferSize : nCacheSize / 4; }
+};
+
+/** Compaction statistics of one LevelDB level, as in "leveldb.stats" */
+struct CLevelDBLevelStats
+{
+    int nLevel;
+    int nFiles;
+    double dSizeMB;
+    double dCompactionSeconds;
+    double dReadMB;
+    double dWrittenMB;
+};
+
+/** Write counters and compaction statistics of a database. */
+struct CLevelDBStats
+{
+    uint64_t nWrites;
+    uint64_t nWriteMicros;
+    uint64_t nMaxWriteMicros;
+    uint64_t nSlowWrites;
+    //! approximate size on disk of the whole database
+    uint64_t nApproximateSize;
+    std::vector<CLevelDBLevelStats> vLevels;
+};
+
 class CLevelDBWrapper
 {
 private:
+    //! where the database lives, for logging and statistics
+    std::string strPath;
+
+    //! tuning the database was opened with
+    CLevelDBOptions dbOptions;
+
+    //! number of batches written, their total and longest duration and how many were slow
+    std::atomic<uint64_t> nWrites;
+    std::atomic<uint64_t> nWriteMicros;
+    std::atomic<uint64_t> nMaxWriteMicros;
+    std::atomic<uint64_t> nSlowWrites;
+
     //! custom environment this database is using (may be NULL in case of default environment)
     leveldb::Env* penv;
 
@@ -87,6 +164,7 @@ private:
 
 public:
     CLevelDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CLevelDBWrapper(const boost::filesystem::path& path, const CLevelDBOptions& dbOptionsIn, bool fMemory = false, bool fWipe = false);
     ~CLevelDBWrapper();
 
     template <typename K, typename V>
@@ -168,6 +246,30 @@ public:
     {
         return pdb->NewIterator(iteroptions);
     }
+
+    //! Approximate size on disk of the keys in [key_begin, key_end)
+    template <typename K>
+    uint64_t EstimateSize(const K& key_begin, const K& key_end) const
+    {
+        CDataStream ssKey1(SER_DISK, CLIENT_VERSION), ssKey2(SER_DISK, CLIENT_VERSION);
+        ssKey1 << key_begin;
+        ssKey2 << key_end;
+        leveldb::Slice slKey1(&ssKey1[0], ssKey1.size());
+        leveldb::Slice slKey2(&ssKey2[0], ssKey2.size());
+        uint64_t size = 0;
+        leveldb::Range range(slKey1, slKey2);
+        pdb->GetApproximateSizes(&range, 1, &size);
+        return size;
+    }
+
+    //! Value of a LevelDB property such as "leveldb.stats", or empty if unknown
+    std::string GetProperty(const std::string& strProperty) const;
+
+    const std::string& GetPath() const { return strPath; }
+    const CLevelDBOptions& GetDBOptions() const { return dbOptions; }
+
+    //! Write counters and per-level compaction statistics of the database
+    void GetStats(CLevelDBStats& stats) const;
 };
 
 #endif // BITCOIN_LEVELDBWRAPPER_H
@@ -31,9 +31,11 @@
 #include "wallet/asyncrpcoperation_sendmany.h"
 #include "wallet/asyncrpcoperation_shieldcoinbase.h"
 
+#include <memory>
 #include <sstream>
 
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/math/distributions/poisson.hpp>
@@ -59,10 +61,15 @@ int64_t nTimeBestReceived = 0;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+int nPrefetchThreads = DEFAULT_PREFETCH_THREADS;
+int nMessageCheckThreads = 0;
 bool fExperimentalMode = false;
 bool fImporting = false;
 bool fReindex = false;
 bool fTxIndex = false;
+bool fAddressIndex = false;
+bool fSpentIndex = false;
+bool fTimestampIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = true;
@@ -551,6 +558,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 
 CCoinsViewCache *pcoinsTip = NULL;
 CBlockTreeDB *pblocktree = NULL;
+CCoinsViewDB *pcoinsdbview = NULL;
 
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -850,8 +858,12 @@ unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& in
     return nSigOps;
 }
 
-bool CheckTransaction(const CTransaction& tx, CValidationState &state,
-                      libzcash::ProofVerifier& verifier)
+/**
+ * CheckTransaction, with the JoinSplit proofs verified by pverifier, or
+ * skipped when it is NULL because they are known valid.
+ */
+static bool CheckTransactionImpl(const CTransaction& tx, CValidationState &state,
+                                 libzcash::ProofVerifier* pverifier)
 {
     // Don't count coinbase transactions because mining skews the count
     if (!tx.IsCoinBase()) {
@@ -864,7 +876,7 @@ bool CheckTransaction(const CTransaction& tx, CValidationState &state,
 
     // Ensure that zk-SNARKs verify
     BOOST_FOREACH(const JSDescription &joinsplit, tx.vjoinsplit) {
-        if (!joinsplit.Verify(*pzcashParams, verifier, tx.joinSplitPubKey)) {
+        if (pverifier && !joinsplit.Verify(*pzcashParams, *pverifier, tx.joinSplitPubKey)) {
             return state.DoS(100, error("CheckTransaction(): joinsplit does not verify"),
                                 REJECT_INVALID, "bad-txns-joinsplit-verification-failed");
         }
@@ -898,6 +910,12 @@ bool CheckTransaction(const CTransaction& tx, CValidationState &state,
     return true;
 }
 
+bool CheckTransaction(const CTransaction& tx, CValidationState &state,
+                      libzcash::ProofVerifier& verifier)
+{
+    return CheckTransactionImpl(tx, state, &verifier);
+}
+
 bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidationState &state)
 {
     // Basic checks that don't depend on any context
@@ -1092,8 +1110,51 @@ CAmount GetMinRelayFee(const CTransaction& tx, unsigned int nBytes, bool fAllowF
 }
 
 
+void LimitMempoolSize(CTxMemPool& pool, size_t limit, unsigned long age)
+{
+    int expired = pool.Expire(GetTime() - age);
+    if (expired != 0)
+        LogPrint("mempool", "Expired %i transactions from the memory pool\n", expired);
+
+    pool.TrimToSize(limit);
+}
+
+namespace {
+
+/** Maximum number of entries in setVerifiedProofs */
+const size_t MAX_VERIFIED_PROOFS = 1000;
+
+/**
+ * Transactions whose joinsplit proofs a message check thread has verified,
+ * so that AcceptToMemoryPool does not verify them again under cs_main. Each
+ * entry is used once; the oldest ones are dropped when the set is full.
+ */
+CCriticalSection cs_verifiedProofs;
+std::set<uint256> setVerifiedProofs;
+std::deque<uint256> vVerifiedProofsOrder;
+
+} // anon namespace
+
+void AddVerifiedProofs(const uint256& txid)
+{
+    LOCK(cs_verifiedProofs);
+    if (!setVerifiedProofs.insert(txid).second)
+        return;
+    vVerifiedProofsOrder.push_back(txid);
+    while (vVerifiedProofsOrder.size() > MAX_VERIFIED_PROOFS) {
+        setVerifiedProofs.erase(vVerifiedProofsOrder.front());
+        vVerifiedProofsOrder.pop_front();
+    }
+}
+
+static bool TakeVerifiedProofs(const uint256& txid)
+{
+    LOCK(cs_verifiedProofs);
+    return setVerifiedProofs.erase(txid) != 0;
+}
+
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
-                        bool* pfMissingInputs, bool fRejectAbsurdFee)
+                        bool* pfMissingInputs, bool fRejectAbsurdFee, bool fOverrideMempoolLimit)
 {
     AssertLockHeld(cs_main);
     if (pfMissingInputs)
@@ -1110,8 +1171,10 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
         }
     }
 
+    // The proofs of a transaction received from a peer were verified by a
+    // message check thread already
     auto verifier = libzcash::ProofVerifier::Strict();
-    if (!CheckTransaction(tx, state, verifier))
+    if (!CheckTransactionImpl(tx, state, TakeVerifiedProofs(tx.GetHash()) ? NULL : &verifier))
         return error("AcceptToMemoryPool: CheckTransaction failed");
 
 
@@ -1232,6 +1295,20 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
         CTxMemPoolEntry entry(tx, nFees, GetTime(), dPriority, chainActive.Height(), mempool.HasNoInputsOf(tx));
         unsigned int nSize = entry.GetTxSize();
 
+        // Fees as modified by prioritisetransaction, which is what the
+        // pool orders and evicts by
+        CAmount nModifiedFees = nFees;
+        double nPriorityDummy = 0;
+        pool.ApplyDeltas(hash, nPriorityDummy, nModifiedFees);
+
+        // Once the pool has been full, it takes a feerate better than the
+        // packages it evicted to get back in
+        CAmount mempoolRejectFee = pool.GetMinFee(GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000).GetFee(nSize);
+        if (mempoolRejectFee > 0 && nModifiedFees < mempoolRejectFee)
+            return state.DoS(0, error("AcceptToMemoryPool: mempool min fee not met %s, %d < %d",
+                                      hash.ToString(), nModifiedFees, mempoolRejectFee),
+                             REJECT_INSUFFICIENTFEE, "mempool min fee not met");
+
         // Accept a tx if it contains joinsplits and has at least the default fee specified by z_sendmany.
         if (tx.vjoinsplit.size() > 0 && nFees >= ASYNC_RPC_OPERATION_DEFAULT_MINERS_FEE) {
             // In future we will we have more accurate and dynamic computation of fees for tx with joinsplits.
@@ -1278,6 +1355,18 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                          hash.ToString(),
                          nFees, ::minRelayTxFee.GetFee(nSize) * 10000);
 
+        // Calculate in-mempool ancestors, up to a limit.
+        CTxMemPool::setEntries setAncestors;
+        size_t nLimitAncestors = GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
+        size_t nLimitAncestorSize = GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
+        size_t nLimitDescendants = GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
+        size_t nLimitDescendantSize = GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000;
+        std::string errString;
+        if (!pool.CalculateMemPoolAncestors(entry, setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString)) {
+            return state.DoS(0, error("AcceptToMemoryPool: %s: %s", hash.ToString(), errString),
+                             REJECT_NONSTANDARD, "too-long-mempool-chain");
+        }
+
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
         if (!ContextualCheckInputs(tx, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus()))
@@ -1300,7 +1389,15 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
         }
 
         // Store transaction in memory
-        pool.addUnchecked(hash, entry, !IsInitialBlockDownload());
+        pool.addUnchecked(hash, entry, setAncestors, !IsInitialBlockDownload());
+
+        // trim mempool and check if tx was trimmed
+        if (!fOverrideMempoolLimit) {
+            LimitMempoolSize(pool, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+            if (!pool.exists(hash))
+                return state.DoS(0, error("AcceptToMemoryPool: mempool full, %s evicted", hash.ToString()),
+                                 REJECT_INSUFFICIENTFEE, "mempool full");
+        }
     }
 
     SyncWithWallets(tx, NULL);
@@ -1369,6 +1466,71 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
     return false;
 }
 
+/**
+ * Address index type and hash of the transparent address a script pays to:
+ * P2PKH, P2PK (by key hash) and P2SH, including the replay protected forms.
+ */
+static bool GetAddressIndexKey(const CScript& scriptPubKey, unsigned int& type, uint160& hashBytes)
+{
+    CTxDestination dest;
+    if (!ExtractDestination(scriptPubKey, dest))
+        return false;
+    if (const CKeyID* keyID = boost::get<CKeyID>(&dest)) {
+        type = ADDRESSINDEX_PUBKEYHASH;
+        hashBytes = *keyID;
+        return true;
+    }
+    if (const CScriptID* scriptID = boost::get<CScriptID>(&dest)) {
+        type = ADDRESSINDEX_SCRIPTHASH;
+        hashBytes = *scriptID;
+        return true;
+    }
+    return false;
+}
+
+bool GetAddressIndex(const uint160 &addressHash, unsigned int type,
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+{
+    if (!fAddressIndex)
+        return error("%s: address index not enabled", __func__);
+
+    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+        return error("%s: unable to get txids for address", __func__);
+
+    return true;
+}
+
+bool GetAddressUnspent(const uint160 &addressHash, unsigned int type,
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+{
+    if (!fAddressIndex)
+        return error("%s: address index not enabled", __func__);
+
+    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+        return error("%s: unable to get txids for address", __func__);
+
+    return true;
+}
+
+bool GetSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value)
+{
+    if (!fSpentIndex)
+        return false;
+
+    return pblocktree->ReadSpentIndex(key, value);
+}
+
+bool GetTimestampIndex(unsigned int high, unsigned int low, std::vector<uint256> &hashes)
+{
+    if (!fTimestampIndex)
+        return error("%s: timestamp index not enabled", __func__);
+
+    if (!pblocktree->ReadTimestampIndex(high, low, hashes))
+        return error("%s: unable to get hashes for timestamps", __func__);
+
+    return true;
+}
+
 
 
 
@@ -1400,18 +1562,63 @@ bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos, const CMessageHeader::M
     return true;
 }
 
+/** Mappings of the block files, for reading blocks in place */
+static CBlockFileMap mapBlockFiles;
+
+bool ReadRawBlockFromDisk(CRawBlock& block, const CDiskBlockPos& pos)
+{
+    if (mapBlockFiles.GetBlock(pos, block))
+        return true;
+
+    // The file cannot be mapped: read the block into a buffer of its own
+    if (pos.nPos < 4)
+        return error("%s: no block at %s", __func__, pos.ToString());
+    CAutoFile filein(OpenBlockFile(CDiskBlockPos(pos.nFile, pos.nPos - 4), true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+    try {
+        unsigned int nSize;
+        filein >> nSize;
+        if (nSize > MAX_BLOCK_SIZE)
+            return error("%s: bad block size %u at %s", __func__, nSize, pos.ToString());
+        std::shared_ptr<std::vector<char> > buffer = std::make_shared<std::vector<char> >(nSize);
+        filein.read(begin_ptr(*buffer), nSize);
+        block.Set(buffer, begin_ptr(*buffer), nSize);
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
+bool ReadRawBlockFromDisk(CRawBlock& block, const CBlockIndex* pindex)
+{
+    if (!ReadRawBlockFromDisk(block, pindex->GetBlockPos()))
+        return false;
+    CBlockHeader header;
+    try {
+        CByteReader reader = block.GetReader(SER_DISK, CLIENT_VERSION);
+        reader >> header;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize error - %s at %s", __func__, e.what(), pindex->GetBlockPos().ToString());
+    }
+    if (header.GetHash() != pindex->GetBlockHash())
+        return error("ReadRawBlockFromDisk(CRawBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
+                pindex->ToString(), pindex->GetBlockPos().ToString());
+    return true;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    CRawBlock raw;
+    if (!ReadRawBlockFromDisk(raw, pos))
+        return error("ReadBlockFromDisk: cannot read block at %s", pos.ToString());
 
-    // Read block
+    // Read block, straight from the mapped file
     try {
-        filein >> block;
+        CByteReader reader = raw.GetReader(SER_DISK, CLIENT_VERSION);
+        reader >> block;
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -1435,6 +1642,16 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
     return true;
 }
 
+std::vector<unsigned char> CBlockIndex::GetSolution() const
+{
+    if (!fSolutionTrimmed)
+        return nSolution;
+    CDiskBlockIndex dbindex;
+    if (!pblocktree->ReadDiskBlockIndex(GetBlockHash(), dbindex))
+        throw std::runtime_error(strprintf("CBlockIndex::GetSolution(): failed to read index entry for %s", GetBlockHash().ToString()));
+    return dbindex.nSolution;
+}
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 {
     CAmount nSubsidy = 12.5 * COIN;
@@ -1670,6 +1887,17 @@ bool CScriptCheck::operator()() {
     return true;
 }
 
+bool CProofCheck::operator()() {
+    try {
+        if (!check()) {
+            return ::error("CProofCheck(): joinsplit does not verify");
+        }
+    } catch (...) {
+        return ::error("CProofCheck(): joinsplit verification threw an exception");
+    }
+    return true;
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -1939,7 +2167,7 @@ static bool ApplyTxInUndo(const CTxInUndo& undo, CCoinsViewCache& view, const CO
     return fClean;
 }
 
-bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean)
+bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean, bool fJustCheck)
 {
     assert(pindex->GetBlockHash() == view.GetBestBlock());
 
@@ -1958,11 +2186,29 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size())
         return error("DisconnectBlock(): block and undo data inconsistent");
 
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    bool fAddressIndexUpdate = fAddressIndex && !fJustCheck;
+    bool fSpentIndexUpdate = fSpentIndex && !fJustCheck;
+
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = block.vtx[i];
         uint256 hash = tx.GetHash();
 
+        if (fAddressIndexUpdate) {
+            for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                const CTxOut &out = tx.vout[k];
+                unsigned int addressType;
+                uint160 hashBytes;
+                if (GetAddressIndexKey(out.scriptPubKey, addressType, hashBytes)) {
+                    addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, hash, k, false), out.nValue));
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, hash, k), CAddressUnspentValue()));
+                }
+            }
+        }
+
         // Check that all outputs are available and match the outputs in the block itself
         // exactly.
         {
@@ -1999,10 +2245,35 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
                 const CTxInUndo &undo = txundo.vprevout[j];
                 if (!ApplyTxInUndo(undo, view, out))
                     fClean = false;
+
+                if (fSpentIndexUpdate)
+                    spentIndex.push_back(std::make_pair(CSpentIndexKey(out.hash, out.n), CSpentIndexValue()));
+
+                unsigned int addressType;
+                uint160 hashBytes;
+                if (fAddressIndexUpdate && GetAddressIndexKey(undo.txout.scriptPubKey, addressType, hashBytes)) {
+                    // The undo data only records the height for the last output of a transaction
+                    const CCoins* coins = view.AccessCoins(out.hash);
+                    int nPrevHeight = coins ? coins->nHeight : undo.nHeight;
+                    addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, hash, j, true), undo.txout.nValue * -1));
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, out.hash, out.n),
+                                                                 CAddressUnspentValue(undo.txout.nValue, undo.txout.scriptPubKey, nPrevHeight)));
+                }
             }
         }
     }
 
+    if (fAddressIndexUpdate) {
+        if (!pblocktree->EraseAddressIndex(addressIndex))
+            return AbortNode(state, "Failed to delete address index");
+        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex))
+            return AbortNode(state, "Failed to write address unspent index");
+    }
+    if (fSpentIndexUpdate && !pblocktree->UpdateSpentIndex(spentIndex))
+        return AbortNode(state, "Failed to write spent index");
+    if (fTimestampIndex && !fJustCheck && !pblocktree->EraseTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
+        return AbortNode(state, "Failed to delete timestamp index");
+
     // set the old best anchor back
     view.PopAnchor(blockUndo.old_tree_root);
 
@@ -2049,6 +2320,105 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CProofCheck> proofcheckqueue(8);
+
+void ThreadProofCheck() {
+    RenameThread("zcash-proofch");
+    proofcheckqueue.Thread();
+}
+
+static CCheckQueue<CEquihashCheck> equihashcheckqueue(16);
+/** Serializes the users of equihashcheckqueue, which may run without cs_main */
+static CCriticalSection cs_equihashcheckqueue;
+
+void ThreadEquihashCheck() {
+    RenameThread("zcash-equihash");
+    equihashcheckqueue.Thread();
+}
+
+static CCheckQueue<CMerkleHashCheck> merklecheckqueue(4);
+/** Serializes the users of merklecheckqueue, which may run without cs_main */
+static CCriticalSection cs_merklecheckqueue;
+/** Pairs hashed by one CMerkleHashCheck; smaller levels are hashed inline */
+static const size_t MERKLE_PAIRS_PER_CHECK = 1024;
+
+void ThreadMerkleCheck() {
+    RenameThread("zcash-merkle");
+    merklecheckqueue.Thread();
+}
+
+bool CheckDeferredProofs(libzcash::ProofVerifier& verifier)
+{
+    AssertLockHeld(cs_main);
+
+    std::vector<CProofCheck> vChecks;
+    BOOST_FOREACH(const libzcash::ProofVerifier::DeferredCheck& check, verifier.TakeDeferredChecks())
+        vChecks.push_back(CProofCheck(check));
+
+    if (!nScriptCheckThreads) {
+        BOOST_FOREACH(CProofCheck& check, vChecks)
+            if (!check())
+                return false;
+        return true;
+    }
+
+    CCheckQueueControl<CProofCheck> control(&proofcheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
+bool CEquihashCheck::operator()() {
+    return CheckEquihashSolution(pheader, Params());
+}
+
+bool CheckEquihashSolutions(const std::vector<const CBlockHeader*>& vHeaders)
+{
+    std::vector<CEquihashCheck> vChecks;
+    vChecks.reserve(vHeaders.size());
+    BOOST_FOREACH(const CBlockHeader* pheader, vHeaders)
+        vChecks.push_back(CEquihashCheck(*pheader));
+
+    if (!nScriptCheckThreads || vChecks.size() < 2) {
+        BOOST_FOREACH(CEquihashCheck& check, vChecks)
+            if (!check())
+                return false;
+        return true;
+    }
+
+    LOCK(cs_equihashcheckqueue);
+    CCheckQueueControl<CEquihashCheck> control(&equihashcheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
+bool CMerkleHashCheck::operator()() {
+    SHA256D64(out, in, nPairs);
+    return true;
+}
+
+void HashMerkleLevel(unsigned char* out, const unsigned char* in, size_t nPairs)
+{
+    if (!nScriptCheckThreads || nPairs < 2 * MERKLE_PAIRS_PER_CHECK) {
+        SHA256D64(out, in, nPairs);
+        return;
+    }
+
+    // Another thread hashing a block (e.g. a block import worker) is
+    // using the queue; hashing inline beats waiting for it
+    TRY_LOCK(cs_merklecheckqueue, lockQueue);
+    if (!lockQueue) {
+        SHA256D64(out, in, nPairs);
+        return;
+    }
+
+    std::vector<CMerkleHashCheck> vChecks;
+    for (size_t i = 0; i < nPairs; i += MERKLE_PAIRS_PER_CHECK)
+        vChecks.push_back(CMerkleHashCheck(out + 32 * i, in + 64 * i, std::min(MERKLE_PAIRS_PER_CHECK, nPairs - i)));
+    CCheckQueueControl<CMerkleHashCheck> control(&merklecheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -2157,6 +2527,7 @@ public:
 static ThresholdConditionCache warningcache[VERSIONBITS_NUM_BITS];
 
 static int64_t nTimeVerify = 0;
+static int64_t nTimeProofs = 0;
 static int64_t nTimeConnect = 0;
 static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
@@ -2176,11 +2547,18 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
     }
 
+    // With script check threads available, the JoinSplit proofs are only
+    // collected by CheckBlock and verified below on the proof check queue,
+    // concurrently with the script checks.
+    bool fParallelProofs = fExpensiveChecks && nScriptCheckThreads;
     auto verifier = libzcash::ProofVerifier::Strict();
+    auto batchVerifier = libzcash::ProofVerifier::Batch();
     auto disabledVerifier = libzcash::ProofVerifier::Disabled();
+    libzcash::ProofVerifier& blockVerifier = !fExpensiveChecks ? disabledVerifier :
+                                             fParallelProofs ? batchVerifier : verifier;
 
     // Check it again to verify JoinSplit proofs, and in case a previous version let a bad block in
-    if (!CheckBlock(block, state, fExpensiveChecks ? verifier : disabledVerifier, !fJustCheck, !fJustCheck))
+    if (!CheckBlock(block, state, blockVerifier, !fJustCheck, !fJustCheck))
         return false;
 
     // verify that the view's current state corresponds to the previous block
@@ -2231,9 +2609,17 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     CBlockUndo blockundo;
 
+    int64_t nTimeStart = GetTimeMicros();
+
+    CCheckQueueControl<CProofCheck> proofControl(fParallelProofs ? &proofcheckqueue : NULL);
+    std::vector<CProofCheck> vProofChecks;
+    BOOST_FOREACH(const libzcash::ProofVerifier::DeferredCheck& check, batchVerifier.TakeDeferredChecks())
+        vProofChecks.push_back(CProofCheck(check));
+    unsigned int nProofs = vProofChecks.size();
+    proofControl.Add(vProofChecks);
+
     CCheckQueueControl<CScriptCheck> control(fExpensiveChecks && nScriptCheckThreads ? &scriptcheckqueue : NULL);
 
-    int64_t nTimeStart = GetTimeMicros();
     CAmount nFees = 0;
     int nInputs = 0;
     unsigned int nSigOps = 0;
@@ -2241,6 +2627,11 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     std::vector<std::pair<uint256, CDiskTxPos> > vPos;
     vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    bool fAddressIndexUpdate = fAddressIndex && !fJustCheck;
+    bool fSpentIndexUpdate = fSpentIndex && !fJustCheck;
 
     // Construct the incremental merkle tree at the current
     // block position,
@@ -2295,6 +2686,43 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             if (!ContextualCheckInputs(tx, state, view, fExpensiveChecks, chain, flags, false, chainparams.GetConsensus(), nScriptCheckThreads ? &vChecks : NULL))
                 return false;
             control.Add(vChecks);
+
+            // The outputs being spent are gone from the view after UpdateCoins
+            if (fAddressIndexUpdate || fSpentIndexUpdate) {
+                for (unsigned int j = 0; j < tx.vin.size(); j++) {
+                    const CTxIn &input = tx.vin[j];
+                    const CTxOut &prevout = view.GetOutputFor(input);
+                    unsigned int addressType = ADDRESSINDEX_NONE;
+                    uint160 hashBytes;
+                    bool fAddress = GetAddressIndexKey(prevout.scriptPubKey, addressType, hashBytes);
+
+                    if (fAddressIndexUpdate && fAddress) {
+                        addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, tx.GetHash(), j, true), prevout.nValue * -1));
+                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
+                    }
+                    if (fSpentIndexUpdate) {
+                        if (!fAddress) {
+                            addressType = ADDRESSINDEX_NONE;
+                            hashBytes.SetNull();
+                        }
+                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n),
+                                                            CSpentIndexValue(tx.GetHash(), j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
+                    }
+                }
+            }
+        }
+
+        if (fAddressIndexUpdate) {
+            for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                const CTxOut &out = tx.vout[k];
+                unsigned int addressType;
+                uint160 hashBytes;
+                if (GetAddressIndexKey(out.scriptPubKey, addressType, hashBytes)) {
+                    addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, tx.GetHash(), k, false), out.nValue));
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, tx.GetHash(), k),
+                                                                 CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
+                }
+            }
         }
 
         CTxUndo undoDummy;
@@ -2331,6 +2759,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                                block.vtx[0].GetValueOut(), blockReward),
                                REJECT_INVALID, "bad-cb-amount");
 
+    if (!proofControl.Wait())
+        return state.DoS(100, error("ConnectBlock(): joinsplit does not verify"),
+                         REJECT_INVALID, "bad-txns-joinsplit-verification-failed");
+    int64_t nTimeProofsDone = GetTimeMicros(); nTimeProofs += nTimeProofsDone - nTimeStart;
+    LogPrint("bench", "    - Verify %u joinsplit proofs: %.2fms (%.3fms/proof) [%.2fs]\n", nProofs, 0.001 * (nTimeProofsDone - nTimeStart), nProofs == 0 ? 0 : 0.001 * (nTimeProofsDone - nTimeStart) / nProofs, nTimeProofs * 0.000001);
+
     if (!control.Wait())
         return state.DoS(100, false);
     int64_t nTime2 = GetTimeMicros(); nTimeVerify += nTime2 - nTimeStart;
@@ -2362,6 +2796,21 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
 
+    if (fAddressIndexUpdate) {
+        if (!pblocktree->WriteAddressIndex(addressIndex))
+            return AbortNode(state, "Failed to write address index");
+        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex))
+            return AbortNode(state, "Failed to write address unspent index");
+    }
+
+    if (fSpentIndexUpdate)
+        if (!pblocktree->UpdateSpentIndex(spentIndex))
+            return AbortNode(state, "Failed to write spent index");
+
+    if (fTimestampIndex)
+        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
+            return AbortNode(state, "Failed to write timestamp index");
+
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -2448,15 +2897,16 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                 vFiles.push_back(make_pair(*it, &vinfoBlockFile[*it]));
                 setDirtyFileInfo.erase(it++);
             }
-            std::vector<const CBlockIndex*> vBlocks;
-            vBlocks.reserve(setDirtyBlockIndex.size());
-            for (set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end(); ) {
-                vBlocks.push_back(*it);
-                setDirtyBlockIndex.erase(it++);
-            }
+            std::vector<CBlockIndex*> vDirtyBlocks(setDirtyBlockIndex.begin(), setDirtyBlockIndex.end());
+            setDirtyBlockIndex.clear();
+            std::vector<const CBlockIndex*> vBlocks(vDirtyBlocks.begin(), vDirtyBlocks.end());
             if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                 return AbortNode(state, "Files to write to block index database");
             }
+            // The solutions are now on disk, stop keeping them in memory.
+            BOOST_FOREACH(CBlockIndex* pindex, vDirtyBlocks) {
+                pindex->TrimSolution();
+            }
         }
         // Finally remove any pruned files
         if (fFlushForPrune)
@@ -2473,8 +2923,12 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
         // Flush the chainstate (which may refer to block index entries).
+        // With -backgroundflush this only hands the cache to the writer
+        // thread; wait for the write unless validation can go on meanwhile.
         if (!pcoinsTip->Flush())
             return AbortNode(state, "Failed to write to coin database");
+        if ((mode == FLUSH_STATE_ALWAYS || fFlushForPrune) && !pcoinsdbview->WaitForFlush())
+            return AbortNode(state, "Failed to write to coin database");
         nLastFlush = nNow;
     }
     if ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000) {
@@ -2581,13 +3035,23 @@ bool static DisconnectTip(CValidationState &state) {
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
         return false;
     // Resurrect mempool transactions from the disconnected block.
+    std::vector<uint256> vHashUpdate;
     BOOST_FOREACH(const CTransaction &tx, block.vtx) {
         // ignore validation errors in resurrected transactions
         list<CTransaction> removed;
         CValidationState stateDummy;
-        if (tx.IsCoinBase() || !AcceptToMemoryPool(mempool, stateDummy, tx, false, NULL))
+        if (tx.IsCoinBase() || !AcceptToMemoryPool(mempool, stateDummy, tx, false, NULL, false, true)) {
             mempool.remove(tx, removed, true);
+        } else if (mempool.exists(tx.GetHash())) {
+            vHashUpdate.push_back(tx.GetHash());
+        }
     }
+    // AcceptToMemoryPool/addUnchecked all assume that new mempool entries have
+    // no in-mempool children, which is generally not true when adding
+    // previously-confirmed transactions back to the mempool.
+    // UpdateTransactionsFromBlock finds descendants of any transactions in this
+    // block that were added back and cleans up the mempool state.
+    mempool.UpdateTransactionsFromBlock(vHashUpdate);
     if (anchorBeforeDisconnect != anchorAfterDisconnect) {
         // The anchor may not change between block disconnects,
         // in which case we don't want to evict from the mempool yet!
@@ -2611,11 +3075,166 @@ bool static DisconnectTip(CValidationState &state) {
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
 
+namespace {
+
+/** Entries of the chainstate database a prefetch thread should read at least */
+const size_t PREFETCH_ENTRIES_PER_THREAD = 4;
+
+/**
+ * The coins, nullifiers and anchors a block refers to that pcoinsTip does not
+ * have, and what the chainstate database holds for them. The threads reading
+ * them each fill their own slots, so they need no lock.
+ */
+struct CBlockPrefetch
+{
+    std::vector<uint256> txids;
+    std::vector<uint256> nullifiers;
+    std::vector<uint256> anchors;
+
+    std::vector<CCoins> coins;
+    std::vector<ZCIncrementalMerkleTree> trees;
+    // Read results; char rather than bool, as threads write neighbouring slots
+    std::vector<char> vHaveCoins;
+    std::vector<char> vSpent;
+    std::vector<char> vReadNullifier;
+    std::vector<char> vHaveTree;
+
+    size_t size() const { return txids.size() + nullifiers.size() + anchors.size(); }
+
+    void Resize()
+    {
+        coins.resize(txids.size());
+        vHaveCoins.resize(txids.size(), false);
+        vSpent.resize(nullifiers.size(), false);
+        vReadNullifier.resize(nullifiers.size(), false);
+        trees.resize(anchors.size());
+        vHaveTree.resize(anchors.size(), false);
+    }
+
+    //! Read every nThreads-th entry of each list, starting at nThread
+    void Read(size_t nThread, size_t nThreads)
+    {
+        try {
+            for (size_t i = nThread; i < txids.size(); i += nThreads)
+                vHaveCoins[i] = pcoinsdbview->GetCoins(txids[i], coins[i]);
+            for (size_t i = nThread; i < nullifiers.size(); i += nThreads) {
+                vSpent[i] = pcoinsdbview->GetNullifier(nullifiers[i]);
+                vReadNullifier[i] = true;
+            }
+            for (size_t i = nThread; i < anchors.size(); i += nThreads)
+                vHaveTree[i] = pcoinsdbview->GetAnchorAt(anchors[i], trees[i]);
+        } catch (const std::exception& e) {
+            // What was not read is read again by ConnectBlock, through the
+            // error catcher of pcoinsTip
+            LogPrint("bench", "Prefetching block inputs failed: %s\n", e.what());
+        }
+    }
+};
+
+/** Reads one share of a CBlockPrefetch, for prefetchqueue */
+class CPrefetchCheck
+{
+private:
+    CBlockPrefetch* pprefetch;
+    size_t nThread;
+    size_t nThreads;
+
+public:
+    CPrefetchCheck() : pprefetch(NULL), nThread(0), nThreads(0) {}
+    CPrefetchCheck(CBlockPrefetch& prefetchIn, size_t nThreadIn, size_t nThreadsIn) :
+        pprefetch(&prefetchIn), nThread(nThreadIn), nThreads(nThreadsIn) {}
+
+    bool operator()() {
+        pprefetch->Read(nThread, nThreads);
+        return true;
+    }
+
+    void swap(CPrefetchCheck &other) {
+        std::swap(pprefetch, other.pprefetch);
+        std::swap(nThread, other.nThread);
+        std::swap(nThreads, other.nThreads);
+    }
+};
+
+} // anon namespace
+
+static CCheckQueue<CPrefetchCheck> prefetchqueue(1);
+
+void ThreadPrefetch() {
+    RenameThread("zcash-prefetch");
+    prefetchqueue.Thread();
+}
+
+/**
+ * Read the coins, nullifiers and anchors spent or referred to by a block from
+ * the chainstate database into pcoinsTip, on the prefetch threads at once, rather
+ * than one at a time as ConnectBlock would look them up. The caller holds
+ * cs_main throughout, so the cache and the database do not change meanwhile.
+ * Returns the number of entries read.
+ */
+static size_t PrefetchBlockInputs(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    if (nPrefetchThreads <= 0 || pcoinsdbview == NULL)
+        return 0;
+
+    CBlockPrefetch prefetch;
+    std::set<uint256> setBlockTxids;
+    BOOST_FOREACH(const CTransaction& tx, block.vtx) {
+        setBlockTxids.insert(tx.GetHash());
+        if (!tx.IsCoinBase()) {
+            BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+                // Outputs created earlier in the block are not in the database
+                if (!setBlockTxids.count(txin.prevout.hash))
+                    prefetch.txids.push_back(txin.prevout.hash);
+            }
+        }
+        BOOST_FOREACH(const JSDescription& joinsplit, tx.vjoinsplit) {
+            prefetch.nullifiers.insert(prefetch.nullifiers.end(), joinsplit.nullifiers.begin(), joinsplit.nullifiers.end());
+            prefetch.anchors.push_back(joinsplit.anchor);
+        }
+    }
+    std::sort(prefetch.txids.begin(), prefetch.txids.end());
+    prefetch.txids.erase(std::unique(prefetch.txids.begin(), prefetch.txids.end()), prefetch.txids.end());
+    std::sort(prefetch.anchors.begin(), prefetch.anchors.end());
+    prefetch.anchors.erase(std::unique(prefetch.anchors.begin(), prefetch.anchors.end()), prefetch.anchors.end());
+    pcoinsTip->FilterCached(prefetch.txids, prefetch.nullifiers, prefetch.anchors);
+
+    // A few lookups are left to ConnectBlock, not worth starting threads for
+    size_t nThreads = std::min((size_t)nPrefetchThreads, prefetch.size() / PREFETCH_ENTRIES_PER_THREAD);
+    if (nThreads < 2)
+        return 0;
+
+    prefetch.Resize();
+    std::vector<CPrefetchCheck> vChecks;
+    for (size_t t = 0; t < nThreads; t++)
+        vChecks.push_back(CPrefetchCheck(prefetch, t, nThreads));
+    CCheckQueueControl<CPrefetchCheck> control(&prefetchqueue);
+    control.Add(vChecks);
+    control.Wait();
+
+    for (size_t i = 0; i < prefetch.txids.size(); i++) {
+        if (prefetch.vHaveCoins[i])
+            pcoinsTip->AddFetchedCoins(prefetch.txids[i], prefetch.coins[i]);
+    }
+    for (size_t i = 0; i < prefetch.nullifiers.size(); i++) {
+        // A nullifier that was not read must not be cached as unspent
+        if (prefetch.vReadNullifier[i])
+            pcoinsTip->AddFetchedNullifier(prefetch.nullifiers[i], prefetch.vSpent[i]);
+    }
+    for (size_t i = 0; i < prefetch.anchors.size(); i++) {
+        if (prefetch.vHaveTree[i])
+            pcoinsTip->AddFetchedAnchor(prefetch.anchors[i], prefetch.trees[i]);
+    }
+    return prefetch.size();
+}
+
 /**
  * Connect a new block to chainActive. pblock is either NULL or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
@@ -2638,6 +3257,10 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    size_t nPrefetched = PrefetchBlockInputs(*pblock);
+    int64_t nTimePrefetched = GetTimeMicros(); nTimePrefetch += nTimePrefetched - nTime2;
+    LogPrint("bench", "  - Prefetch %u chainstate entries: %.2fms [%.2fs]\n", nPrefetched, (nTimePrefetched - nTime2) * 0.001, nTimePrefetch * 0.000001);
+    nTime2 = nTimePrefetched;
     {
         CCoinsViewCache view(pcoinsTip);
         bool rv = ConnectBlock(*pblock, state, pindexNew, view, chainActive);
@@ -2766,10 +3389,15 @@ static bool ActivateBestChainStep(CValidationState &state, CBlockIndex *pindexMo
     const CBlockIndex *pindexFork = chainActive.FindFork(pindexMostWork);
 
     // Disconnect active blocks which are no longer in the best chain.
+    bool fBlocksDisconnected = false;
     while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
         if (!DisconnectTip(state))
             return false;
+        fBlocksDisconnected = true;
     }
+    // Resurrected transactions were let in over the mempool limit
+    if (fBlocksDisconnected)
+        LimitMempoolSize(mempool, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
 
     // Build list of new blocks to connect.
     std::vector<CBlockIndex*> vpindexToConnect;
@@ -2902,6 +3530,8 @@ bool InvalidateBlock(CValidationState& state, CBlockIndex *pindex) {
         }
     }
 
+    LimitMempoolSize(mempool, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+
     // The resulting new best tip may not be in setBlockIndexCandidates anymore, so
     // add it again.
     BlockMap::iterator it = mapBlockIndex.begin();
@@ -3117,7 +3747,7 @@ bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigne
     return true;
 }
 
-bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW)
+bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW, bool fCheckSolution)
 {
     // Check block version
     if (block.nVersion < MIN_BLOCK_VERSION)
@@ -3125,7 +3755,7 @@ bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool f
                          REJECT_INVALID, "version-too-low");
 
     // Check Equihash solution is valid
-    if (fCheckPOW && !CheckEquihashSolution(&block, Params()))
+    if (fCheckPOW && fCheckSolution && !CheckEquihashSolution(&block, Params()))
         return state.DoS(100, error("CheckBlockHeader(): Equihash solution invalid"),
                          REJECT_INVALID, "invalid-solution");
 
@@ -3142,11 +3772,17 @@ bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool f
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state,
-                libzcash::ProofVerifier& verifier,
-                bool fCheckPOW, bool fCheckMerkleRoot)
+/**
+ * The checks of CheckBlock that depend on neither the chain nor the time of
+ * checking (bar the timestamp, which only gets more acceptable). Once passed
+ * with both flags set, the block is marked, and CheckBlock, AcceptBlockHeader
+ * and ConnectBlock do not repeat them, in particular the Equihash solution.
+ */
+static bool CheckBlockHeaderAndMerkleRoot(const CBlock& block, CValidationState& state,
+                                          bool fCheckPOW = true, bool fCheckMerkleRoot = true)
 {
-    // These are checks that are independent of context.
+    if (block.fChecked && fCheckPOW && fCheckMerkleRoot)
+        return true;
 
     // Check that the header is valid (particularly PoW).  This is mostly
     // redundant with the call in AcceptBlockHeader.
@@ -3156,7 +3792,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state,
     // Check the merkle root.
     if (fCheckMerkleRoot) {
         bool mutated;
-        uint256 hashMerkleRoot2 = block.BuildMerkleTree(&mutated);
+        uint256 hashMerkleRoot2 = block.BuildMerkleTree(&mutated, HashMerkleLevel);
         if (block.hashMerkleRoot != hashMerkleRoot2)
             return state.DoS(100, error("CheckBlock(): hashMerkleRoot mismatch"),
                              REJECT_INVALID, "bad-txnmrklroot", true);
@@ -3169,6 +3805,20 @@ bool CheckBlock(const CBlock& block, CValidationState& state,
                              REJECT_INVALID, "bad-txns-duplicate", true);
     }
 
+    if (fCheckPOW && fCheckMerkleRoot)
+        block.fChecked = true;
+    return true;
+}
+
+bool CheckBlock(const CBlock& block, CValidationState& state,
+                libzcash::ProofVerifier& verifier,
+                bool fCheckPOW, bool fCheckMerkleRoot)
+{
+    // These are checks that are independent of context.
+
+    if (!CheckBlockHeaderAndMerkleRoot(block, state, fCheckPOW, fCheckMerkleRoot))
+        return false;
+
     // All potential-corruption validation must be done before we do any
     // transaction validation, as otherwise we may mark the header as invalid
     // because we receive the wrong transactions for it.
@@ -3305,7 +3955,7 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
     return true;
 }
 
-bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex** ppindex)
+bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex** ppindex, bool fCheckSolution)
 {
     const CChainParams& chainparams = Params();
     AssertLockHeld(cs_main);
@@ -3323,7 +3973,7 @@ bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBloc
         return true;
     }
 
-    if (!CheckBlockHeader(block, state))
+    if (!CheckBlockHeader(block, state, true, fCheckSolution))
         return false;
 
     // Get prev block index
@@ -3356,7 +4006,7 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
 
     CBlockIndex *&pindex = *ppindex;
 
-    if (!AcceptBlockHeader(block, state, &pindex))
+    if (!AcceptBlockHeader(block, state, &pindex, !block.fChecked))
         return false;
 
     // Try to process all requested blocks that we don't have, but only
@@ -3536,6 +4186,8 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune)
 {
     for (set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        // Free the disk space now, not when the mapping would have gone
+        mapBlockFiles.Release(*it);
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -3751,6 +4403,14 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
 
+    // Check whether we have the address, spent and timestamp indexes
+    pblocktree->ReadFlag("addressindex", fAddressIndex);
+    LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
+    pblocktree->ReadFlag("spentindex", fSpentIndex);
+    LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
+    pblocktree->ReadFlag("timestampindex", fTimestampIndex);
+    LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
+
     // Fill in-memory data
     BOOST_FOREACH(const PAIRTYPE(uint256, CBlockIndex*)& item, mapBlockIndex)
     {
@@ -3840,7 +4500,7 @@ bool CVerifyDB::VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
             bool fClean = true;
-            if (!DisconnectBlock(block, state, pindex, coins, &fClean))
+            if (!DisconnectBlock(block, state, pindex, coins, &fClean, true))
                 return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
             pindexState = pindex->pprev;
             if (!fClean) {
@@ -3935,6 +4595,12 @@ bool InitBlockIndex() {
     // Use the provided setting for -txindex in the new database
     fTxIndex = GetBoolArg("-txindex", false);
     pblocktree->WriteFlag("txindex", fTxIndex);
+    fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+    pblocktree->WriteFlag("addressindex", fAddressIndex);
+    fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+    pblocktree->WriteFlag("spentindex", fSpentIndex);
+    fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
+    pblocktree->WriteFlag("timestampindex", fTimestampIndex);
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -3966,21 +4632,105 @@ bool InitBlockIndex() {
 
 
 
-bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos *dbp)
+namespace {
+
+/** A block read from a block file, on its way through CBlockImporter */
+struct CImportedBlock
 {
-    const CChainParams& chainparams = Params();
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
-    int64_t nStart = GetTimeMillis();
+    CDiskBlockPos pos;
+    unsigned int nSize;
+    CDataStream ssRaw;
+    CBlock block;
+    //! Deserialized and checked, or found invalid (the worker is done with it)
+    bool fDecoded;
+    //! Deserialized successfully
+    bool fValid;
+    std::string strError;
 
-    int nLoaded = 0;
+    CImportedBlock() : nSize(0), ssRaw(SER_DISK, CLIENT_VERSION), fDecoded(false), fValid(false) {}
+};
+
+/**
+ * The pipeline behind LoadExternalBlockFile. A reader thread locates the
+ * blocks in the file and reads them as raw bytes, worker threads deserialize
+ * them and check their header (Equihash solution included) and merkle root,
+ * and the calling thread takes them in file order to process them.
+ *
+ * The bytes of the blocks read but not yet taken are limited to nMaxBytes,
+ * so memory stays bounded however far the reader gets ahead. All state is
+ * guarded by cs, and every change of it is signalled on cond.
+ */
+class CBlockImporter
+{
+private:
+    CBufferedFile& blkdat;
+    const int nFile;
+    const size_t nMaxBytes;
+
+    boost::mutex cs;
+    boost::condition_variable cond;
+    //! Blocks in file order, the front one to be taken next
+    std::deque<std::shared_ptr<CImportedBlock> > queue;
+    //! Index in queue of the next block to deserialize
+    size_t nNextDecode;
+    size_t nBytes;
+    bool fReaderDone;
+    bool fStop;
+    std::string strReadError;
+    boost::thread_group threads;
+
+    void ThreadRead();
+    void ThreadDecode();
+
+public:
+    CBlockImporter(CBufferedFile& blkdatIn, int nFileIn, size_t nMaxBytesIn) :
+        blkdat(blkdatIn), nFile(nFileIn), nMaxBytes(nMaxBytesIn), nNextDecode(0), nBytes(0),
+        fReaderDone(false), fStop(false) {}
+
+    ~CBlockImporter()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            fStop = true;
+            cond.notify_all();
+        }
+        threads.join_all();
+    }
+
+    void Start(int nWorkers)
+    {
+        threads.create_thread(boost::bind(&CBlockImporter::ThreadRead, this));
+        for (int i = 0; i < nWorkers; i++)
+            threads.create_thread(boost::bind(&CBlockImporter::ThreadDecode, this));
+    }
+
+    /** The next block in file order, or NULL at the end of the file */
+    std::shared_ptr<CImportedBlock> Next()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        while (queue.empty() ? !fReaderDone : !queue.front()->fDecoded)
+            cond.wait(lock);
+        if (queue.empty()) {
+            if (!strReadError.empty())
+                throw std::runtime_error(strReadError);
+            return std::shared_ptr<CImportedBlock>();
+        }
+        std::shared_ptr<CImportedBlock> pitem = queue.front();
+        queue.pop_front();
+        nNextDecode--;
+        nBytes -= pitem->nSize;
+        cond.notify_all();
+        return pitem;
+    }
+};
+
+void CBlockImporter::ThreadRead()
+{
+    RenameThread("zcash-loadblk-read");
+    const CChainParams& chainparams = Params();
     try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
         while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
             blkdat.SetPos(nRewind);
             nRewind++; // start one byte further next time, in case of failure
             blkdat.SetLimit(); // remove former limit
@@ -3988,10 +4738,10 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos *dbp)
             try {
                 // locate a header
                 unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
+                blkdat.FindByte(chainparams.MessageStart()[0]);
                 nRewind = blkdat.GetPos()+1;
                 blkdat >> FLATDATA(buf);
-                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
+                if (memcmp(buf, chainparams.MessageStart(), MESSAGE_START_SIZE))
                     continue;
                 // read size
                 blkdat >> nSize;
@@ -4001,17 +4751,109 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos *dbp)
                 // no valid block header found; don't complain
                 break;
             }
+            std::shared_ptr<CImportedBlock> pitem = std::make_shared<CImportedBlock>();
             try {
-                // read block
+                // read block, in pieces: the rewind margin of blkdat leaves
+                // no room for a maximum size block in one read
                 uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
+                pitem->pos = CDiskBlockPos(nFile, nBlockPos);
+                pitem->nSize = nSize;
                 blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
+                pitem->ssRaw.resize(nSize);
+                for (unsigned int nRead = 0; nRead < nSize; ) {
+                    unsigned int nChunk = std::min(nSize - nRead, 65536U);
+                    blkdat.read(&pitem->ssRaw[nRead], nChunk);
+                    nRead += nChunk;
+                }
                 nRewind = blkdat.GetPos();
+            } catch (const std::exception& e) {
+                LogPrintf("LoadExternalBlockFile: Deserialize or I/O error - %s\n", e.what());
+                continue;
+            }
+
+            boost::unique_lock<boost::mutex> lock(cs);
+            // The first block is let in whatever its size
+            while (!fStop && nBytes > 0 && nBytes + nSize > nMaxBytes)
+                cond.wait(lock);
+            if (fStop)
+                break;
+            nBytes += nSize;
+            queue.push_back(pitem);
+            cond.notify_all();
+        }
+    } catch (const std::runtime_error& e) {
+        boost::unique_lock<boost::mutex> lock(cs);
+        strReadError = e.what();
+    }
+    boost::unique_lock<boost::mutex> lock(cs);
+    fReaderDone = true;
+    cond.notify_all();
+}
+
+void CBlockImporter::ThreadDecode()
+{
+    RenameThread("zcash-loadblk-check");
+    while (true) {
+        std::shared_ptr<CImportedBlock> pitem;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            while (!fStop && !fReaderDone && nNextDecode == queue.size())
+                cond.wait(lock);
+            if (fStop || nNextDecode == queue.size())
+                return;
+            pitem = queue[nNextDecode++];
+        }
 
+        try {
+            pitem->ssRaw >> pitem->block;
+            pitem->fValid = true;
+            // A failure is reported when the block is processed
+            CValidationState state;
+            CheckBlockHeaderAndMerkleRoot(pitem->block, state);
+        } catch (const std::exception& e) {
+            pitem->strError = e.what();
+        }
+        pitem->ssRaw = CDataStream(SER_DISK, CLIENT_VERSION);
+
+        boost::unique_lock<boost::mutex> lock(cs);
+        pitem->fDecoded = true;
+        cond.notify_all();
+    }
+}
+
+} // anon namespace
+
+bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos *dbp)
+{
+    const CChainParams& chainparams = Params();
+    // Map of disk positions for blocks with unknown parent (only used for reindex)
+    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+    int64_t nStart = GetTimeMillis();
+    size_t nMaxBytes = std::max((int64_t)1, GetArg("-importbuffer", DEFAULT_IMPORT_BUFFER)) << 20;
+
+    int nLoaded = 0;
+    uint64_t nBytesRead = 0;
+    try {
+        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
+        CBlockImporter importer(blkdat, dbp ? dbp->nFile : -1, nMaxBytes);
+        importer.Start(std::max(1, nScriptCheckThreads));
+        std::shared_ptr<CImportedBlock> pitem;
+        while ((pitem = importer.Next())) {
+            boost::this_thread::interruption_point();
+
+            if (!pitem->fValid) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, pitem->strError);
+                continue;
+            }
+            nBytesRead += pitem->nSize;
+            CBlock& block = pitem->block;
+            CDiskBlockPos* pblockpos = NULL;
+            if (dbp) {
+                *dbp = pitem->pos;
+                pblockpos = &pitem->pos;
+            }
+            try {
                 // detect out of order blocks, and store them for later
                 uint256 hash = block.GetHash();
                 if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
@@ -4025,7 +4867,7 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos *dbp)
                 // process in case the block isn't known yet
                 if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
                     CValidationState state;
-                    if (ProcessNewBlock(state, NULL, &block, true, dbp))
+                    if (ProcessNewBlock(state, NULL, &block, true, pblockpos))
                         nLoaded++;
                     if (state.IsError())
                         break;
@@ -4064,8 +4906,11 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos *dbp)
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
-    if (nLoaded > 0)
-        LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+    if (nLoaded > 0) {
+        int64_t nElapsed = std::max((int64_t)1, GetTimeMillis() - nStart);
+        LogPrintf("Loaded %i blocks from external file in %dms (%.1f blocks/s, %.1f MB/s)\n", nLoaded, nElapsed,
+                  nLoaded * 1000.0 / nElapsed, nBytesRead * 1000.0 / nElapsed / 1000000);
+    }
     return nLoaded > 0;
 }
 
@@ -4411,14 +5256,19 @@ void static ProcessGetData(CNode* pfrom)
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
-                    // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second))
-                        assert(!"cannot load block from disk");
+                    // Send block from disk, as it is stored
                     if (inv.type == MSG_BLOCK)
+                    {
+                        CRawBlock block;
+                        if (!ReadRawBlockFromDisk(block, (*mi).second))
+                            assert(!"cannot load block from disk");
                         pfrom->PushMessage("block", block);
+                    }
                     else // MSG_FILTERED_BLOCK)
                     {
+                        CBlock block;
+                        if (!ReadBlockFromDisk(block, (*mi).second))
+                            assert(!"cannot load block from disk");
                         LOCK(pfrom->cs_filter);
                         if (pfrom->pfilter)
                         {
@@ -5034,6 +5884,24 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        // Verify the Equihash solutions of the headers we do not know yet in
+        // parallel, before taking cs_main. If any of them fails, every header
+        // is checked again one by one below, which finds the culprit.
+        bool fSolutionsValid = false;
+        if (nCount > 0) {
+            int64_t nTimeStart = GetTimeMicros();
+            std::vector<const CBlockHeader*> vUnknown;
+            {
+                LOCK(cs_main);
+                BOOST_FOREACH(const CBlockHeader& header, headers)
+                    if (!mapBlockIndex.count(header.GetHash()))
+                        vUnknown.push_back(&header);
+            }
+            fSolutionsValid = CheckEquihashSolutions(vUnknown);
+            LogPrint("bench", "    - Verify %u Equihash solutions: %.2fms (%.3fms/header)\n", (unsigned)vUnknown.size(),
+                     0.001 * (GetTimeMicros() - nTimeStart), vUnknown.empty() ? 0 : 0.001 * (GetTimeMicros() - nTimeStart) / vUnknown.size());
+        }
+
         LOCK(cs_main);
 
         if (nCount == 0) {
@@ -5048,7 +5916,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 Misbehaving(pfrom->GetId(), 20);
                 return error("non-continuous headers sequence");
             }
-            if (!AcceptBlockHeader(header, state, &pindexLast)) {
+            if (!AcceptBlockHeader(header, state, &pindexLast, !fSolutionsValid)) {
                 int nDoS;
                 if (state.IsInvalid(nDoS)) {
                     if (nDoS > 0)
@@ -5347,6 +6215,141 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     return true;
 }
 
+const int64_t CMessageStats::BUCKET_BOUNDS[CMessageStats::NUM_BUCKETS - 1] = {10, 100, 1000, 10000, 100000, 1000000};
+
+namespace {
+
+/** Maximum number of messages waiting for a message check thread */
+const size_t MAX_MESSAGE_CHECK_QUEUE = 1000;
+/** Maximum number of commands with statistics of their own; the others are counted together */
+const size_t MAX_MESSAGE_STATS_COMMANDS = 64;
+
+/**
+ * Queue of the checks run on the message check threads: the checksum of
+ * received transactions and blocks, and the joinsplit proofs of received
+ * transactions. These checks do not depend on the chain or on the peer, and
+ * verifying proofs can take a long time; running them on the message handler
+ * thread held up the messages of every other peer meanwhile. The message
+ * handler only waits for them before processing the other messages of the
+ * same peer.
+ */
+class CMessageCheckQueue
+{
+private:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::deque<boost::function<void()> > queue;
+
+public:
+    bool Add(const boost::function<void()>& check)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (queue.size() >= MAX_MESSAGE_CHECK_QUEUE)
+            return false;
+        queue.push_back(check);
+        cond.notify_one();
+        return true;
+    }
+
+    void Thread()
+    {
+        while (true) {
+            boost::function<void()> check;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (queue.empty())
+                    cond.wait(lock);
+                check = queue.front();
+                queue.pop_front();
+            }
+            check();
+        }
+    }
+};
+
+CMessageCheckQueue messagecheckqueue;
+
+CCriticalSection cs_messageStats;
+std::map<std::string, CMessageStats> mapMessageStats;
+
+void CheckMessage(std::shared_ptr<CNetMessageCheck> check, const std::string& strCommand, std::shared_ptr<CDataStream> pvRecv)
+{
+    CDataStream& vRecv = *pvRecv;
+    uint256 hash = Hash(vRecv.begin(), vRecv.end());
+    check->nChecksum = ReadLE32(hash.begin());
+
+    if (strCommand == "tx") {
+        try {
+            CTransaction tx;
+            vRecv >> tx;
+            if (!tx.vjoinsplit.empty() && !mempool.exists(tx.GetHash())) {
+                auto verifier = libzcash::ProofVerifier::Strict();
+                bool fValid = true;
+                BOOST_FOREACH(const JSDescription& joinsplit, tx.vjoinsplit) {
+                    if (!joinsplit.Verify(*pzcashParams, verifier, tx.joinSplitPubKey)) {
+                        fValid = false;
+                        break;
+                    }
+                }
+                // Invalid proofs are verified and reported again by ProcessMessage
+                if (fValid)
+                    AddVerifiedProofs(tx.GetHash());
+            }
+        } catch (const std::exception&) {
+            // Malformed messages are reported by ProcessMessage
+        }
+    }
+
+    check->fDone = true;
+    WakeMessageHandler();
+}
+
+/** Queue a received message for CheckMessage; returns false if it is to be checked inline */
+bool QueueMessageCheck(CNetMessage& msg)
+{
+    if (!nMessageCheckThreads)
+        return false;
+    std::string strCommand = msg.hdr.GetCommand();
+    if (strCommand != "tx" && strCommand != "block")
+        return false;
+
+    std::shared_ptr<CNetMessageCheck> check = std::make_shared<CNetMessageCheck>();
+    // The check gets a copy of the data, as the peer may be disconnected meanwhile
+    std::shared_ptr<CDataStream> vRecv = std::make_shared<CDataStream>(msg.vRecv.begin(), msg.vRecv.begin() + msg.hdr.nMessageSize, msg.vRecv.GetType(), msg.vRecv.GetVersion());
+    if (!messagecheckqueue.Add(boost::bind(&CheckMessage, check, strCommand, vRecv)))
+        return false;
+    msg.check = check;
+    return true;
+}
+
+void RecordMessageStats(const std::string& strCommand, int64_t nMicros, int64_t nWaitMicros)
+{
+    LOCK(cs_messageStats);
+    std::map<std::string, CMessageStats>::iterator it = mapMessageStats.find(strCommand);
+    if (it == mapMessageStats.end()) {
+        // Peers choose the commands they send
+        if (mapMessageStats.size() >= MAX_MESSAGE_STATS_COMMANDS)
+            it = mapMessageStats.insert(std::make_pair(std::string("[other]"), CMessageStats())).first;
+        else
+            it = mapMessageStats.insert(std::make_pair(strCommand, CMessageStats())).first;
+    }
+    it->second.Add(nMicros, std::max<int64_t>(0, nWaitMicros));
+}
+
+} // anon namespace
+
+void ThreadMessageCheck()
+{
+    RenameThread("zcash-msgcheck");
+    messagecheckqueue.Thread();
+}
+
+void GetMessageStats(std::map<std::string, CMessageStats>& mapStats)
+{
+    LOCK(cs_messageStats);
+    mapStats = mapMessageStats;
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool ProcessMessages(CNode* pfrom)
 {
@@ -5387,6 +6390,12 @@ bool ProcessMessages(CNode* pfrom)
         if (!msg.complete())
             break;
 
+        // end, if the message is being checked on a message check thread
+        if (!msg.check && QueueMessageCheck(msg))
+            break;
+        if (msg.checking())
+            break;
+
         // at this point, any failure means we can delete the current message
         it++;
 
@@ -5411,8 +6420,13 @@ bool ProcessMessages(CNode* pfrom)
 
         // Checksum
         CDataStream& vRecv = msg.vRecv;
-        uint256 hash = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
-        unsigned int nChecksum = ReadLE32((unsigned char*)&hash);
+        unsigned int nChecksum;
+        if (msg.check) {
+            nChecksum = msg.check->nChecksum;
+        } else {
+            uint256 hash = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
+            nChecksum = ReadLE32((unsigned char*)&hash);
+        }
         if (nChecksum != hdr.nChecksum)
         {
             LogPrintf("%s(%s, %u bytes): CHECKSUM ERROR nChecksum=%08x hdr.nChecksum=%08x\n", __func__,
@@ -5422,6 +6436,7 @@ bool ProcessMessages(CNode* pfrom)
 
         // Process message
         bool fRet = false;
+        int64_t nTimeStart = GetTimeMicros();
         try
         {
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
@@ -5453,6 +6468,7 @@ bool ProcessMessages(CNode* pfrom)
         } catch (...) {
             PrintExceptionContinue(NULL, "ProcessMessages()");
         }
+        RecordMessageStats(strCommand, GetTimeMicros() - nTimeStart, nTimeStart - msg.nTime);
 
         if (!fRet)
             LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
@@ -10,7 +10,9 @@
 #include "config/bitcoin-config.h"
 #endif
 
+#include "addressindex.h"
 #include "amount.h"
+#include "blockfilemap.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "coins.h"
@@ -21,7 +23,9 @@
 #include "script/script.h"
 #include "script/sigcache.h"
 #include "script/standard.h"
+#include "spentindex.h"
 #include "sync.h"
+#include "timestampindex.h"
 #include "tinyformat.h"
 #include "txmempool.h"
 #include "uint256.h"
@@ -40,6 +44,7 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CCoinsViewDB;
 class CBloomFilter;
 class CInv;
 class CScriptCheck;
@@ -47,6 +52,7 @@ class CValidationInterface;
 class CValidationState;
 
 struct CNodeStateStats;
+struct CMessageStats;
 
 /** Default for -blockmaxsize and -blockminsize, which control the range of sizes the mining code will create **/
 static const unsigned int DEFAULT_BLOCK_MAX_SIZE = MAX_BLOCK_SIZE;
@@ -65,6 +71,22 @@ static const unsigned int MAX_STANDARD_TX_SIGOPS = MAX_BLOCK_SIGOPS/5;
 static const unsigned int DEFAULT_MIN_RELAY_TX_FEE = 100;
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
+/** Default for -limitancestorcount, max number of in-mempool ancestors */
+static const unsigned int DEFAULT_ANCESTOR_LIMIT = 25;
+/** Default for -limitancestorsize, maximum kilobytes of tx + all in-mempool ancestors */
+static const unsigned int DEFAULT_ANCESTOR_SIZE_LIMIT = 101;
+/** Default for -limitdescendantcount, max number of in-mempool descendants */
+static const unsigned int DEFAULT_DESCENDANT_LIMIT = 25;
+/** Default for -limitdescendantsize, maximum kilobytes of in-mempool descendants */
+static const unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = 101;
+/** Default for -maxmempool, maximum megabytes of mempool memory usage */
+static const unsigned int DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** Default for -mempoolexpiry, expiration time for mempool transactions in hours */
+static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 72;
+/** Defaults for -addressindex, -spentindex and -timestampindex */
+static const bool DEFAULT_ADDRESSINDEX = false;
+static const bool DEFAULT_SPENTINDEX = false;
+static const bool DEFAULT_TIMESTAMPINDEX = false;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
@@ -75,6 +97,16 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of threads reading a block's inputs before it is connected */
+static const int MAX_PREFETCH_THREADS = 64;
+/** -prefetchthreads default (0 = do not prefetch) */
+static const int DEFAULT_PREFETCH_THREADS = 8;
+/** Maximum number of threads checking received messages ahead of their processing */
+static const int MAX_MESSAGE_CHECK_THREADS = 16;
+/** -msgcheckthreads default (0 = check on the message handler thread) */
+static const int DEFAULT_MESSAGE_CHECK_THREADS = 2;
+/** -importbuffer default (megabytes of blocks read ahead of their processing by -reindex and -loadblock) */
+static const int64_t DEFAULT_IMPORT_BUFFER = 64;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -121,7 +153,12 @@ extern bool fExperimentalMode;
 extern bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
+extern int nPrefetchThreads;
+extern int nMessageCheckThreads;
 extern bool fTxIndex;
+extern bool fAddressIndex;
+extern bool fSpentIndex;
+extern bool fTimestampIndex;
 extern bool fIsBareMultisigStd;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
@@ -203,6 +240,16 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the JoinSplit proof checking thread */
+void ThreadProofCheck();
+/** Run an instance of the Equihash solution checking thread */
+void ThreadEquihashCheck();
+/** Run an instance of the merkle tree hashing thread */
+void ThreadMerkleCheck();
+/** Run an instance of the thread reading block inputs ahead of ConnectBlock */
+void ThreadPrefetch();
+/** Run an instance of the thread checking received transactions and blocks ahead of their processing */
+void ThreadMessageCheck();
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader, int64_t nPowTargetSpacing);
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -211,6 +258,17 @@ bool IsInitialBlockDownload();
 std::string GetWarnings(const std::string& strFor);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256 &hash, CTransaction &tx, uint256 &hashBlock, bool fAllowSlow = false);
+/** Look up the outputs credited and debited to a transparent address, optionally within a range of heights (-addressindex) */
+bool GetAddressIndex(const uint160 &addressHash, unsigned int type,
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                     int start = 0, int end = 0);
+/** Look up the unspent outputs paying to a transparent address (-addressindex) */
+bool GetAddressUnspent(const uint160 &addressHash, unsigned int type,
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+/** Look up the input spending a transparent output (-spentindex) */
+bool GetSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value);
+/** Look up the active chain blocks with a header time in [low, high) (-timestampindex) */
+bool GetTimestampIndex(unsigned int high, unsigned int low, std::vector<uint256> &hashes);
 /** Find the best known block, and make it the tip of the block chain */
 bool ActivateBestChain(CValidationState &state, CBlock *pblock = NULL);
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
@@ -241,6 +299,10 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune);
 CBlockIndex * InsertBlockIndex(uint256 hash);
 /** Get statistics from node state */
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
+/** Get the processing latency statistics of the received messages, per command */
+void GetMessageStats(std::map<std::string, CMessageStats>& mapStats);
+/** Record that the JoinSplit proofs of a transaction verify, for its next AcceptToMemoryPool to skip them */
+void AddVerifiedProofs(const uint256& txid);
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch);
 /** Flush all state, indexes and buffers to disk. */
@@ -248,9 +310,12 @@ void FlushStateToDisk();
 /** Prune block files and flush state to disk. */
 void PruneAndFlush();
 
+/** Expire transactions older than age seconds, then trim the pool to limit bytes of memory usage */
+void LimitMempoolSize(CTxMemPool& pool, size_t limit, unsigned long age);
+
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
-                        bool* pfMissingInputs, bool fRejectAbsurdFee=false);
+                        bool* pfMissingInputs, bool fRejectAbsurdFee=false, bool fOverrideMempoolLimit=false);
 
 /** Get the BIP9 state for a given deployment at the current tip. */
 ThresholdState VersionBitsTipState(const Consensus::Params& params, Consensus::DeploymentPos pos);
@@ -265,6 +330,39 @@ struct CNodeStateStats {
     std::vector<int> vHeightInFlight;
 };
 
+/** Processing latency of the received messages of one command */
+struct CMessageStats {
+    /** Upper bounds (in microseconds) of the latency histogram buckets; the last bucket is unbounded */
+    static const int NUM_BUCKETS = 7;
+    static const int64_t BUCKET_BOUNDS[NUM_BUCKETS - 1];
+
+    uint64_t nCount;
+    int64_t nTotalMicros;           // time spent in ProcessMessage
+    int64_t nMaxMicros;
+    int64_t nTotalWaitMicros;       // time between receipt and processing
+    int64_t nMaxWaitMicros;
+    uint64_t vBuckets[NUM_BUCKETS];
+
+    CMessageStats() : nCount(0), nTotalMicros(0), nMaxMicros(0), nTotalWaitMicros(0), nMaxWaitMicros(0)
+    {
+        for (int i = 0; i < NUM_BUCKETS; i++)
+            vBuckets[i] = 0;
+    }
+
+    void Add(int64_t nMicros, int64_t nWaitMicros)
+    {
+        nCount++;
+        nTotalMicros += nMicros;
+        nMaxMicros = std::max(nMaxMicros, nMicros);
+        nTotalWaitMicros += nWaitMicros;
+        nMaxWaitMicros = std::max(nMaxWaitMicros, nWaitMicros);
+        int i = 0;
+        while (i < NUM_BUCKETS - 1 && nMicros >= BUCKET_BOUNDS[i])
+            i++;
+        vBuckets[i]++;
+    }
+};
+
 struct CDiskTxPos : public CDiskBlockPos
 {
     unsigned int nTxOffset; // after header
@@ -401,11 +499,100 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing one JoinSplit proof verification, as recorded
+ * by a batch ProofVerifier.
+ */
+class CProofCheck
+{
+private:
+    libzcash::ProofVerifier::DeferredCheck check;
+
+public:
+    CProofCheck() {}
+    CProofCheck(const libzcash::ProofVerifier::DeferredCheck& checkIn) : check(checkIn) { }
+
+    bool operator()();
+
+    void swap(CProofCheck &other) {
+        check.swap(other.check);
+    }
+};
+
+/**
+ * Verify the proofs recorded by a batch ProofVerifier, spread over the
+ * proof checking threads when -par allows it. Requires cs_main.
+ */
+bool CheckDeferredProofs(libzcash::ProofVerifier& verifier);
+
+/**
+ * Closure representing the check of one header's Equihash solution; the
+ * header must outlive the check.
+ */
+class CEquihashCheck
+{
+private:
+    const CBlockHeader* pheader;
+
+public:
+    CEquihashCheck() : pheader(NULL) {}
+    CEquihashCheck(const CBlockHeader& headerIn) : pheader(&headerIn) {}
+
+    bool operator()();
+
+    void swap(CEquihashCheck &other) {
+        std::swap(pheader, other.pheader);
+    }
+};
+
+/**
+ * Verify the Equihash solutions of a batch of headers, spread over the
+ * header checking threads when -par allows it. Does not need cs_main, so
+ * a headers message can be checked before taking it.
+ */
+bool CheckEquihashSolutions(const std::vector<const CBlockHeader*>& vHeaders);
+
+/** Hashes a run of the pairs of a merkle tree level (see CBlock::BuildMerkleTree) */
+class CMerkleHashCheck
+{
+private:
+    unsigned char* out;
+    const unsigned char* in;
+    size_t nPairs;
+
+public:
+    CMerkleHashCheck() : out(NULL), in(NULL), nPairs(0) {}
+    CMerkleHashCheck(unsigned char* outIn, const unsigned char* inIn, size_t nPairsIn) :
+        out(outIn), in(inIn), nPairs(nPairsIn) {}
+
+    bool operator()();
+
+    void swap(CMerkleHashCheck &other) {
+        std::swap(out, other.out);
+        std::swap(in, other.in);
+        std::swap(nPairs, other.nPairs);
+    }
+};
+
+/**
+ * Hash the pairs of a merkle tree level, spread over the merkle hashing
+ * threads when the level is large and -par allows it. For use as the
+ * MerkleLevelHasher of CBlock::BuildMerkleTree.
+ */
+void HashMerkleLevel(unsigned char* out, const unsigned char* in, size_t nPairs);
+
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
+/**
+ * Get the serialized bytes of a block without deserializing it, from a
+ * mapping of its block file where possible. Only the header hash is checked,
+ * against the index; ReadBlockFromDisk also checks the proof of work.
+ */
+bool ReadRawBlockFromDisk(CRawBlock& block, const CDiskBlockPos& pos);
+bool ReadRawBlockFromDisk(CRawBlock& block, const CBlockIndex* pindex);
 
 
 /** Functions for validating blocks and updating the block tree */
@@ -413,14 +600,15 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  In case pfClean is provided, operation will try toс be tolerant about errors, and *pfClean
  *  will be true if no problems were found. Otherwise, the return value will be false in case
- *  of problems. Note that in any case, coins may be modified. */
-bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins, bool* pfClean = NULL);
+ *  of problems. Note that in any case, coins may be modified. Unless fJustCheck, the block is
+ *  also removed from the address, spent and timestamp indexes. */
+bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins, bool* pfClean = NULL, bool fJustCheck = false);
 
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins */
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins, const CChain& chain, bool fJustCheck = false);
 
-/** Context-independent validity checks */
-bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW = true);
+/** Context-independent validity checks. fCheckSolution = false skips an Equihash solution already verified by the caller. */
+bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW = true, bool fCheckSolution = true);
 bool CheckBlock(const CBlock& block, CValidationState& state,
                 libzcash::ProofVerifier& verifier,
                 bool fCheckPOW = true, bool fCheckMerkleRoot = true);
@@ -440,7 +628,7 @@ bool TestBlockValidity(CValidationState &state, const CBlock& block, CBlockIndex
  * If dbp is non-NULL, the file is known to already reside on disk
  */
 bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex **pindex, bool fRequested, CDiskBlockPos* dbp);
-bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex **ppindex= NULL);
+bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex **ppindex= NULL, bool fCheckSolution = true);
 
 
 
@@ -524,6 +712,9 @@ extern CCoinsViewCache *pcoinsTip;
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
+/** Global variable that points to the chainstate database below pcoinsTip (protected by cs_main) */
+extern CCoinsViewDB *pcoinsdbview;
+
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
  * While checking, GetBestBlock() refers to the parent block. (protected by cs_main)
@@ -5,6 +5,8 @@
 #ifndef BITCOIN_MEMUSAGE_H
 #define BITCOIN_MEMUSAGE_H
 
+#include "support/allocators/pool.h"
+
 #include <stdlib.h>
 
 #include <map>
@@ -74,18 +76,30 @@ static inline size_t DynamicUsage(const std::vector<X>& v)
     return MallocUsage(v.capacity() * sizeof(X));
 }
 
-template<typename X>
-static inline size_t DynamicUsage(const std::set<X>& s)
+template<typename X, typename Y>
+static inline size_t DynamicUsage(const std::set<X, Y>& s)
 {
     return MallocUsage(sizeof(stl_tree_node<X>)) * s.size();
 }
 
 template<typename X, typename Y>
-static inline size_t DynamicUsage(const std::map<X, Y>& m)
+static inline size_t IncrementalDynamicUsage(const std::set<X, Y>& s)
+{
+    return MallocUsage(sizeof(stl_tree_node<X>));
+}
+
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const std::map<X, Y, Z>& m)
 {
     return MallocUsage(sizeof(stl_tree_node<std::pair<const X, Y> >)) * m.size();
 }
 
+template<typename X, typename Y, typename Z>
+static inline size_t IncrementalDynamicUsage(const std::map<X, Y, Z>& m)
+{
+    return MallocUsage(sizeof(stl_tree_node<std::pair<const X, Y> >));
+}
+
 // Boost data structures
 
 template<typename X>
@@ -107,6 +121,19 @@ static inline size_t DynamicUsage(const boost::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(boost_unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+static inline size_t DynamicUsage(const CPoolResource& resource)
+{
+    // Chunk sizes are powers of two, to which malloc only adds its header
+    return resource.ChunkBytes() + resource.ChunkCount() * (MallocUsage(CPoolResource::MIN_CHUNK_SIZE) - CPoolResource::MIN_CHUNK_SIZE);
+}
+
+/** The nodes of a pooled map are accounted for by the chunks of its resource, free or not. */
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const boost::unordered_map<X, Y, Z, std::equal_to<X>, CPoolAllocator<std::pair<const X, Y> > >& m)
+{
+    return DynamicUsage(*m.get_allocator().resource) + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
 }
 
 #endif
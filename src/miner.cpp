@@ -27,6 +27,7 @@
 #include "ui_interface.h"
 #include "util.h"
 #include "utilmoneystr.h"
+#include "validationinterface.h"
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
 #endif
@@ -106,295 +107,544 @@ void UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams,
         pblock->nBits = GetNextWorkRequired(pindexPrev, pblock, consensusParams);
 }
 
-CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn)
+/** Block size limits from -blockmaxsize, -blockprioritysize and -blockminsize */
+static void GetBlockSizeLimits(unsigned int& nBlockMaxSize, unsigned int& nBlockPrioritySize, unsigned int& nBlockMinSize)
 {
-    const CChainParams& chainparams = Params();
-    // Create new block
-    std::unique_ptr<CBlockTemplate> pblocktemplate(new CBlockTemplate());
-    if(!pblocktemplate.get())
-        return NULL;
-    CBlock *pblock = &pblocktemplate->block; // pointer for convenience
-
-    // -regtest only: allow overriding block.nVersion with
-    // -blockversion=N to test forking scenarios
-    if (Params().MineBlocksOnDemand())
-        pblock->nVersion = GetArg("-blockversion", pblock->nVersion);
-
-    // Add dummy coinbase tx as first transaction
-    pblock->vtx.push_back(CTransaction());
-    pblocktemplate->vTxFees.push_back(-1); // updated at end
-    pblocktemplate->vTxSigOps.push_back(-1); // updated at end
-
     // Largest block you're willing to create:
-    unsigned int nBlockMaxSize = GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
+    nBlockMaxSize = GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
     // Limit to betweeen 1K and MAX_BLOCK_SIZE-1K for sanity:
     nBlockMaxSize = std::max((unsigned int)1000, std::min((unsigned int)(MAX_BLOCK_SIZE-1000), nBlockMaxSize));
 
     // How much of the block should be dedicated to high-priority transactions,
     // included regardless of the fees they pay
-    unsigned int nBlockPrioritySize = GetArg("-blockprioritysize", DEFAULT_BLOCK_PRIORITY_SIZE);
+    nBlockPrioritySize = GetArg("-blockprioritysize", DEFAULT_BLOCK_PRIORITY_SIZE);
     nBlockPrioritySize = std::min(nBlockMaxSize, nBlockPrioritySize);
 
     // Minimum block size you want to create; block will be filled with free transactions
     // until there are no more or the block reaches this size:
-    unsigned int nBlockMinSize = GetArg("-blockminsize", DEFAULT_BLOCK_MIN_SIZE);
+    nBlockMinSize = GetArg("-blockminsize", DEFAULT_BLOCK_MIN_SIZE);
     nBlockMinSize = std::min(nBlockMaxSize, nBlockMinSize);
+}
 
-    // Collect memory pool transactions into the block
-    CAmount nFees = 0;
-
-    {
-        LOCK2(cs_main, mempool.cs);
-        CBlockIndex* pindexPrev = chainActive.Tip();
-        const int nHeight = pindexPrev->nHeight + 1;
-        pblock->nTime = GetAdjustedTime();
-        const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
-
-        pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
-        // -regtest only: allow overriding block.nVersion with
-        // -blockversion=N to test forking scenarios
-        if (chainparams.MineBlocksOnDemand())
-            pblock->nVersion = GetArg("-blockversion", pblock->nVersion);
+/**
+ * Start a block on top of pindexPrev: header version and time, and a
+ * placeholder coinbase (filled in by FinishBlockTemplate).
+ */
+static void StartBlockTemplate(CBlockTemplate* pblocktemplate, const CBlockIndex* pindexPrev)
+{
+    const CChainParams& chainparams = Params();
+    CBlock *pblock = &pblocktemplate->block; // pointer for convenience
 
-        CCoinsViewCache view(pcoinsTip);
+    pblock->nTime = GetAdjustedTime();
+    pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
+    // -regtest only: allow overriding block.nVersion with
+    // -blockversion=N to test forking scenarios
+    if (chainparams.MineBlocksOnDemand())
+        pblock->nVersion = GetArg("-blockversion", pblock->nVersion);
 
-        // Priority order to process transactions
-        list<COrphan> vOrphan; // list memory doesn't move
-        map<uint256, vector<COrphan*> > mapDependers;
-        bool fPrintPriority = GetBoolArg("-printpriority", false);
+    // Add dummy coinbase tx as first transaction
+    pblock->vtx.push_back(CTransaction());
+    pblocktemplate->vTxFees.push_back(-1); // updated at end
+    pblocktemplate->vTxSigOps.push_back(-1); // updated at end
+}
 
-        // This vector will be sorted into a priority queue:
-        vector<TxPriority> vecPriority;
-        vecPriority.reserve(mempool.mapTx.size());
-        for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.mapTx.begin();
-             mi != mempool.mapTx.end(); ++mi)
-        {
-            const CTransaction& tx = mi->second.GetTx();
+/**
+ * Collect memory pool transactions into the block, by priority then fee
+ * rate, applying them to view. nBlockSize, nBlockSigOps and nFees are the
+ * running totals of the block.
+ */
+static void AddMempoolTransactions(CBlockTemplate* pblocktemplate, CCoinsViewCache& view, const CBlockIndex* pindexPrev,
+                                   uint64_t& nBlockSize, int& nBlockSigOps, CAmount& nFees)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(mempool.cs);
+    CBlock *pblock = &pblocktemplate->block; // pointer for convenience
+    const int nHeight = pindexPrev->nHeight + 1;
+    const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
+
+    unsigned int nBlockMaxSize, nBlockPrioritySize, nBlockMinSize;
+    GetBlockSizeLimits(nBlockMaxSize, nBlockPrioritySize, nBlockMinSize);
+
+    // Priority order to process transactions
+    list<COrphan> vOrphan; // list memory doesn't move
+    map<uint256, vector<COrphan*> > mapDependers;
+    bool fPrintPriority = GetBoolArg("-printpriority", false);
+
+    // This vector will be sorted into a priority queue:
+    vector<TxPriority> vecPriority;
+    vecPriority.reserve(mempool.mapTx.size());
+    for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
+         mi != mempool.mapTx.end(); ++mi)
+    {
+        const CTransaction& tx = mi->GetTx();
 
-            int64_t nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
-                                    ? nMedianTimePast
-                                    : pblock->GetBlockTime();
+        int64_t nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+                                ? nMedianTimePast
+                                : pblock->GetBlockTime();
 
-            if (tx.IsCoinBase() || !IsFinalTx(tx, nHeight, nLockTimeCutoff))
-                continue;
+        if (tx.IsCoinBase() || !IsFinalTx(tx, nHeight, nLockTimeCutoff))
+            continue;
 
-            COrphan* porphan = NULL;
-            double dPriority = 0;
-            CAmount nTotalIn = 0;
-            bool fMissingInputs = false;
-            BOOST_FOREACH(const CTxIn& txin, tx.vin)
+        COrphan* porphan = NULL;
+        double dPriority = 0;
+        CAmount nTotalIn = 0;
+        bool fMissingInputs = false;
+        BOOST_FOREACH(const CTxIn& txin, tx.vin)
+        {
+            // Read prev transaction
+            if (!view.HaveCoins(txin.prevout.hash))
             {
-                // Read prev transaction
-                if (!view.HaveCoins(txin.prevout.hash))
+                // This should never happen; all transactions in the memory
+                // pool should connect to either transactions in the chain
+                // or other transactions in the memory pool.
+                if (!mempool.mapTx.count(txin.prevout.hash))
                 {
-                    // This should never happen; all transactions in the memory
-                    // pool should connect to either transactions in the chain
-                    // or other transactions in the memory pool.
-                    if (!mempool.mapTx.count(txin.prevout.hash))
-                    {
-                        LogPrintf("ERROR: mempool transaction missing input\n");
-                        if (fDebug) assert("mempool transaction missing input" == 0);
-                        fMissingInputs = true;
-                        if (porphan)
-                            vOrphan.pop_back();
-                        break;
-                    }
+                    LogPrintf("ERROR: mempool transaction missing input\n");
+                    if (fDebug) assert("mempool transaction missing input" == 0);
+                    fMissingInputs = true;
+                    if (porphan)
+                        vOrphan.pop_back();
+                    break;
+                }
 
-                    // Has to wait for dependencies
-                    if (!porphan)
-                    {
-                        // Use list for automatic deletion
-                        vOrphan.push_back(COrphan(&tx));
-                        porphan = &vOrphan.back();
-                    }
-                    mapDependers[txin.prevout.hash].push_back(porphan);
-                    porphan->setDependsOn.insert(txin.prevout.hash);
-                    nTotalIn += mempool.mapTx[txin.prevout.hash].GetTx().vout[txin.prevout.n].nValue;
-                    continue;
+                // Has to wait for dependencies
+                if (!porphan)
+                {
+                    // Use list for automatic deletion
+                    vOrphan.push_back(COrphan(&tx));
+                    porphan = &vOrphan.back();
                 }
-                const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-                assert(coins);
+                mapDependers[txin.prevout.hash].push_back(porphan);
+                porphan->setDependsOn.insert(txin.prevout.hash);
+                nTotalIn += mempool.mapTx.find(txin.prevout.hash)->GetTx().vout[txin.prevout.n].nValue;
+                continue;
+            }
+            const CCoins* coins = view.AccessCoins(txin.prevout.hash);
+            assert(coins);
 
-                CAmount nValueIn = coins->vout[txin.prevout.n].nValue;
-                nTotalIn += nValueIn;
+            CAmount nValueIn = coins->vout[txin.prevout.n].nValue;
+            nTotalIn += nValueIn;
 
-                int nConf = nHeight - coins->nHeight;
+            int nConf = nHeight - coins->nHeight;
 
-                dPriority += (double)nValueIn * nConf;
-            }
-            nTotalIn += tx.GetJoinSplitValueIn();
+            dPriority += (double)nValueIn * nConf;
+        }
+        nTotalIn += tx.GetJoinSplitValueIn();
 
-            if (fMissingInputs) continue;
+        if (fMissingInputs) continue;
 
-            // Priority is sum(valuein * age) / modified_txsize
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-            dPriority = tx.ComputePriority(dPriority, nTxSize);
+        // Priority is sum(valuein * age) / modified_txsize
+        unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+        dPriority = tx.ComputePriority(dPriority, nTxSize);
 
-            uint256 hash = tx.GetHash();
-            mempool.ApplyDeltas(hash, dPriority, nTotalIn);
+        uint256 hash = tx.GetHash();
+        mempool.ApplyDeltas(hash, dPriority, nTotalIn);
 
-            CFeeRate feeRate(nTotalIn-tx.GetValueOut(), nTxSize);
+        CFeeRate feeRate(nTotalIn-tx.GetValueOut(), nTxSize);
 
-            if (porphan)
-            {
-                porphan->dPriority = dPriority;
-                porphan->feeRate = feeRate;
-            }
-            else
-                vecPriority.push_back(TxPriority(dPriority, feeRate, &mi->second.GetTx()));
+        if (porphan)
+        {
+            porphan->dPriority = dPriority;
+            porphan->feeRate = feeRate;
         }
+        else
+            vecPriority.push_back(TxPriority(dPriority, feeRate, &(mi->GetTx())));
+    }
 
-        // Collect transactions into block
-        uint64_t nBlockSize = 1000;
-        uint64_t nBlockTx = 0;
-        int nBlockSigOps = 100;
-        bool fSortedByFee = (nBlockPrioritySize <= 0);
+    // Collect transactions into block
+    uint64_t nBlockTx = 0;
+    bool fSortedByFee = (nBlockPrioritySize <= 0);
 
-        TxPriorityCompare comparer(fSortedByFee);
-        std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+    TxPriorityCompare comparer(fSortedByFee);
+    std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
 
-        while (!vecPriority.empty())
+    while (!vecPriority.empty())
+    {
+        // Take highest priority transaction off the priority queue:
+        double dPriority = vecPriority.front().get<0>();
+        CFeeRate feeRate = vecPriority.front().get<1>();
+        const CTransaction& tx = *(vecPriority.front().get<2>());
+
+        std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
+        vecPriority.pop_back();
+
+        // Size limits
+        unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+        if (nBlockSize + nTxSize >= nBlockMaxSize)
+            continue;
+
+        // Legacy limits on sigOps:
+        unsigned int nTxSigOps = GetLegacySigOpCount(tx);
+        if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS)
+            continue;
+
+        // Skip free transactions if we're past the minimum block size:
+        const uint256& hash = tx.GetHash();
+        double dPriorityDelta = 0;
+        CAmount nFeeDelta = 0;
+        mempool.ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
+        if (fSortedByFee && (dPriorityDelta <= 0) && (nFeeDelta <= 0) && (feeRate < ::minRelayTxFee) && (nBlockSize + nTxSize >= nBlockMinSize))
+            continue;
+
+        // Prioritise by fee once past the priority size or we run out of high-priority
+        // transactions:
+        if (!fSortedByFee &&
+            ((nBlockSize + nTxSize >= nBlockPrioritySize) || !AllowFree(dPriority)))
         {
-            // Take highest priority transaction off the priority queue:
-            double dPriority = vecPriority.front().get<0>();
-            CFeeRate feeRate = vecPriority.front().get<1>();
-            const CTransaction& tx = *(vecPriority.front().get<2>());
+            fSortedByFee = true;
+            comparer = TxPriorityCompare(fSortedByFee);
+            std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+        }
 
-            std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
-            vecPriority.pop_back();
+        if (!view.HaveInputs(tx))
+            continue;
 
-            // Size limits
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-            if (nBlockSize + nTxSize >= nBlockMaxSize)
-                continue;
+        CAmount nTxFees = view.GetValueIn(tx)-tx.GetValueOut();
 
-            // Legacy limits on sigOps:
-            unsigned int nTxSigOps = GetLegacySigOpCount(tx);
-            if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS)
-                continue;
+        nTxSigOps += GetP2SHSigOpCount(tx, view);
+        if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS)
+            continue;
 
-            // Skip free transactions if we're past the minimum block size:
-            const uint256& hash = tx.GetHash();
-            double dPriorityDelta = 0;
-            CAmount nFeeDelta = 0;
-            mempool.ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
-            if (fSortedByFee && (dPriorityDelta <= 0) && (nFeeDelta <= 0) && (feeRate < ::minRelayTxFee) && (nBlockSize + nTxSize >= nBlockMinSize))
-                continue;
+        // Note that flags: we don't want to set mempool/IsStandard()
+        // policy here, but we still have to ensure that the block we
+        // create only contains transactions that are valid in new blocks.
+        CValidationState state;
+        if (!ContextualCheckInputs(tx, state, view, true, chainActive, MANDATORY_SCRIPT_VERIFY_FLAGS | SCRIPT_VERIFY_CHECKBLOCKATHEIGHT, true, Params().GetConsensus()))
+            continue;
+
+        UpdateCoins(tx, state, view, nHeight);
+
+        // Added
+        pblock->vtx.push_back(tx);
+        pblocktemplate->vTxFees.push_back(nTxFees);
+        pblocktemplate->vTxSigOps.push_back(nTxSigOps);
+        nBlockSize += nTxSize;
+        ++nBlockTx;
+        nBlockSigOps += nTxSigOps;
+        nFees += nTxFees;
+
+        if (fPrintPriority)
+        {
+            LogPrintf("priority %.1f fee %s txid %s\n",
+                dPriority, feeRate.ToString(), tx.GetHash().ToString());
+        }
 
-            // Prioritise by fee once past the priority size or we run out of high-priority
-            // transactions:
-            if (!fSortedByFee &&
-                ((nBlockSize + nTxSize >= nBlockPrioritySize) || !AllowFree(dPriority)))
+        // Add transactions that depend on this one to the priority queue
+        if (mapDependers.count(hash))
+        {
+            BOOST_FOREACH(COrphan* porphan, mapDependers[hash])
             {
-                fSortedByFee = true;
-                comparer = TxPriorityCompare(fSortedByFee);
-                std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+                if (!porphan->setDependsOn.empty())
+                {
+                    porphan->setDependsOn.erase(hash);
+                    if (porphan->setDependsOn.empty())
+                    {
+                        vecPriority.push_back(TxPriority(porphan->dPriority, porphan->feeRate, porphan->ptx));
+                        std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
+                    }
+                }
             }
+        }
+    }
+}
 
-            if (!view.HaveInputs(tx))
-                continue;
+/**
+ * Fill in the coinbase paying scriptPubKeyIn the subsidy and nFees, and the
+ * header. The block is checked with TestBlockValidity unless fCheckValidity
+ * is false, which is only for transaction sets that have been checked before.
+ */
+static void FinishBlockTemplate(CBlockTemplate* pblocktemplate, const CScript& scriptPubKeyIn, CBlockIndex* pindexPrev,
+                                uint64_t nBlockSize, CAmount nFees, bool fCheckValidity = true)
+{
+    AssertLockHeld(cs_main);
+    const CChainParams& chainparams = Params();
+    CBlock *pblock = &pblocktemplate->block; // pointer for convenience
+    const int nHeight = pindexPrev->nHeight + 1;
+
+    nLastBlockTx = pblock->vtx.size() - 1;
+    nLastBlockSize = nBlockSize;
+    LogPrintf("CreateNewBlock(): total size %u\n", nBlockSize);
+
+    // Create coinbase tx
+    CMutableTransaction txNew;
+    txNew.vin.resize(1);
+    txNew.vin[0].prevout.SetNull();
+    txNew.vout.resize(1);
+    txNew.vout[0].scriptPubKey = scriptPubKeyIn;
+    txNew.vout[0].nValue = GetBlockSubsidy(nHeight, chainparams.GetConsensus());
+
+    if ((nHeight > chainparams.GetConsensus().nChainsplitIndex)) {
+        // Community fund is 8.5% of the block subsidy
+        auto vCommunityFund = ((txNew.vout[0].nValue * 85) / 1000);
+        // The CF reward is increased to 12% since hfCommunityFundHeight block
+        if (nHeight >= chainparams.GetConsensus().hfCommunityFundHeight)
+            vCommunityFund = ((txNew.vout[0].nValue * 120) / 1000);
+
+        // Take some reward away from miners
+        txNew.vout[0].nValue -= vCommunityFund;
+        // And give it to the community
+        txNew.vout.push_back(CTxOut(vCommunityFund, chainparams.GetCommunityFundScriptAtHeight(nHeight)));
+    }
 
-            CAmount nTxFees = view.GetValueIn(tx)-tx.GetValueOut();
+    // Add fees
+    txNew.vout[0].nValue += nFees;
+    txNew.vin[0].scriptSig = CScript() << nHeight << OP_0;
 
-            nTxSigOps += GetP2SHSigOpCount(tx, view);
-            if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS)
-                continue;
+    pblock->vtx[0] = txNew;
+    pblocktemplate->vTxFees[0] = -nFees;
 
-            // Note that flags: we don't want to set mempool/IsStandard()
-            // policy here, but we still have to ensure that the block we
-            // create only contains transactions that are valid in new blocks.
-            CValidationState state;
-            if (!ContextualCheckInputs(tx, state, view, true, chainActive, MANDATORY_SCRIPT_VERIFY_FLAGS | SCRIPT_VERIFY_CHECKBLOCKATHEIGHT, true, Params().GetConsensus()))
-                continue;
+    // Randomise nonce
+    arith_uint256 nonce = UintToArith256(GetRandHash());
+    // Clear the top and bottom 16 bits (for local use as thread flags and counters)
+    nonce <<= 32;
+    nonce >>= 16;
+    pblock->nNonce = ArithToUint256(nonce);
 
-            UpdateCoins(tx, state, view, nHeight);
+    // Fill in header
+    pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
+    pblock->hashReserved   = uint256();
+    UpdateTime(pblock, Params().GetConsensus(), pindexPrev);
+    pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, Params().GetConsensus());
+    pblock->nSolution.clear();
+    pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
 
-            // Added
-            pblock->vtx.push_back(tx);
-            pblocktemplate->vTxFees.push_back(nTxFees);
-            pblocktemplate->vTxSigOps.push_back(nTxSigOps);
-            nBlockSize += nTxSize;
-            ++nBlockTx;
-            nBlockSigOps += nTxSigOps;
-            nFees += nTxFees;
+    CValidationState state;
+    if (fCheckValidity && !TestBlockValidity(state, *pblock, pindexPrev, false, false))
+        throw std::runtime_error("CreateNewBlock(): TestBlockValidity failed");
+}
 
-            if (fPrintPriority)
-            {
-                LogPrintf("priority %.1f fee %s txid %s\n",
-                    dPriority, feeRate.ToString(), tx.GetHash().ToString());
-            }
+CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn)
+{
+    // Create new block
+    std::unique_ptr<CBlockTemplate> pblocktemplate(new CBlockTemplate());
+    if(!pblocktemplate.get())
+        return NULL;
 
-            // Add transactions that depend on this one to the priority queue
-            if (mapDependers.count(hash))
-            {
-                BOOST_FOREACH(COrphan* porphan, mapDependers[hash])
-                {
-                    if (!porphan->setDependsOn.empty())
-                    {
-                        porphan->setDependsOn.erase(hash);
-                        if (porphan->setDependsOn.empty())
-                        {
-                            vecPriority.push_back(TxPriority(porphan->dPriority, porphan->feeRate, porphan->ptx));
-                            std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
-                        }
-                    }
-                }
+    {
+        LOCK2(cs_main, mempool.cs);
+        CBlockIndex* pindexPrev = chainActive.Tip();
+        StartBlockTemplate(pblocktemplate.get(), pindexPrev);
+
+        // Collect memory pool transactions into the block
+        CCoinsViewCache view(pcoinsTip);
+        uint64_t nBlockSize = 1000;
+        int nBlockSigOps = 100;
+        CAmount nFees = 0;
+        AddMempoolTransactions(pblocktemplate.get(), view, pindexPrev, nBlockSize, nBlockSigOps, nFees);
+
+        FinishBlockTemplate(pblocktemplate.get(), scriptPubKeyIn, pindexPrev, nBlockSize, nFees);
+    }
+
+    return pblocktemplate.release();
+}
+
+/**
+ * Keeps the transactions of the next block up to date between calls, so
+ * that getblocktemplate does not walk the whole mempool every time.
+ *
+ * The transaction set is built from the mempool like CreateNewBlock does
+ * when the tip changes, and transactions accepted to the mempool afterwards
+ * are appended to it as they arrive (SyncTransaction), each checked against
+ * the coins view of the set so far. Transactions that leave the mempool
+ * other than through a block (conflicts, eviction, expiry), or ones that
+ * could not be appended while the block had room for better ones, make the
+ * next request rebuild the set, the latter at most every
+ * BLOCK_TEMPLATE_REBUILD_INTERVAL seconds.
+ *
+ * A request then only costs a copy of the set and a coinbase; the whole
+ * block is only run through TestBlockValidity after a rebuild, appended
+ * transactions having been checked one by one.
+ */
+class CBlockTemplateBuilder : public CValidationInterface
+{
+private:
+    CCriticalSection cs;
+    std::unique_ptr<CBlockTemplate> ptemplate; //! transactions, with a placeholder coinbase
+    std::unique_ptr<CCoinsViewCache> pview; //! pcoinsTip with the transactions of ptemplate applied
+    std::set<uint256> setInTemplate;
+    uint256 hashPrevBlock;
+    uint64_t nBlockSize;
+    int nBlockSigOps;
+    CAmount nFees;
+    int64_t nLastRebuild;
+    bool fDirty; //! must be rebuilt before use
+    bool fMissed; //! a mempool transaction was left out that a rebuild may take
+    bool fValidated; //! the current set passed TestBlockValidity
+
+    void Rebuild(CBlockIndex* pindexPrev)
+    {
+        int64_t nStart = GetTimeMicros();
+        ptemplate.reset(new CBlockTemplate());
+        pview.reset(new CCoinsViewCache(pcoinsTip));
+        StartBlockTemplate(ptemplate.get(), pindexPrev);
+        nBlockSize = 1000;
+        nBlockSigOps = 100;
+        nFees = 0;
+        AddMempoolTransactions(ptemplate.get(), *pview, pindexPrev, nBlockSize, nBlockSigOps, nFees);
+
+        setInTemplate.clear();
+        for (size_t i = 1; i < ptemplate->block.vtx.size(); i++)
+            setInTemplate.insert(ptemplate->block.vtx[i].GetHash());
+        hashPrevBlock = pindexPrev->GetBlockHash();
+        nLastRebuild = GetTime();
+        fDirty = false;
+        fMissed = false;
+        fValidated = false;
+        LogPrint("bench", "    - Rebuild block template: %.2fms (%u txs)\n", (GetTimeMicros() - nStart) * 0.001, setInTemplate.size());
+    }
+
+    bool NeedsRebuild(const CBlockIndex* pindexPrev)
+    {
+        if (fDirty || !ptemplate || hashPrevBlock != pindexPrev->GetBlockHash())
+            return true;
+        if (fMissed && GetTime() - nLastRebuild >= BLOCK_TEMPLATE_REBUILD_INTERVAL)
+            return true;
+        // Transactions that left the mempool without a block
+        BOOST_FOREACH(const uint256& hash, setInTemplate)
+            if (!mempool.exists(hash))
+                return true;
+        return false;
+    }
+
+    /** Append tx, just accepted to the mempool, if it fits and is valid on top of the set */
+    void Append(const CTransaction& tx)
+    {
+        AssertLockHeld(cs_main);
+        AssertLockHeld(mempool.cs);
+        if (fDirty || !ptemplate || tx.IsCoinBase())
+            return;
+        // Transactions resurrected while a block is disconnected arrive
+        // before the tip moves back; the rebuild for the new tip takes them.
+        const CBlockIndex* pindexPrev = chainActive.Tip();
+        if (pindexPrev->GetBlockHash() != hashPrevBlock || pcoinsTip->GetBestBlock() != hashPrevBlock)
+            return;
+        const uint256 hash = tx.GetHash();
+        if (setInTemplate.count(hash) || !mempool.exists(hash))
+            return;
+
+        CBlock *pblock = &ptemplate->block;
+        const int nHeight = pindexPrev->nHeight + 1;
+        int64_t nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+                                ? pindexPrev->GetMedianTimePast()
+                                : pblock->GetBlockTime();
+        if (!IsFinalTx(tx, nHeight, nLockTimeCutoff))
+            return;
+
+        // In-mempool parents must already be in the block
+        BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+            if (!setInTemplate.count(txin.prevout.hash) && mempool.exists(txin.prevout.hash)) {
+                fMissed = true;
+                return;
             }
         }
 
-        nLastBlockTx = nBlockTx;
-        nLastBlockSize = nBlockSize;
-        LogPrintf("CreateNewBlock(): total size %u\n", nBlockSize);
-
-        // Create coinbase tx
-        CMutableTransaction txNew;
-        txNew.vin.resize(1);
-        txNew.vin[0].prevout.SetNull();
-        txNew.vout.resize(1);
-        txNew.vout[0].scriptPubKey = scriptPubKeyIn;
-        txNew.vout[0].nValue = GetBlockSubsidy(nHeight, chainparams.GetConsensus());
-
-        if ((nHeight > chainparams.GetConsensus().nChainsplitIndex)) {
-            // Community fund is 8.5% of the block subsidy
-            auto vCommunityFund = ((txNew.vout[0].nValue * 85) / 1000);
-            // The CF reward is increased to 12% since hfCommunityFundHeight block
-            if (nHeight >= chainparams.GetConsensus().hfCommunityFundHeight)
-                vCommunityFund = ((txNew.vout[0].nValue * 120) / 1000);
-
-            // Take some reward away from miners
-            txNew.vout[0].nValue -= vCommunityFund;
-            // And give it to the community
-            txNew.vout.push_back(CTxOut(vCommunityFund, chainparams.GetCommunityFundScriptAtHeight(nHeight)));
+        unsigned int nBlockMaxSize, nBlockPrioritySize, nBlockMinSize;
+        GetBlockSizeLimits(nBlockMaxSize, nBlockPrioritySize, nBlockMinSize);
+
+        unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+        unsigned int nTxSigOps = GetLegacySigOpCount(tx);
+        if (nBlockSize + nTxSize >= nBlockMaxSize || nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS) {
+            fMissed = true;
+            return;
         }
 
-        // Add fees
-        txNew.vout[0].nValue += nFees;
-        txNew.vin[0].scriptSig = CScript() << nHeight << OP_0;
+        if (!pview->HaveInputs(tx) || !pview->HaveJoinSplitRequirements(tx))
+            return;
+        CAmount nTxFees = pview->GetValueIn(tx)-tx.GetValueOut();
+
+        // Free transactions only fill the block up to the minimum size,
+        // as in AddMempoolTransactions
+        double dPriorityDelta = 0;
+        CAmount nFeeDelta = 0;
+        mempool.ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
+        if ((dPriorityDelta <= 0) && (nFeeDelta <= 0) && (CFeeRate(nTxFees, nTxSize) < ::minRelayTxFee) && (nBlockSize + nTxSize >= nBlockMinSize))
+            return;
+
+        nTxSigOps += GetP2SHSigOpCount(tx, *pview);
+        if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS) {
+            fMissed = true;
+            return;
+        }
 
-        pblock->vtx[0] = txNew;
-        pblocktemplate->vTxFees[0] = -nFees;
+        CValidationState state;
+        if (!ContextualCheckInputs(tx, state, *pview, true, chainActive, MANDATORY_SCRIPT_VERIFY_FLAGS | SCRIPT_VERIFY_CHECKBLOCKATHEIGHT, true, Params().GetConsensus()))
+            return;
+
+        UpdateCoins(tx, state, *pview, nHeight);
+
+        pblock->vtx.push_back(tx);
+        ptemplate->vTxFees.push_back(nTxFees);
+        ptemplate->vTxSigOps.push_back(nTxSigOps);
+        setInTemplate.insert(hash);
+        nBlockSize += nTxSize;
+        nBlockSigOps += nTxSigOps;
+        nFees += nTxFees;
+    }
 
-        // Randomise nonce
-        arith_uint256 nonce = UintToArith256(GetRandHash());
-        // Clear the top and bottom 16 bits (for local use as thread flags and counters)
-        nonce <<= 32;
-        nonce >>= 16;
-        pblock->nNonce = ArithToUint256(nonce);
+protected:
+    void SyncTransaction(const CTransaction& tx, const CBlock* pblock)
+    {
+        // Block transactions come with a new tip, which makes us rebuild
+        if (pblock)
+            return;
+        LOCK2(cs_main, mempool.cs);
+        LOCK(cs);
+        Append(tx);
+    }
 
-        // Fill in header
-        pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
-        pblock->hashReserved   = uint256();
-        UpdateTime(pblock, Params().GetConsensus(), pindexPrev);
-        pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, Params().GetConsensus());
-        pblock->nSolution.clear();
-        pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
+public:
+    CBlockTemplateBuilder() : nBlockSize(0), nBlockSigOps(0), nFees(0), nLastRebuild(0),
+                              fDirty(true), fMissed(false), fValidated(false) {}
 
-        CValidationState state;
-        if (!TestBlockValidity(state, *pblock, pindexPrev, false, false))
-            throw std::runtime_error("CreateNewBlock(): TestBlockValidity failed");
+    CBlockTemplate* Get(const CScript& scriptPubKeyIn)
+    {
+        LOCK2(cs_main, mempool.cs);
+        LOCK(cs);
+        CBlockIndex* pindexPrev = chainActive.Tip();
+        if (NeedsRebuild(pindexPrev))
+            Rebuild(pindexPrev);
+
+        std::unique_ptr<CBlockTemplate> pblocktemplate(new CBlockTemplate(*ptemplate));
+        if (fValidated) {
+            FinishBlockTemplate(pblocktemplate.get(), scriptPubKeyIn, pindexPrev, nBlockSize, nFees, false);
+        } else {
+            // Start over next time if this throws
+            fDirty = true;
+            FinishBlockTemplate(pblocktemplate.get(), scriptPubKeyIn, pindexPrev, nBlockSize, nFees);
+            fDirty = false;
+            fValidated = true;
+        }
+        return pblocktemplate.release();
     }
+};
 
-    return pblocktemplate.release();
+static CBlockTemplateBuilder* pblocktemplatebuilder = NULL;
+
+void StartBlockTemplateBuilder()
+{
+    AssertLockHeld(cs_main);
+    if (pblocktemplatebuilder)
+        return;
+    pblocktemplatebuilder = new CBlockTemplateBuilder();
+    RegisterValidationInterface(pblocktemplatebuilder);
+}
+
+void StopBlockTemplateBuilder()
+{
+    LOCK(cs_main);
+    if (!pblocktemplatebuilder)
+        return;
+    UnregisterValidationInterface(pblocktemplatebuilder);
+    delete pblocktemplatebuilder;
+    pblocktemplatebuilder = NULL;
+}
+
+CBlockTemplate* GetBlockTemplate(const CScript& scriptPubKeyIn)
+{
+    LOCK(cs_main);
+    if (!pblocktemplatebuilder)
+        return CreateNewBlock(scriptPubKeyIn);
+    return pblocktemplatebuilder->Get(scriptPubKeyIn);
 }
 
 #ifdef ENABLE_WALLET
@@ -439,6 +689,22 @@ CBlockTemplate* CreateNewBlockWithKey()
     return CreateNewBlock(*scriptPubKey);
 }
 
+#ifdef ENABLE_WALLET
+CBlockTemplate* GetBlockTemplateWithKey(CReserveKey& reservekey)
+{
+    boost::optional<CScript> scriptPubKey = GetMinerScriptPubKey(reservekey);
+#else
+CBlockTemplate* GetBlockTemplateWithKey()
+{
+    boost::optional<CScript> scriptPubKey = GetMinerScriptPubKey();
+#endif
+
+    if (!scriptPubKey) {
+        return NULL;
+    }
+    return GetBlockTemplate(*scriptPubKey);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Internal miner
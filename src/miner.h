@@ -26,15 +26,32 @@ struct CBlockTemplate
     std::vector<int64_t> vTxSigOps;
 };
 
+/** Minimum number of seconds between rebuilds of the block template for a better transaction selection */
+static const int64_t BLOCK_TEMPLATE_REBUILD_INTERVAL = 30;
+
 /** Generate a new block, without valid proof-of-work */
 CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn);
+/**
+ * Generate a new block from the transaction set kept up to date by the
+ * block template builder, or like CreateNewBlock if it is not running.
+ */
+CBlockTemplate* GetBlockTemplate(const CScript& scriptPubKeyIn);
 #ifdef ENABLE_WALLET
 boost::optional<CScript> GetMinerScriptPubKey(CReserveKey& reservekey);
 CBlockTemplate* CreateNewBlockWithKey(CReserveKey& reservekey);
+CBlockTemplate* GetBlockTemplateWithKey(CReserveKey& reservekey);
 #else
 boost::optional<CScript> GetMinerScriptPubKey();
 CBlockTemplate* CreateNewBlockWithKey();
+CBlockTemplate* GetBlockTemplateWithKey();
 #endif
+/**
+ * Start keeping a block template up to date with the mempool and the tip,
+ * which costs a script check of every transaction accepted to the mempool.
+ * Must be called with cs_main held.
+ */
+void StartBlockTemplateBuilder();
+void StopBlockTemplateBuilder();
 
 #ifdef ENABLE_MINING
 /** Modify the extranonce in a block */
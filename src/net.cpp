@@ -66,6 +66,13 @@ using namespace std;
 
 namespace {
     const int MAX_OUTBOUND_CONNECTIONS = 8;
+    /** Maximum number of queued messages handed to the kernel by one sendmsg() */
+    const size_t MAX_SEND_IOVECS = 64;
+    /** Queued messages are coalesced up to the payload of one TLS record */
+    const size_t MAX_SSL_RECORD_SIZE = 16384;
+    /** Number of sent message buffers kept per peer for reuse, and the largest size kept */
+    const size_t MAX_POOLED_SEND_BUFFERS = 8;
+    const size_t MAX_POOLED_SEND_BUFFER_SIZE = 64 * 1024;
 
     struct ListenSocket {
         SOCKET socket;
@@ -439,15 +446,23 @@ static int WaitFor(SSLConnectionRoutine eRoutine, SOCKET hSocket, SSL *ssl, int
             break;
         }
 
+#ifdef USE_EPOLL
+        struct pollfd pollfd = { (int)hSocket, (short)(sslErr == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT), 0 };
+#else
         fd_set socketSet;
         FD_ZERO(&socketSet);
         FD_SET(hSocket, &socketSet);
 
         struct timeval timeout = { timeoutSec, 0 };
+#endif
 
         if (sslErr == SSL_ERROR_WANT_READ)
         {
+#ifdef USE_EPOLL
+            int result = poll(&pollfd, 1, timeoutSec * 1000);
+#else
             int result = select(hSocket + 1, &socketSet, NULL, NULL, &timeout);
+#endif
             if (result == 0)
             {
                 LogPrint("net", "TLS: ERROR: %s: %s: WANT_READ timeout\n", __FILE__, __func__);
@@ -463,7 +478,11 @@ static int WaitFor(SSLConnectionRoutine eRoutine, SOCKET hSocket, SSL *ssl, int
         }
         else
         {
+#ifdef USE_EPOLL
+            int result = poll(&pollfd, 1, timeoutSec * 1000);
+#else
             int result = select(hSocket + 1, NULL, &socketSet, NULL, &timeout);
+#endif
             if (result == 0)
             {
                 LogPrint("net", "TLS: ERROR: %s: %s: WANT_WRITE timeout\n", __FILE__, __func__);
@@ -913,18 +932,44 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 
 
 
+// requires LOCK(cs_vSend)
+static void RecycleSendBuffer(CNode *pnode, CSerializeData &data)
+{
+    if (pnode->vSendBufferPool.size() >= MAX_POOLED_SEND_BUFFERS || data.capacity() > MAX_POOLED_SEND_BUFFER_SIZE)
+        return;
+    data.clear();
+    pnode->vSendBufferPool.push_back(CSerializeData());
+    pnode->vSendBufferPool.back().swap(data);
+}
+
+// requires LOCK(cs_vSend)
+// Append the small messages queued after vSendMsg[nPos] to it, so that they
+// go out in a single TLS record. Not allowed while an SSL_write() of it is to
+// be repeated, as the retry must pass the same data.
+static void CoalesceSendMessages(CNode *pnode, size_t nPos)
+{
+    CSerializeData &data = pnode->vSendMsg[nPos];
+    size_t nEnd = nPos + 1;
+    while (nEnd < pnode->vSendMsg.size() && data.size() + pnode->vSendMsg[nEnd].size() <= MAX_SSL_RECORD_SIZE) {
+        data.insert(data.end(), pnode->vSendMsg[nEnd].begin(), pnode->vSendMsg[nEnd].end());
+        RecycleSendBuffer(pnode, pnode->vSendMsg[nEnd]);
+        nEnd++;
+    }
+    pnode->vSendMsg.erase(pnode->vSendMsg.begin() + nPos + 1, pnode->vSendMsg.begin() + nEnd);
+}
+
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode *pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
+    size_t nPos = 0;
 
-    while (it != pnode->vSendMsg.end())
+    while (nPos < pnode->vSendMsg.size())
     {
-        const CSerializeData &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert(pnode->vSendMsg[nPos].size() > pnode->nSendOffset);
 
         bool bIsSSL = false;
         int nBytes = 0, nRet = 0;
+        size_t nWanted = 0;
 
         {
             LOCK(pnode->cs_hSocket);
@@ -939,13 +984,40 @@ void SocketSendData(CNode *pnode)
 
             if (bIsSSL)
             {
+                if (pnode->nSSLWriteWant == 0)
+                    CoalesceSendMessages(pnode, nPos);
+                const CSerializeData &data = pnode->vSendMsg[nPos];
+                nWanted = data.size() - pnode->nSendOffset;
+
                 ERR_clear_error(); // clear the error queue, otherwise we may be reading an old error that occurred previously in the current thread
-                nBytes = SSL_write(pnode->ssl, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset);
+                nBytes = SSL_write(pnode->ssl, &data[pnode->nSendOffset], nWanted);
                 nRet = SSL_get_error(pnode->ssl, nBytes);
+                pnode->nSSLWriteWant = (nBytes <= 0 && (nRet == SSL_ERROR_WANT_READ || nRet == SSL_ERROR_WANT_WRITE)) ? nRet : 0;
             }
             else
             {
-                nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+                const CSerializeData &data = pnode->vSendMsg[nPos];
+                nWanted = data.size() - pnode->nSendOffset;
+                nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], nWanted, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+                // Hand as many queued messages as possible to the kernel at once
+                struct iovec iov[MAX_SEND_IOVECS];
+                size_t nIov = 0;
+                size_t nOffset = pnode->nSendOffset;
+                for (size_t i = nPos; i < pnode->vSendMsg.size() && nIov < MAX_SEND_IOVECS; i++, nIov++) {
+                    CSerializeData &data = pnode->vSendMsg[i];
+                    iov[nIov].iov_base = &data[nOffset];
+                    iov[nIov].iov_len = data.size() - nOffset;
+                    nWanted += iov[nIov].iov_len;
+                    nOffset = 0;
+                }
+                struct msghdr msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.msg_iov = iov;
+                msg.msg_iovlen = nIov;
+                nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
                 nRet = WSAGetLastError();
             }
         }
@@ -953,18 +1025,28 @@ void SocketSendData(CNode *pnode)
         {
             pnode->nLastSend = GetTime();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             pnode->RecordBytesSent(nBytes);
 
-            if (pnode->nSendOffset == data.size())
+            // Advance over the messages sent in full
+            size_t nLeft = nBytes;
+            while (nLeft > 0)
             {
-                pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                it++;
+                CSerializeData &data = pnode->vSendMsg[nPos];
+                size_t nPart = std::min(nLeft, data.size() - pnode->nSendOffset);
+                pnode->nSendOffset += nPart;
+                nLeft -= nPart;
+                if (pnode->nSendOffset == data.size())
+                {
+                    pnode->nSendOffset = 0;
+                    pnode->nSendSize -= data.size();
+                    RecycleSendBuffer(pnode, data);
+                    nPos++;
+                }
             }
-            else
+
+            if ((size_t)nBytes < nWanted)
             {
-                // could not send full message; stop sending more
+                // could not send everything; stop sending more
                 break;
             }
         }
@@ -981,12 +1063,8 @@ void SocketSendData(CNode *pnode)
                         LogPrintf("ERROR: SSL_write %s; closing connection\n", ERR_error_string(nRet, NULL));
                         pnode->CloseSocketDisconnect();
                     }
-                    else
-                    {
-                        // preventive measure from exhausting CPU usage
-                        //
-                        MilliSleep(1);    // 1 msec
-                    }
+                    // otherwise the socket handler retries once the socket
+                    // is ready in the direction recorded in nSSLWriteWant
                 }
                 else
                 {
@@ -1003,12 +1081,12 @@ void SocketSendData(CNode *pnode)
         }
     }
 
-    if (it == pnode->vSendMsg.end())
+    if (nPos == pnode->vSendMsg.size())
     {
         assert(pnode->nSendOffset == 0);
         assert(pnode->nSendSize == 0);
     }
-    pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
+    pnode->vSendMsg.erase(pnode->vSendMsg.begin(), pnode->vSendMsg.begin() + nPos);
 }
 
 static list<CNode*> vNodesDisconnected;
@@ -1384,8 +1462,216 @@ void ThreadNonTLSPoolsCleaner()
 
 #endif // USE_TLS && COMPAT_NON_TLS
 
+/**
+ * Readiness of the listening and peer sockets for the socket handler.
+ *
+ * select() needs its fd sets rebuilt for every call, costs time linear in the
+ * highest descriptor and cannot watch descriptors >= FD_SETSIZE. On Linux the
+ * sockets instead stay registered with an epoll instance: only a change in
+ * what a socket is waited for costs a system call, and a wait costs time
+ * linear in the number of ready sockets. select() remains the fallback.
+ *
+ * Each round, Add() every socket to wait for, Wait(), then query Get().
+ */
+class CSocketEvents
+{
+public:
+    static const int RECV = 1;
+    static const int SEND = 2;
+    static const int ERR = 4;
+
+private:
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    SOCKET hSocketMax;
+    bool have_fds;
+
+#ifdef USE_EPOLL
+    struct Registration
+    {
+        const void* owner;
+        uint32_t events;
+        uint64_t nRound;
+    };
+
+    int hEpoll;
+    uint64_t nRound;
+    std::map<SOCKET, Registration> mapRegistered;
+    std::vector<struct epoll_event> vEvents;
+    std::map<SOCKET, int> mapReady;
+
+    void Register(SOCKET hSocket, const void* owner, uint32_t events)
+    {
+        std::map<SOCKET, Registration>::iterator it = mapRegistered.find(hSocket);
+        if (it != mapRegistered.end() && it->second.owner == owner) {
+            it->second.nRound = nRound;
+            if (it->second.events == events)
+                return;
+        }
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = events;
+        ev.data.fd = hSocket;
+        // A socket that was closed (and so dropped by the kernel) may have
+        // had its descriptor reused by another node since the last round
+        int op = (it != mapRegistered.end() && it->second.owner == owner) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (epoll_ctl(hEpoll, op, hSocket, &ev) != 0) {
+            op = (errno == ENOENT) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+            if (epoll_ctl(hEpoll, op, hSocket, &ev) != 0) {
+                LogPrintf("socket epoll_ctl error %s\n", NetworkErrorString(WSAGetLastError()));
+                mapRegistered.erase(hSocket);
+                return;
+            }
+        }
+        Registration& reg = mapRegistered[hSocket];
+        reg.owner = owner;
+        reg.events = events;
+        reg.nRound = nRound;
+    }
+#endif
+
+public:
+    CSocketEvents()
+    {
+#ifdef USE_EPOLL
+        nRound = 0;
+        hEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (hEpoll == -1)
+            LogPrintf("socket epoll_create error %s, falling back to select()\n", NetworkErrorString(WSAGetLastError()));
+#endif
+        Clear();
+    }
+
+    ~CSocketEvents()
+    {
+#ifdef USE_EPOLL
+        if (hEpoll != -1)
+            close(hEpoll);
+#endif
+    }
+
+    //! Start a new round
+    void Clear()
+    {
+        FD_ZERO(&fdsetRecv);
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        hSocketMax = 0;
+        have_fds = false;
+#ifdef USE_EPOLL
+        nRound++;
+        mapReady.clear();
+#endif
+    }
+
+    /**
+     * Wait for hSocket, owned by owner (a CNode or listening socket), to
+     * become readable and/or writable; errors are always reported. Returns
+     * false if the socket cannot be waited for.
+     */
+    bool Add(SOCKET hSocket, const void* owner, bool fRecv, bool fSend)
+    {
+#ifdef USE_EPOLL
+        if (hEpoll != -1) {
+            Register(hSocket, owner, (fRecv ? EPOLLIN : 0) | (fSend ? EPOLLOUT : 0));
+            return true;
+        }
+#endif
+#ifndef WIN32
+        if (hSocket >= FD_SETSIZE)
+            return false;
+#endif
+        FD_SET(hSocket, &fdsetError);
+        if (fRecv)
+            FD_SET(hSocket, &fdsetRecv);
+        if (fSend)
+            FD_SET(hSocket, &fdsetSend);
+        hSocketMax = max(hSocketMax, hSocket);
+        have_fds = true;
+        return true;
+    }
+
+    //! Wait up to nTimeout milliseconds for any added socket to become ready
+    void Wait(int64_t nTimeout)
+    {
+#ifdef USE_EPOLL
+        if (hEpoll != -1) {
+            // Sockets not added this round are no longer waited for
+            for (std::map<SOCKET, Registration>::iterator it = mapRegistered.begin(); it != mapRegistered.end(); ) {
+                if (it->second.nRound != nRound) {
+                    // Fails harmlessly if the socket was closed meanwhile
+                    struct epoll_event ev;
+                    memset(&ev, 0, sizeof(ev));
+                    epoll_ctl(hEpoll, EPOLL_CTL_DEL, it->first, &ev);
+                    mapRegistered.erase(it++);
+                } else {
+                    ++it;
+                }
+            }
+
+            vEvents.resize(std::max(mapRegistered.size(), (size_t)16));
+            int nEvents = epoll_wait(hEpoll, &vEvents[0], vEvents.size(), nTimeout);
+            if (nEvents == -1) {
+                int nErr = WSAGetLastError();
+                if (nErr != WSAEINTR)
+                    LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+                MilliSleep(nTimeout);
+                return;
+            }
+            for (int i = 0; i < nEvents; i++) {
+                int& nReady = mapReady[vEvents[i].data.fd];
+                if (vEvents[i].events & EPOLLIN)
+                    nReady |= RECV;
+                if (vEvents[i].events & EPOLLOUT)
+                    nReady |= SEND;
+                if (vEvents[i].events & (EPOLLERR | EPOLLHUP))
+                    nReady |= ERR;
+            }
+            return;
+        }
+#endif
+        struct timeval timeout = MillisToTimeval(nTimeout);
+        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        if (nSelect == SOCKET_ERROR)
+        {
+            if (have_fds)
+            {
+                int nErr = WSAGetLastError();
+                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+                for (unsigned int i = 0; i <= hSocketMax; i++)
+                    FD_SET(i, &fdsetRecv);
+            }
+            FD_ZERO(&fdsetSend);
+            FD_ZERO(&fdsetError);
+            MilliSleep(nTimeout);
+        }
+    }
+
+    //! Readiness of hSocket (RECV, SEND and/or ERR) after the last Wait()
+    int Get(SOCKET hSocket) const
+    {
+#ifdef USE_EPOLL
+        if (hEpoll != -1) {
+            std::map<SOCKET, int>::const_iterator it = mapReady.find(hSocket);
+            return it == mapReady.end() ? 0 : it->second;
+        }
+#endif
+#ifndef WIN32
+        if (hSocket >= FD_SETSIZE)
+            return 0;
+#endif
+        return (FD_ISSET(hSocket, &fdsetRecv) ? RECV : 0) |
+               (FD_ISSET(hSocket, &fdsetSend) ? SEND : 0) |
+               (FD_ISSET(hSocket, &fdsetError) ? ERR : 0);
+    }
+};
+
 void ThreadSocketHandler()
 {
+    CSocketEvents events;
     unsigned int nPrevNodeCount = 0;
     while (true)
     {
@@ -1455,23 +1741,12 @@ void ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
+        int64_t nTimeout = 50; // frequency to poll pnode->vSend, in milliseconds
 
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
+        events.Clear();
 
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
+            events.Add(hListenSocket.socket, &hListenSocket, true, false);
         }
 
         {
@@ -1483,18 +1758,14 @@ void ThreadSocketHandler()
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
 
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
                 // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
+                // * If there is data to send, wait for sending data. As this only
                 //   happens when optimistic write failed, we choose to first drain the
                 //   write buffer in this case before receiving more. This avoids
                 //   needlessly queueing received data, if the remote peer is not themselves
                 //   receiving data. This means properly utilizing TCP flow control signalling.
                 // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
+                //   or there is space left in the buffer, wait for receiving data.
                 // * (if neither of the above applies, there is certainly one message
                 //   in the receiver buffer ready to be processed).
                 // Together, that means that at least one of the following is always possible,
@@ -1502,47 +1773,51 @@ void ThreadSocketHandler()
                 // * We send some data.
                 // * We wait for data to be received (and disconnect after timeout).
                 // * We process a message in the buffer (message handler thread).
+                // A TLS connection may have to read to make progress on a write, or
+                // write to make progress on a read; it then waits for the direction
+                // OpenSSL asked for.
+                bool fRecv = false, fSend = false;
                 {
                     TRY_LOCK(pnode->cs_vSend, lockSend);
                     if (lockSend && !pnode->vSendMsg.empty()) {
-                        FD_SET(pnode->hSocket, &fdsetSend);
-                        continue;
+                        if (pnode->nSSLWriteWant == SSL_ERROR_WANT_READ)
+                            fRecv = true;
+                        else
+                            fSend = true;
                     }
                 }
+                if (!fRecv && !fSend)
                 {
                     TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                     if (lockRecv && (
                         pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
-                        pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pnode->hSocket, &fdsetRecv);
+                        pnode->GetTotalRecvSize() <= ReceiveFloodSize())) {
+                        if (pnode->nSSLReadWant == SSL_ERROR_WANT_WRITE)
+                            fSend = true;
+                        else
+                            fRecv = true;
+                        // Records OpenSSL has already read are not signalled by the socket
+                        if (pnode->ssl && SSL_pending(pnode->ssl) > 0)
+                            nTimeout = 0;
+                    }
+                }
+
+                if (!events.Add(pnode->hSocket, pnode, fRecv, fSend)) {
+                    LogPrintf("socket %d of peer=%d cannot be waited for; disconnecting\n", pnode->hSocket, pnode->id);
+                    pnode->fDisconnect = true;
                 }
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        events.Wait(nTimeout);
         boost::this_thread::interruption_point();
 
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec/1000);
-        }
-
         //
         // Accept new connections
         //
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && (events.Get(hListenSocket.socket) & CSocketEvents::RECV))
             {
                 AcceptConnection(hListenSocket);
             }
@@ -1573,15 +1848,17 @@ void ThreadSocketHandler()
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
 
-                recvSet  = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet  = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+                int nReady = events.Get(pnode->hSocket);
+                recvSet  = (nReady & CSocketEvents::RECV) || (pnode->ssl && SSL_pending(pnode->ssl) > 0);
+                sendSet  = (nReady & CSocketEvents::SEND);
+                errorSet = (nReady & CSocketEvents::ERR);
             }
 
-            if (recvSet || errorSet)
+            if (recvSet || sendSet || errorSet)
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                if (lockRecv)
+                // An SSL_read() that wants to write is retried once the socket is writable
+                if (lockRecv && (errorSet || (pnode->nSSLReadWant == SSL_ERROR_WANT_WRITE ? sendSet : recvSet)))
                 {
                     {
                         // typical socket buffer is 8K-64K
@@ -1606,6 +1883,7 @@ void ThreadSocketHandler()
                                 ERR_clear_error(); // clear the error queue, otherwise we may be reading an old error that occurred previously in the current thread
                                 nBytes = SSL_read(pnode->ssl, pchBuf, sizeof(pchBuf));
                                 nRet = SSL_get_error(pnode->ssl, nBytes);
+                                pnode->nSSLReadWant = (nBytes <= 0 && (nRet == SSL_ERROR_WANT_READ || nRet == SSL_ERROR_WANT_WRITE)) ? nRet : 0;
                             }
                             else
                             {
@@ -1642,12 +1920,8 @@ void ThreadSocketHandler()
                                         LogPrintf("ERROR: SSL_read %s\n", ERR_error_string(nRet, NULL));
                                     pnode->CloseSocketDisconnect();
                                 }
-                                else
-                                {
-                                    // preventive measure from exhausting CPU usage
-                                    //
-                                    MilliSleep(1); // 1 msec
-                                }
+                                // otherwise SSL_read() is retried once the socket
+                                // is ready in the direction recorded in nSSLReadWant
                             }
                             else
                             {
@@ -1666,10 +1940,11 @@ void ThreadSocketHandler()
             //
             // Send
             //
-            if (sendSet)
+            if (sendSet || recvSet)
             {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
-                if (lockSend)
+                // An SSL_write() that wants to read is retried once the socket is readable
+                if (lockSend && (pnode->nSSLWriteWant == SSL_ERROR_WANT_READ ? recvSet : sendSet))
                     SocketSendData(pnode);
             }
 
@@ -2180,7 +2455,7 @@ void ThreadMessageHandler()
 
                     if (pnode->nSendSize < SendBufferSize())
                     {
-                        if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete()))
+                        if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete() && !pnode->vRecvMsg[0].checking()))
                         {
                             fSleep = false;
                         }
@@ -2865,12 +3140,19 @@ bool CAddrDB::Read(CAddrMan& addr)
 unsigned int ReceiveFloodSize() { return 1000*GetArg("-maxreceivebuffer", 5*1000); }
 unsigned int SendBufferSize() { return 1000*GetArg("-maxsendbuffer", 1*1000); }
 
+void WakeMessageHandler()
+{
+    messageHandlerCondition.notify_one();
+}
+
 CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNameIn, bool fInboundIn, SSL *sslIn) :
     ssSend(SER_NETWORK, INIT_PROTO_VERSION),
     addrKnown(5000, 0.001),
     setInventoryKnown(SendBufferSize() / 1000)
 {
     ssl = sslIn;
+    nSSLReadWant = 0;
+    nSSLWriteWant = 0;
     nServices = 0;
     hSocket = hSocketIn;
     nRecvVersion = INIT_PROTO_VERSION;
@@ -3031,6 +3313,10 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
     LogPrint("net", "(%d bytes) peer=%d\n", nSize, id);
 
     std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
+    if (!vSendBufferPool.empty()) {
+        it->swap(vSendBufferPool.back());
+        vSendBufferPool.pop_back();
+    }
     ssSend.GetAndClear(*it);
     nSendSize += (*it).size();
 
@@ -19,7 +19,9 @@
 #include "uint256.h"
 #include "utilstrencodings.h"
 
+#include <atomic>
 #include <deque>
+#include <memory>
 #include <stdint.h>
 
 #ifndef WIN32
@@ -70,6 +72,8 @@ static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 125;
 
 unsigned int ReceiveFloodSize();
 unsigned int SendBufferSize();
+/** Wake the message handler thread, e.g. when a message check completes */
+void WakeMessageHandler();
 
 void AddOneShot(const std::string& strDest);
 void AddressCurrentlyConnected(const CService& addr);
@@ -217,6 +221,18 @@ public:
 
 
 
+/**
+ * Outcome of the checks of a received message run on a message check thread,
+ * ahead of its processing by the message handler (see ProcessMessages).
+ */
+class CNetMessageCheck {
+public:
+    std::atomic<bool> fDone;
+    unsigned int nChecksum;         // computed checksum, valid once fDone is set
+
+    CNetMessageCheck() : fDone(false), nChecksum(0) {}
+};
+
 class CNetMessage {
 public:
     bool in_data;                   // parsing header (false) or data (true)
@@ -230,6 +246,8 @@ public:
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
+    std::shared_ptr<CNetMessageCheck> check; // set once the message is queued for checking
+
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
         in_data = false;
@@ -245,6 +263,11 @@ public:
         return (hdr.nMessageSize == nDataPos);
     }
 
+    bool checking() const
+    {
+        return check && !check->fDone;
+    }
+
     void SetVersion(int nVersionIn)
     {
         hdrbuf.SetVersion(nVersionIn);
@@ -265,6 +288,10 @@ class CNode
 public:
     // OpenSSL
     SSL *ssl;
+    // SSL_ERROR_WANT_READ or SSL_ERROR_WANT_WRITE if the last SSL_read() (under
+    // cs_vRecvMsg) or SSL_write() (under cs_vSend) has to be repeated, else 0
+    int nSSLReadWant;
+    int nSSLWriteWant;
     
     // socket
     uint64_t nServices;
@@ -275,6 +302,7 @@ public:
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
     std::deque<CSerializeData> vSendMsg;
+    std::vector<CSerializeData> vSendBufferPool; // cleared buffers of sent messages, reused by EndMessage
     CCriticalSection cs_vSend;
 
     std::deque<CInv> vRecvGetData;
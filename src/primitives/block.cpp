@@ -9,13 +9,14 @@
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 
 uint256 CBlockHeader::GetHash() const
 {
     return SerializeHash(*this);
 }
 
-uint256 CBlock::BuildMerkleTree(bool* fMutated) const
+uint256 CBlock::BuildMerkleTree(bool* fMutated, MerkleLevelHasher hashLevel) const
 {
     /* WARNING! If you're reading this because you're learning about crypto
        and/or designing a new system that will use merkle trees, keep in mind
@@ -60,15 +61,18 @@ uint256 CBlock::BuildMerkleTree(bool* fMutated) const
     bool mutated = false;
     for (int nSize = vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
     {
-        for (int i = 0; i < nSize; i += 2)
-        {
-            int i2 = std::min(i+1, nSize-1);
-            if (i2 == i + 1 && i2 + 1 == nSize && vMerkleTree[j+i] == vMerkleTree[j+i2]) {
-                // Two identical hashes at the end of the list at a particular level.
-                mutated = true;
-            }
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
-                                       BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
+        if (nSize % 2 == 0 && vMerkleTree[j+nSize-2] == vMerkleTree[j+nSize-1]) {
+            // Two identical hashes at the end of the list at a particular level.
+            mutated = true;
+        }
+        // The pairs of a level are adjacent 64-byte blobs, so they are
+        // hashed as one batch; an odd last hash is paired with itself.
+        int nPairs = nSize / 2;
+        vMerkleTree.resize(j + nSize + (nSize + 1) / 2);
+        hashLevel(vMerkleTree[j+nSize].begin(), vMerkleTree[j].begin(), nPairs);
+        if (nSize % 2 == 1) {
+            const uint256& last = vMerkleTree[j+nSize-1];
+            vMerkleTree[j+nSize+nPairs] = Hash(BEGIN(last), END(last), BEGIN(last), END(last));
         }
         j += nSize;
     }
@@ -9,6 +9,10 @@
 #include "primitives/transaction.h"
 #include "serialize.h"
 #include "uint256.h"
+#include "crypto/sha256.h"
+
+/** Hashes nPairs adjacent 64-byte blobs of a merkle tree level into the next one */
+typedef void (*MerkleLevelHasher)(unsigned char* out, const unsigned char* in, size_t nPairs);
 
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
@@ -85,6 +89,8 @@ public:
 
     // memory only
     mutable std::vector<uint256> vMerkleTree;
+    //! The header (Equihash solution included) and merkle root are known valid
+    mutable bool fChecked;
 
     CBlock()
     {
@@ -101,6 +107,11 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        if (ser_action.ForRead()) {
+            // Nothing derived from former contents holds for the ones read
+            vMerkleTree.clear();
+            fChecked = false;
+        }
         READWRITE(*(CBlockHeader*)this);
         READWRITE(vtx);
     }
@@ -110,6 +121,7 @@ public:
         CBlockHeader::SetNull();
         vtx.clear();
         vMerkleTree.clear();
+        fChecked = false;
     }
 
     CBlockHeader GetBlockHeader() const
@@ -129,8 +141,9 @@ public:
     // Build the in-memory merkle tree for this block and return the merkle root.
     // If non-NULL, *mutated is set to whether mutation was detected in the merkle
     // tree (a duplication of transactions in the block leading to an identical
-    // merkle root).
-    uint256 BuildMerkleTree(bool* mutated = NULL) const;
+    // merkle root). The pairs of each level are hashed by hashLevel, which
+    // callers may spread over threads.
+    uint256 BuildMerkleTree(bool* mutated = NULL, MerkleLevelHasher hashLevel = SHA256D64) const;
 
     std::vector<uint256> GetMerkleBranch(int nIndex) const;
     static uint256 CheckMerkleBranch(uint256 hash, const std::vector<uint256>& vMerkleBranch, int nIndex);
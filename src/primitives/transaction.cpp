@@ -16,11 +16,13 @@ JSDescription::JSDescription(ZCJoinSplit& params,
             const boost::array<libzcash::JSOutput, ZC_NUM_JS_OUTPUTS>& outputs,
             CAmount vpub_old,
             CAmount vpub_new,
-            bool computeProof) : vpub_old(vpub_old), vpub_new(vpub_new), anchor(anchor)
+            bool computeProof,
+            JSProofWitness* pwitness) : vpub_old(vpub_old), vpub_new(vpub_new), anchor(anchor)
 {
     boost::array<libzcash::Note, ZC_NUM_JS_OUTPUTS> notes;
+    uint252 phi;
 
-    if (computeProof) {
+    if (computeProof || pwitness) {
         params.loadProvingKey();
     }
     proof = params.prove(
@@ -37,8 +39,21 @@ JSDescription::JSDescription(ZCJoinSplit& params,
         vpub_old,
         vpub_new,
         anchor,
-        computeProof
+        computeProof,
+        &phi
     );
+
+    if (pwitness) {
+        pwitness->inputs = inputs;
+        pwitness->notes = notes;
+        pwitness->phi = phi;
+        pwitness->h_sig = h_sig(params, pubKeyHash);
+    }
+}
+
+void JSDescription::Prove(ZCJoinSplit& params, const JSProofWitness& witness)
+{
+    proof = params.proveDeferred(witness.inputs, witness.notes, witness.phi, witness.h_sig, vpub_old, vpub_new, anchor);
 }
 
 JSDescription JSDescription::Randomized(
@@ -57,7 +72,8 @@ JSDescription JSDescription::Randomized(
             CAmount vpub_old,
             CAmount vpub_new,
             bool computeProof,
-            std::function<int(int)> gen)
+            std::function<int(int)> gen,
+            JSProofWitness* pwitness)
 {
     // Randomize the order of the inputs and outputs
     inputMap = {0, 1};
@@ -70,7 +86,7 @@ JSDescription JSDescription::Randomized(
 
     return JSDescription(
         params, pubKeyHash, anchor, inputs, outputs,
-        vpub_old, vpub_new, computeProof);
+        vpub_old, vpub_new, computeProof, pwitness);
 }
 
 bool JSDescription::Verify(
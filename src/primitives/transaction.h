@@ -20,6 +20,19 @@
 #include "zcash/JoinSplit.hpp"
 #include "zcash/Proof.hpp"
 
+/**
+ * What computing the proof of a JoinSplit set up without one takes, so that
+ * the proof can be computed later, e.g. on another thread (see
+ * JSDescription::Prove).
+ */
+struct JSProofWitness
+{
+    boost::array<libzcash::JSInput, ZC_NUM_JS_INPUTS> inputs;
+    boost::array<libzcash::Note, ZC_NUM_JS_OUTPUTS> notes;
+    uint252 phi;
+    uint256 h_sig;
+};
+
 class JSDescription
 {
 public:
@@ -77,7 +90,8 @@ public:
             const boost::array<libzcash::JSOutput, ZC_NUM_JS_OUTPUTS>& outputs,
             CAmount vpub_old,
             CAmount vpub_new,
-            bool computeProof = true // Set to false in some tests
+            bool computeProof = true, // Set to false in some tests
+            JSProofWitness* pwitness = NULL // Set to compute the proof later
     );
 
     static JSDescription Randomized(
@@ -96,9 +110,14 @@ public:
             CAmount vpub_old,
             CAmount vpub_new,
             bool computeProof = true, // Set to false in some tests
-            std::function<int(int)> gen = GetRandInt
+            std::function<int(int)> gen = GetRandInt,
+            JSProofWitness* pwitness = NULL // Set to compute the proof later
     );
 
+    // Computes the proof of a JoinSplit set up with computeProof false,
+    // from the witness it returned. The proving key must be loaded.
+    void Prove(ZCJoinSplit& params, const JSProofWitness& witness);
+
     // Verifies that the JoinSplit proof is correct.
     bool Verify(
         ZCJoinSplit& params,
@@ -7,8 +7,11 @@
 #include "consensus/validation.h"
 #include "main.h"
 #include "primitives/transaction.h"
+#include "rpcjsoncache.h"
 #include "rpcserver.h"
+#include "script/sigcache.h"
 #include "sync.h"
+#include "txdb.h"
 #include "util.h"
 
 #include <stdint.h>
@@ -88,7 +91,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     result.push_back(Pair("merkleroot", blockindex->hashMerkleRoot.GetHex()));
     result.push_back(Pair("time", (int64_t)blockindex->nTime));
     result.push_back(Pair("nonce", blockindex->nNonce.GetHex()));
-    result.push_back(Pair("solution", HexStr(blockindex->nSolution)));
+    result.push_back(Pair("solution", HexStr(blockindex->GetSolution())));
     result.push_back(Pair("bits", strprintf("%08x", blockindex->nBits)));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
     result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
@@ -101,15 +104,10 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+/** The fields of blockToJSON that do not depend on the active chain */
+static UniValue blockBodyToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
 {
     UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hash", block.GetHash().GetHex()));
-    int confirmations = -1;
-    // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
-    result.push_back(Pair("confirmations", confirmations));
     result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
     result.push_back(Pair("height", blockindex->nHeight));
     result.push_back(Pair("version", block.nVersion));
@@ -137,12 +135,40 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
+    return result;
+}
+
+/** The fields of blockToJSON placed before the body */
+static UniValue blockHeadToJSON(const CBlockIndex* blockindex)
+{
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
+    int confirmations = -1;
+    // Only report confirmations if the block is on the main chain
+    if (chainActive.Contains(blockindex))
+        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    result.push_back(Pair("confirmations", confirmations));
+    return result;
+}
+
+/** The fields of blockToJSON placed after the body */
+static UniValue blockTailToJSON(const CBlockIndex* blockindex)
+{
+    UniValue result(UniValue::VOBJ);
     CBlockIndex *pnext = chainActive.Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     return result;
 }
 
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+{
+    UniValue result = blockHeadToJSON(blockindex);
+    result.pushKVs(blockBodyToJSON(block, blockindex, txDetails));
+    result.pushKVs(blockTailToJSON(blockindex));
+    return result;
+}
+
 UniValue getblockcount(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -200,10 +226,9 @@ UniValue mempoolToJSON(bool fVerbose = false)
     {
         LOCK(mempool.cs);
         UniValue o(UniValue::VOBJ);
-        BOOST_FOREACH(const PAIRTYPE(uint256, CTxMemPoolEntry)& entry, mempool.mapTx)
+        BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
         {
-            const uint256& hash = entry.first;
-            const CTxMemPoolEntry& e = entry.second;
+            const uint256& hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
             info.push_back(Pair("size", (int)e.GetTxSize()));
             info.push_back(Pair("fee", ValueFromAmount(e.GetFee())));
@@ -211,6 +236,12 @@ UniValue mempoolToJSON(bool fVerbose = false)
             info.push_back(Pair("height", (int)e.GetHeight()));
             info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
             info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
+            info.push_back(Pair("descendantcount", e.GetCountWithDescendants()));
+            info.push_back(Pair("descendantsize", e.GetSizeWithDescendants()));
+            info.push_back(Pair("descendantfees", e.GetModFeesWithDescendants()));
+            info.push_back(Pair("ancestorcount", e.GetCountWithAncestors()));
+            info.push_back(Pair("ancestorsize", e.GetSizeWithAncestors()));
+            info.push_back(Pair("ancestorfees", e.GetModFeesWithAncestors()));
             const CTransaction& tx = e.GetTx();
             set<string> setDepends;
             BOOST_FOREACH(const CTxIn& txin, tx.vin)
@@ -265,6 +296,12 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
             "    \"height\" : n,           (numeric) block height when transaction entered pool\n"
             "    \"startingpriority\" : n, (numeric) priority when transaction entered pool\n"
             "    \"currentpriority\" : n,  (numeric) transaction priority now\n"
+            "    \"descendantcount\" : n,  (numeric) number of in-mempool descendant transactions (including this one)\n"
+            "    \"descendantsize\" : n,   (numeric) size of in-mempool descendants (including this one)\n"
+            "    \"descendantfees\" : n,   (numeric) fees in zatoshis, including prioritisation, of in-mempool descendants (including this one)\n"
+            "    \"ancestorcount\" : n,    (numeric) number of in-mempool ancestor transactions (including this one)\n"
+            "    \"ancestorsize\" : n,     (numeric) size of in-mempool ancestors (including this one)\n"
+            "    \"ancestorfees\" : n,     (numeric) fees in zatoshis, including prioritisation, of in-mempool ancestors (including this one)\n"
             "    \"depends\" : [           (array) unconfirmed transactions used as inputs for this transaction\n"
             "        \"transactionid\",    (string) parent transaction id\n"
             "       ... ]\n"
@@ -309,6 +346,40 @@ UniValue getblockhash(const UniValue& params, bool fHelp)
     return pblockindex->GetBlockHash().GetHex();
 }
 
+UniValue getblockhashes(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 2)
+        throw runtime_error(
+            "getblockhashes high low\n"
+            "\nReturns the hashes of the best-block-chain blocks with a timestamp in [low, high).\n"
+            "Requires -timestampindex.\n"
+            "\nArguments:\n"
+            "1. high         (numeric, required) The newer block timestamp, exclusive\n"
+            "2. low          (numeric, required) The older block timestamp, inclusive\n"
+            "\nResult:\n"
+            "[\n"
+            "  \"hash\"         (string) The block hash\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockhashes", "1231614698 1231024505")
+            + HelpExampleRpc("getblockhashes", "1231614698, 1231024505")
+        );
+
+    unsigned int high = params[0].get_int();
+    unsigned int low = params[1].get_int();
+    std::vector<uint256> blockHashes;
+
+    if (!GetTimestampIndex(high, low, blockHashes))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
+
+    UniValue result(UniValue::VARR);
+    for (std::vector<uint256>::const_iterator it = blockHashes.begin(); it != blockHashes.end(); it++)
+        result.push_back(it->GetHex());
+
+    return result;
+}
+
 UniValue getblockheader(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
@@ -365,17 +436,68 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
     return blockheaderToJSON(pblockindex);
 }
 
+/** Block index of the hash or height parameter of getblock */
+static CBlockIndex* getblockIndex(const UniValue& param)
+{
+    AssertLockHeld(cs_main);
+
+    std::string strHash = param.get_str();
+
+    // If height is supplied, find the hash
+    if (strHash.size() < (2 * sizeof(uint256))) {
+        // std::stoi allows characters, whereas we want to be strict
+        regex r("[[:digit:]]+");
+        if (!regex_match(strHash, r)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+        }
+
+        int nHeight = -1;
+        try {
+            nHeight = std::stoi(strHash);
+        }
+        catch (const std::exception &e) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+        }
+
+        if (nHeight < 0 || nHeight > chainActive.Height()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        }
+        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
+    }
+
+    uint256 hash(uint256S(strHash));
+
+    BlockMap::iterator mi = mapBlockIndex.find(hash);
+    if (mi == mapBlockIndex.end())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    return mi->second;
+}
+
+/** Verbosity parameter of getblock; true and false are accepted for 1 and 0 */
+static int getblockVerbosity(const UniValue& params)
+{
+    if (params.size() < 2)
+        return 1;
+    if (params[1].isBool())
+        return params[1].get_bool() ? 1 : 0;
+    int verbosity = params[1].get_int();
+    if (verbosity < 0 || verbosity > 2)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be 0, 1 or 2");
+    return verbosity;
+}
+
 UniValue getblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
-            "getblock \"hash|height\" ( verbose )\n"
-            "\nIf verbose is false, returns a string that is serialized, hex-encoded data for block 'hash|height'.\n"
-            "If verbose is true, returns an Object with information about block <hash|height>.\n"
+            "getblock \"hash|height\" ( verbosity )\n"
+            "\nIf verbosity is 0 (or false), returns a string that is serialized, hex-encoded data for block 'hash|height'.\n"
+            "If verbosity is 1 (or true), returns an Object with information about block <hash|height>.\n"
+            "If verbosity is 2, returns an Object with information about block <hash|height> and information about each transaction.\n"
             "\nArguments:\n"
             "1. \"hash|height\"     (string, required) The block hash or height\n"
-            "2. verbose           (boolean, optional, default=true) true for a json object, false for the hex encoded data\n"
-            "\nResult (for verbose = true):\n"
+            "2. verbosity         (numeric or boolean, optional, default=1) 0 for the hex encoded data, 1 for a json object, 2 for a json object with transaction data\n"
+            "\nResult (for verbosity = 1):\n"
             "{\n"
             "  \"hash\" : \"hash\",       (string) the block hash (same as provided hash)\n"
             "  \"confirmations\" : n,   (numeric) The number of confirmations, or -1 if the block is not on the main chain\n"
@@ -394,7 +516,15 @@ UniValue getblock(const UniValue& params, bool fHelp)
             "  \"previousblockhash\" : \"hash\",  (string) The hash of the previous block\n"
             "  \"nextblockhash\" : \"hash\"       (string) The hash of the next block\n"
             "}\n"
-            "\nResult (for verbose=false):\n"
+            "\nResult (for verbosity = 2):\n"
+            "{\n"
+            "  ...,                   Same output as verbosity = 1\n"
+            "  \"tx\" : [               (array of Objects) The transactions in the format of the getrawtransaction RPC, without the chain fields\n"
+            "         ,...\n"
+            "  ],\n"
+            "  ,...                   Same output as verbosity = 1\n"
+            "}\n"
+            "\nResult (for verbosity = 0):\n"
             "\"data\"             (string) A string that is serialized, hex-encoded data for block 'hash'.\n"
             "\nExamples:\n"
             + HelpExampleCli("getblock", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
@@ -405,57 +535,62 @@ UniValue getblock(const UniValue& params, bool fHelp)
 
     LOCK(cs_main);
 
-    std::string strHash = params[0].get_str();
+    CBlockIndex* pblockindex = getblockIndex(params[0]);
+    int verbosity = getblockVerbosity(params);
 
-    // If height is supplied, find the hash
-    if (strHash.size() < (2 * sizeof(uint256))) {
-        // std::stoi allows characters, whereas we want to be strict
-        regex r("[[:digit:]]+");
-        if (!regex_match(strHash, r)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
-
-        int nHeight = -1;
-        try {
-            nHeight = std::stoi(strHash);
-        }
-        catch (const std::exception &e) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
+    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
 
-        if (nHeight < 0 || nHeight > chainActive.Height()) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
-        }
-        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
+    if (verbosity == 0)
+    {
+        // The block as it is stored, without decoding it
+        CRawBlock rawBlock;
+        if (!ReadRawBlockFromDisk(rawBlock, pblockindex))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        return HexStr(rawBlock.begin(), rawBlock.end());
     }
 
-    uint256 hash(uint256S(strHash));
+    CBlock block;
+    if(!ReadBlockFromDisk(block, pblockindex))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
-    bool fVerbose = true;
-    if (params.size() > 1)
-        fVerbose = params[1].get_bool();
+    return blockToJSON(block, pblockindex, verbosity > 1);
+}
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+/**
+ * getblock for verbosity 1 and 2, written from the JSON cache. Only the
+ * confirmations and the next block hash are computed on a cache hit; a
+ * miss decodes the block and builds its body once to fill the cache.
+ */
+bool getblockjson(const UniValue& params, JSONChunks& chunks)
+{
+    if (params.size() < 1 || params.size() > 2)
+        return false;
 
-    CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    int verbosity = getblockVerbosity(params);
+    if (verbosity == 0)
+        return false;
+
+    LOCK(cs_main);
+
+    CBlockIndex* pblockindex = getblockIndex(params[0]);
 
     if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
 
-    if(!ReadBlockFromDisk(block, pblockindex))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
-
-    if (!fVerbose)
-    {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+    uint256 hash = pblockindex->GetBlockHash();
+    CRPCJSONCache::Entry entry;
+    if (!rpcJSONCache.Get(CRPCJSONCache::BLOCK, hash, verbosity, entry)) {
+        CBlock block;
+        if(!ReadBlockFromDisk(block, pblockindex))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        entry.members = JSONMembers(blockBodyToJSON(block, pblockindex, verbosity > 1));
+        entry.hashBlock = hash;
+        rpcJSONCache.Put(CRPCJSONCache::BLOCK, hash, verbosity, entry);
     }
 
-    return blockToJSON(block, pblockindex);
+    AppendJSONObject(chunks, blockHeadToJSON(pblockindex), entry.members, blockTailToJSON(pblockindex));
+    return true;
 }
 
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
@@ -496,6 +631,168 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
     return ret;
 }
 
+static UniValue LevelDBInfoToJSON(const CLevelDBWrapper& db, const std::vector<std::pair<std::string, uint64_t> >& vSizes)
+{
+    const CLevelDBOptions& dbOptions = db.GetDBOptions();
+    UniValue options(UniValue::VOBJ);
+    options.push_back(Pair("cache", (uint64_t)dbOptions.nCacheSize));
+    options.push_back(Pair("blockcache", (uint64_t)dbOptions.GetBlockCacheSize()));
+    options.push_back(Pair("writebuffer", (uint64_t)dbOptions.GetWriteBufferSize()));
+    options.push_back(Pair("maxfilesize", (uint64_t)dbOptions.nMaxFileSize));
+    options.push_back(Pair("bloombits", dbOptions.nBloomBits));
+
+    CLevelDBStats stats;
+    db.GetStats(stats);
+
+    UniValue sizes(UniValue::VOBJ);
+    BOOST_FOREACH(const PAIRTYPE(std::string, uint64_t)& item, vSizes)
+        sizes.push_back(Pair(item.first, item.second));
+
+    UniValue levels(UniValue::VARR);
+    BOOST_FOREACH(const CLevelDBLevelStats& level, stats.vLevels) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("level", level.nLevel));
+        obj.push_back(Pair("files", level.nFiles));
+        obj.push_back(Pair("sizemb", level.dSizeMB));
+        obj.push_back(Pair("compactiontime", level.dCompactionSeconds));
+        obj.push_back(Pair("readmb", level.dReadMB));
+        obj.push_back(Pair("writtenmb", level.dWrittenMB));
+        levels.push_back(obj);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("path", db.GetPath()));
+    ret.push_back(Pair("options", options));
+    ret.push_back(Pair("approximatesize", stats.nApproximateSize));
+    ret.push_back(Pair("sizes", sizes));
+    ret.push_back(Pair("writes", stats.nWrites));
+    ret.push_back(Pair("writetime", stats.nWriteMicros * 0.000001));
+    ret.push_back(Pair("maxwritetime", stats.nMaxWriteMicros * 0.000001));
+    ret.push_back(Pair("slowwrites", stats.nSlowWrites));
+    ret.push_back(Pair("levels", levels));
+    ret.push_back(Pair("stats", db.GetProperty("leveldb.stats")));
+    return ret;
+}
+
+UniValue getdbstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getdbstats\n"
+            "\nReturns the tuning, write timings and compaction statistics of the LevelDB databases.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"chainstate\": {             (json object) the coins database\n"
+            "    \"path\": \"path\",           (string) the database directory\n"
+            "    \"options\": {              (json object) the tuning it was opened with, sizes in bytes\n"
+            "      \"cache\": n, \"blockcache\": n, \"writebuffer\": n, \"maxfilesize\": n,\n"
+            "      \"bloombits\": n\n"
+            "    },\n"
+            "    \"approximatesize\": n,     (numeric) approximate size on disk in bytes\n"
+            "    \"sizes\": {                (json object) approximate size on disk of each kind of record\n"
+            "      \"name\": n, ...\n"
+            "    },\n"
+            "    \"writes\": n,              (numeric) number of batches written since startup\n"
+            "    \"writetime\": x.xxx,       (numeric) total time spent writing them, in seconds\n"
+            "    \"maxwritetime\": x.xxx,    (numeric) the longest write, in seconds\n"
+            "    \"slowwrites\": n,          (numeric) writes that took longer than " + itostr(LEVELDB_SLOW_WRITE_MS) + "ms\n"
+            "    \"levels\": [               (array) compaction statistics per level\n"
+            "      {\"level\": n, \"files\": n, \"sizemb\": x.x, \"compactiontime\": x.x, \"readmb\": x.x, \"writtenmb\": x.x}, ...\n"
+            "    ],\n"
+            "    \"stats\": \"...\",           (string) the raw leveldb.stats property\n"
+            "    \"flush\": {                (json object) chainstate only: writes of the coins cache\n"
+            "      \"flushes\": n,           (numeric) cache flushes committed since startup\n"
+            "      \"backgroundflushes\": n, (numeric) how many of them were written in the background\n"
+            "      \"pending\": true|false,  (boolean) whether a background write is in progress\n"
+            "      \"lastflushtime\": n,     (numeric) when the last flush was committed, in seconds since epoch\n"
+            "      \"lastflushentries\": n,  (numeric) coins, anchors and nullifiers it wrote\n"
+            "      \"lastflushduration\": x.xxx, (numeric) time it took to write, in seconds\n"
+            "      \"lastflushwait\": x.xxx,  (numeric) time it blocked validation, in seconds\n"
+            "      \"totalflushtime\": x.xxx, (numeric) total write time since startup, in seconds\n"
+            "      \"totalflushwait\": x.xxx  (numeric) total time validation was blocked, in seconds\n"
+            "    }\n"
+            "  },\n"
+            "  \"blockindex\": { ... }       (json object) the block index database, same fields but flush\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    LOCK(cs_main);
+
+    UniValue ret(UniValue::VOBJ);
+    if (pcoinsdbview) {
+        CCoinsFlushStats flushStats;
+        pcoinsdbview->GetFlushStats(flushStats);
+        UniValue flush(UniValue::VOBJ);
+        flush.push_back(Pair("flushes", flushStats.nFlushes));
+        flush.push_back(Pair("backgroundflushes", flushStats.nBackgroundFlushes));
+        flush.push_back(Pair("pending", flushStats.fPending));
+        flush.push_back(Pair("lastflushtime", flushStats.nLastFlushTime));
+        flush.push_back(Pair("lastflushentries", flushStats.nLastFlushEntries));
+        flush.push_back(Pair("lastflushduration", flushStats.nLastFlushMicros * 0.000001));
+        flush.push_back(Pair("lastflushwait", flushStats.nLastWaitMicros * 0.000001));
+        flush.push_back(Pair("totalflushtime", flushStats.nTotalFlushMicros * 0.000001));
+        flush.push_back(Pair("totalflushwait", flushStats.nTotalWaitMicros * 0.000001));
+
+        UniValue chainstate = LevelDBInfoToJSON(pcoinsdbview->GetDB(), pcoinsdbview->EstimateSizes());
+        chainstate.push_back(Pair("flush", flush));
+        ret.push_back(Pair("chainstate", chainstate));
+    }
+    if (pblocktree)
+        ret.push_back(Pair("blockindex", LevelDBInfoToJSON(*pblocktree, pblocktree->EstimateSizes())));
+    return ret;
+}
+
+UniValue getspentinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1 || !params[0].isObject())
+        throw runtime_error(
+            "getspentinfo {\"txid\": \"txid\", \"index\": n}\n"
+            "\nReturns the txid, input index and height of the input spending an output.\n"
+            "Requires -spentindex.\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"txid\" (string) The hex string of the txid\n"
+            "  \"index\" (number) The output index\n"
+            "}\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"txid\"  (string) The spending transaction id\n"
+            "  \"index\"  (number) The spending input index\n"
+            "  \"height\"  (number) The height of the block containing the spending transaction\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getspentinfo", "'{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}'")
+            + HelpExampleRpc("getspentinfo", "{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}")
+        );
+
+    UniValue txidValue = find_value(params[0].get_obj(), "txid");
+    UniValue indexValue = find_value(params[0].get_obj(), "index");
+
+    if (!txidValue.isStr() || !indexValue.isNum())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid txid or index");
+
+    uint256 txid = ParseHashV(txidValue, "txid");
+    int outputIndex = indexValue.get_int();
+    if (outputIndex < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid index");
+
+    CSpentIndexKey key(txid, outputIndex);
+    CSpentIndexValue value;
+
+    if (!GetSpentIndex(key, value))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("txid", value.txid.GetHex()));
+    obj.push_back(Pair("index", (int)value.inputIndex));
+    obj.push_back(Pair("height", value.blockHeight));
+
+    return obj;
+}
+
 UniValue gettxout(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 2 || params.size() > 3)
@@ -846,6 +1143,9 @@ UniValue mempoolInfoToJSON()
     ret.push_back(Pair("size", (int64_t) mempool.size()));
     ret.push_back(Pair("bytes", (int64_t) mempool.GetTotalTxSize()));
     ret.push_back(Pair("usage", (int64_t) mempool.DynamicMemoryUsage()));
+    size_t maxmempool = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+    ret.push_back(Pair("maxmempool", (int64_t) maxmempool));
+    ret.push_back(Pair("mempoolminfee", ValueFromAmount(mempool.GetMinFee(maxmempool).GetFeePerK())));
 
     return ret;
 }
@@ -861,6 +1161,8 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
             "  \"size\": xxxxx                (numeric) Current tx count\n"
             "  \"bytes\": xxxxx               (numeric) Sum of all tx sizes\n"
             "  \"usage\": xxxxx               (numeric) Total memory usage for the mempool\n"
+            "  \"maxmempool\": xxxxx          (numeric) Maximum memory usage for the mempool\n"
+            "  \"mempoolminfee\": xxxxx       (numeric) Minimum fee for tx to be accepted\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getmempoolinfo", "")
@@ -870,6 +1172,37 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
     return mempoolInfoToJSON();
 }
 
+UniValue getsigcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getsigcacheinfo\n"
+            "\nReturns details on the signature cache.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": xxxxx                (numeric) Current number of cached signatures\n"
+            "  \"capacity\": xxxxx            (numeric) Maximum number of cached signatures\n"
+            "  \"usage\": xxxxx               (numeric) Total memory usage for the signature cache\n"
+            "  \"hits\": xxxxx                (numeric) Signature checks answered by the cache\n"
+            "  \"misses\": xxxxx              (numeric) Signature checks not found in the cache\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getsigcacheinfo", "")
+            + HelpExampleRpc("getsigcacheinfo", "")
+        );
+
+    CSignatureCacheStats stats;
+    GetSignatureCacheStats(stats);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("size", (int64_t) stats.nEntries));
+    ret.push_back(Pair("capacity", (int64_t) stats.nCapacity));
+    ret.push_back(Pair("usage", (int64_t) stats.nBytes));
+    ret.push_back(Pair("hits", (int64_t) stats.nHits));
+    ret.push_back(Pair("misses", (int64_t) stats.nMisses));
+    return ret;
+}
+
 UniValue invalidateblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -46,6 +46,12 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getbalance", 1 },
     { "getbalance", 2 },
     { "getblockhash", 0 },
+    { "getblockhashes", 0 },
+    { "getblockhashes", 1 },
+    { "getspentinfo", 0 },
+    { "getaddresstxids", 0 },
+    { "getaddressbalance", 0 },
+    { "getaddressutxos", 0 },
     { "move", 2 },
     { "move", 3 },
     { "sendfrom", 2 },
@@ -102,6 +108,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "zcrawjoinsplit", 4 },
     { "zcbenchmark", 1 },
     { "zcbenchmark", 2 },
+    { "zcbenchmark", 3 },
     { "getblocksubsidy", 0},
     { "z_listreceivedbyaddress", 1},
     { "z_getbalance", 1},
@@ -0,0 +1,137 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpcjsoncache.h"
+
+#include "primitives/block.h"
+
+#include <limits>
+
+CRPCJSONCache rpcJSONCache(DEFAULT_RPC_JSON_CACHE_SIZE << 20);
+
+CRPCJSONCache::CRPCJSONCache(size_t nMaxBytesIn) : nBytes(0), nMaxBytes(nMaxBytesIn)
+{
+}
+
+size_t CRPCJSONCache::EntryBytes(const Entry& entry)
+{
+    // Text, plus a rough allowance for the list and map nodes
+    return entry.members->size() + 160;
+}
+
+void CRPCJSONCache::EraseHash(Kind kind, const uint256& hash)
+{
+    std::map<Key, EntryList::iterator>::iterator it = mapEntries.lower_bound(Key(kind, hash, std::numeric_limits<int>::min()));
+    while (it != mapEntries.end() && std::get<0>(it->first) == kind && std::get<1>(it->first) == hash) {
+        nBytes -= EntryBytes(it->second->second);
+        entries.erase(it->second);
+        mapEntries.erase(it++);
+    }
+}
+
+void CRPCJSONCache::Trim()
+{
+    while (nBytes > nMaxBytes && !entries.empty()) {
+        nBytes -= EntryBytes(entries.back().second);
+        mapEntries.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+void CRPCJSONCache::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added)
+{
+    LOCK(cs);
+    if (entries.empty())
+        return;
+    // A transaction cached with the block it was in before a reorg may be
+    // mined again in the block being connected
+    if (!added)
+        EraseHash(BLOCK, pblock->GetHash());
+    for (const CTransaction& tx : pblock->vtx)
+        EraseHash(TRANSACTION, tx.GetHash());
+}
+
+void CRPCJSONCache::SetMaxBytes(size_t nMaxBytesIn)
+{
+    LOCK(cs);
+    nMaxBytes = nMaxBytesIn;
+    Trim();
+}
+
+bool CRPCJSONCache::Get(Kind kind, const uint256& hash, int verbosity, Entry& entry)
+{
+    LOCK(cs);
+    std::map<Key, EntryList::iterator>::iterator it = mapEntries.find(Key(kind, hash, verbosity));
+    if (it == mapEntries.end())
+        return false;
+    entries.splice(entries.begin(), entries, it->second);
+    entry = it->second->second;
+    return true;
+}
+
+void CRPCJSONCache::Put(Kind kind, const uint256& hash, int verbosity, const Entry& entry)
+{
+    LOCK(cs);
+    // Larger results would flush the whole cache
+    if (EntryBytes(entry) > nMaxBytes / 4)
+        return;
+    Key key(kind, hash, verbosity);
+    std::map<Key, EntryList::iterator>::iterator it = mapEntries.find(key);
+    if (it != mapEntries.end()) {
+        nBytes -= EntryBytes(it->second->second);
+        entries.erase(it->second);
+        mapEntries.erase(it);
+    }
+    entries.push_front(std::make_pair(key, entry));
+    mapEntries[key] = entries.begin();
+    nBytes += EntryBytes(entry);
+    Trim();
+}
+
+void CRPCJSONCache::Clear()
+{
+    LOCK(cs);
+    entries.clear();
+    mapEntries.clear();
+    nBytes = 0;
+}
+
+size_t CRPCJSONCache::Size() const
+{
+    LOCK(cs);
+    return entries.size();
+}
+
+size_t CRPCJSONCache::Bytes() const
+{
+    LOCK(cs);
+    return nBytes;
+}
+
+std::shared_ptr<const std::string> JSONMembers(const UniValue& obj)
+{
+    std::string str = obj.write();
+    str.erase(str.size() - 1);
+    str.erase(0, 1);
+    return std::make_shared<const std::string>(std::move(str));
+}
+
+void AppendJSONObject(JSONChunks& chunks, const UniValue& head, const std::shared_ptr<const std::string>& members, const UniValue& tail)
+{
+    std::string strHead = head.write();
+    strHead.erase(strHead.size() - 1);
+    if (head.size() > 0 && !members->empty())
+        strHead += ",";
+    chunks.push_back(std::make_shared<const std::string>(std::move(strHead)));
+    chunks.push_back(members);
+
+    std::string strTail = tail.write();
+    if (tail.size() == 0)
+        strTail = "}";
+    else if (head.size() > 0 || !members->empty())
+        strTail[0] = ',';
+    else
+        strTail.erase(0, 1);
+    chunks.push_back(std::make_shared<const std::string>(std::move(strTail)));
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPCJSONCACHE_H
+#define BITCOIN_RPCJSONCACHE_H
+
+#include "rpcserver.h"
+#include "sync.h"
+#include "uint256.h"
+#include "validationinterface.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+
+/** Default for -rpcjsoncache, in MiB */
+static const unsigned int DEFAULT_RPC_JSON_CACHE_SIZE = 32;
+
+/**
+ * Least recently used cache of the JSON text of verbose getblock and
+ * getrawtransaction results, keyed by hash and verbosity.
+ *
+ * Only the part of a result that does not depend on the active chain is
+ * kept; confirmations and the next block hash are added on every call. The
+ * entries of the blocks disconnected from the active chain are dropped, as
+ * are those of the transactions of every block connected or disconnected,
+ * since the block recorded for them may have changed.
+ */
+class CRPCJSONCache : public CValidationInterface
+{
+public:
+    enum Kind {
+        BLOCK,
+        TRANSACTION,
+    };
+
+    struct Entry {
+        //! Members of the result object, without the enclosing braces
+        std::shared_ptr<const std::string> members;
+        //! Block holding the transaction, for TRANSACTION entries
+        uint256 hashBlock;
+    };
+
+private:
+    typedef std::tuple<int, uint256, int> Key;
+    typedef std::list<std::pair<Key, Entry> > EntryList;
+
+    mutable CCriticalSection cs;
+    //! Most recently used first
+    EntryList entries;
+    std::map<Key, EntryList::iterator> mapEntries;
+    size_t nBytes;
+    size_t nMaxBytes;
+
+    static size_t EntryBytes(const Entry& entry);
+    void EraseHash(Kind kind, const uint256& hash);
+    void Trim();
+
+protected:
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added);
+
+public:
+    CRPCJSONCache(size_t nMaxBytesIn);
+
+    void SetMaxBytes(size_t nMaxBytesIn);
+    bool Get(Kind kind, const uint256& hash, int verbosity, Entry& entry);
+    void Put(Kind kind, const uint256& hash, int verbosity, const Entry& entry);
+    void Clear();
+
+    size_t Size() const;
+    size_t Bytes() const;
+};
+
+extern CRPCJSONCache rpcJSONCache;
+
+/** JSON text of the members of an object, without the enclosing braces */
+std::shared_ptr<const std::string> JSONMembers(const UniValue& obj);
+
+/**
+ * Append the JSON text of an object made of the members of head, the
+ * members text, and the members of tail, in this order.
+ */
+void AppendJSONObject(JSONChunks& chunks, const UniValue& head, const std::shared_ptr<const std::string>& members, const UniValue& tail);
+
+#endif // BITCOIN_RPCJSONCACHE_H
@@ -608,18 +608,19 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
 
     // Update block
     static CBlockIndex* pindexPrev;
-    static int64_t nStart;
     static CBlockTemplate* pblocktemplate;
+    // From now on the transactions of the next block are kept up to date
+    // as they enter the mempool, so that a template is cheap to get
+    StartBlockTemplateBuilder();
     if (pindexPrev != chainActive.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
+        mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast)
     {
         // Clear pindexPrev so future calls make a new block, despite any failures from here on
         pindexPrev = NULL;
 
-        // Store the pindexBest used before CreateNewBlockWithKey, to avoid races
+        // Store the pindexBest used before GetBlockTemplateWithKey, to avoid races
         nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
         CBlockIndex* pindexPrevNew = chainActive.Tip();
-        nStart = GetTime();
 
         // Create new block
         if(pblocktemplate)
@@ -629,14 +630,14 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
         }
 #ifdef ENABLE_WALLET
         CReserveKey reservekey(pwalletMain);
-        pblocktemplate = CreateNewBlockWithKey(reservekey);
+        pblocktemplate = GetBlockTemplateWithKey(reservekey);
 #else
-        pblocktemplate = CreateNewBlockWithKey();
+        pblocktemplate = GetBlockTemplateWithKey();
 #endif
         if (!pblocktemplate)
             throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
 
-        // Need to update only after we know CreateNewBlockWithKey succeeded
+        // Need to update only after we know GetBlockTemplateWithKey succeeded
         pindexPrev = pindexPrevNew;
     }
     CBlock* pblock = &pblocktemplate->block; // pointer for convenience
@@ -17,6 +17,8 @@
 #include "wallet/walletdb.h"
 #endif
 
+#include <algorithm>
+#include <set>
 #include <stdint.h>
 
 #include <boost/assign/list_of.hpp>
@@ -464,3 +466,219 @@ UniValue setmocktime(const UniValue& params, bool fHelp)
 
     return NullUniValue;
 }
+
+static bool getAddressFromIndex(unsigned int type, const uint160 &hash, std::string &address)
+{
+    if (type == ADDRESSINDEX_SCRIPTHASH) {
+        address = CBitcoinAddress(CScriptID(hash)).ToString();
+    } else if (type == ADDRESSINDEX_PUBKEYHASH) {
+        address = CBitcoinAddress(CKeyID(hash)).ToString();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void getAddressesFromParams(const UniValue& params, std::vector<std::pair<uint160, unsigned int> > &addresses)
+{
+    std::vector<UniValue> values;
+    if (params[0].isStr()) {
+        values.push_back(params[0]);
+    } else if (params[0].isObject()) {
+        UniValue addressValues = find_value(params[0].get_obj(), "addresses");
+        if (!addressValues.isArray())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Addresses is expected to be an array");
+        values = addressValues.getValues();
+    } else {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    for (std::vector<UniValue>::const_iterator it = values.begin(); it != values.end(); ++it) {
+        if (!it->isStr())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+        CBitcoinAddress address(it->get_str());
+        CTxDestination dest = address.Get();
+        if (const CKeyID* keyID = boost::get<CKeyID>(&dest))
+            addresses.push_back(std::make_pair(*keyID, (unsigned int)ADDRESSINDEX_PUBKEYHASH));
+        else if (const CScriptID* scriptID = boost::get<CScriptID>(&dest))
+            addresses.push_back(std::make_pair(*scriptID, (unsigned int)ADDRESSINDEX_SCRIPTHASH));
+        else
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+}
+
+static bool heightSort(const std::pair<CAddressUnspentKey, CAddressUnspentValue> &a,
+                       const std::pair<CAddressUnspentKey, CAddressUnspentValue> &b)
+{
+    return a.second.blockHeight < b.second.blockHeight;
+}
+
+UniValue getaddressutxos(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getaddressutxos {\"addresses\": [\"taddr\", ...]}\n"
+            "\nReturns all unspent outputs for transparent addresses (requires -addressindex).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "}\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\"  (string) The address base58check encoded\n"
+            "    \"txid\"  (string) The output txid\n"
+            "    \"outputIndex\"  (number) The output index\n"
+            "    \"script\"  (string) The script hex encoded\n"
+            "    \"satoshis\"  (number) The number of satoshis of the output\n"
+            "    \"height\"  (number) The block height\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\"]}'")
+            + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\"]}")
+        );
+
+    std::vector<std::pair<uint160, unsigned int> > addresses;
+    getAddressesFromParams(params, addresses);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    for (std::vector<std::pair<uint160, unsigned int> >::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!GetAddressUnspent(it->first, it->second, unspentOutputs))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+
+    UniValue result(UniValue::VARR);
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++) {
+        std::string address;
+        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+
+        UniValue output(UniValue::VOBJ);
+        output.push_back(Pair("address", address));
+        output.push_back(Pair("txid", it->first.txhash.GetHex()));
+        output.push_back(Pair("outputIndex", (int)it->first.index));
+        output.push_back(Pair("script", HexStr(it->second.script.begin(), it->second.script.end())));
+        output.push_back(Pair("satoshis", it->second.satoshis));
+        output.push_back(Pair("height", it->second.blockHeight));
+        result.push_back(output);
+    }
+
+    return result;
+}
+
+UniValue getaddressbalance(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getaddressbalance {\"addresses\": [\"taddr\", ...]}\n"
+            "\nReturns the balance for transparent addresses (requires -addressindex).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "}\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\"  (number) The current balance in satoshis\n"
+            "  \"received\"  (number) The total number of satoshis received (including change)\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\"]}'")
+            + HelpExampleRpc("getaddressbalance", "{\"addresses\": [\"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\"]}")
+        );
+
+    std::vector<std::pair<uint160, unsigned int> > addresses;
+    getAddressesFromParams(params, addresses);
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    for (std::vector<std::pair<uint160, unsigned int> >::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!GetAddressIndex(it->first, it->second, addressIndex))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    CAmount balance = 0;
+    CAmount received = 0;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++) {
+        if (it->second > 0)
+            received += it->second;
+        balance += it->second;
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("balance", balance));
+    result.push_back(Pair("received", received));
+
+    return result;
+}
+
+UniValue getaddresstxids(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getaddresstxids {\"addresses\": [\"taddr\", ...], (\"start\": n), (\"end\": n)}\n"
+            "\nReturns the txids for transparent addresses, in chain order (requires -addressindex).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "  \"start\" (number, optional) The start block height\n"
+            "  \"end\" (number, optional) The end block height\n"
+            "}\n"
+            "\nResult:\n"
+            "[\n"
+            "  \"transactionid\"  (string) The transaction id\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\"]}'")
+            + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\"]}")
+        );
+
+    std::vector<std::pair<uint160, unsigned int> > addresses;
+    getAddressesFromParams(params, addresses);
+
+    int start = 0;
+    int end = 0;
+    if (params[0].isObject()) {
+        UniValue startValue = find_value(params[0].get_obj(), "start");
+        UniValue endValue = find_value(params[0].get_obj(), "end");
+        if (startValue.isNum() && endValue.isNum()) {
+            start = startValue.get_int();
+            end = endValue.get_int();
+            if (start <= 0 || end < start)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Start and end are expected to be a valid height range");
+        }
+    }
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    for (std::vector<std::pair<uint160, unsigned int> >::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!GetAddressIndex(it->first, it->second, addressIndex, start, end))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    // Entries of one address are already in chain order; merge several
+    // addresses by height and position in the block
+    std::set<std::pair<std::pair<int, unsigned int>, uint256> > txids;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++)
+        txids.insert(std::make_pair(std::make_pair(it->first.blockHeight, it->first.txindex), it->first.txhash));
+
+    UniValue result(UniValue::VARR);
+    for (std::set<std::pair<std::pair<int, unsigned int>, uint256> >::const_iterator it = txids.begin(); it != txids.end(); it++)
+        result.push_back(it->second.GetHex());
+
+    return result;
+}
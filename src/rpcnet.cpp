@@ -382,6 +382,58 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
     return obj;
 }
 
+UniValue getmessagestats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 0)
+        throw runtime_error(
+            "getmessagestats\n"
+            "\nReturns the processing latency of the messages received from peers, per command.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"command\": {                (object) Statistics of the messages of this command\n"
+            "    \"count\": n,               (numeric) Number of messages processed\n"
+            "    \"totalmicros\": n,         (numeric) Total processing time in microseconds\n"
+            "    \"maxmicros\": n,           (numeric) Longest processing time in microseconds\n"
+            "    \"totalwaitmicros\": n,     (numeric) Total time between receipt and processing in microseconds\n"
+            "    \"maxwaitmicros\": n,       (numeric) Longest time between receipt and processing in microseconds\n"
+            "    \"histogram\": {            (object) Number of messages per processing time\n"
+            "      \"<10us\": n,\n"
+            "      ...\n"
+            "      \">=1s\": n\n"
+            "    }\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmessagestats", "")
+            + HelpExampleRpc("getmessagestats", "")
+       );
+
+    std::map<std::string, CMessageStats> mapStats;
+    GetMessageStats(mapStats);
+
+    UniValue obj(UniValue::VOBJ);
+    for (std::map<std::string, CMessageStats>::const_iterator it = mapStats.begin(); it != mapStats.end(); ++it) {
+        const CMessageStats& stats = it->second;
+        UniValue histogram(UniValue::VOBJ);
+        for (int i = 0; i < CMessageStats::NUM_BUCKETS; i++) {
+            int64_t nBound = CMessageStats::BUCKET_BOUNDS[std::min(i, CMessageStats::NUM_BUCKETS - 2)];
+            std::string strBound = nBound >= 1000000 ? strprintf("%ds", nBound / 1000000) :
+                                   nBound >= 1000 ? strprintf("%dms", nBound / 1000) : strprintf("%dus", nBound);
+            histogram.push_back(Pair((i < CMessageStats::NUM_BUCKETS - 1 ? "<" : ">=") + strBound, stats.vBuckets[i]));
+        }
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("count", stats.nCount));
+        entry.push_back(Pair("totalmicros", stats.nTotalMicros));
+        entry.push_back(Pair("maxmicros", stats.nMaxMicros));
+        entry.push_back(Pair("totalwaitmicros", stats.nTotalWaitMicros));
+        entry.push_back(Pair("maxwaitmicros", stats.nMaxWaitMicros));
+        entry.push_back(Pair("histogram", histogram));
+        obj.push_back(Pair(it->first, entry));
+    }
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -12,6 +12,7 @@
 #include "merkleblock.h"
 #include "net.h"
 #include "primitives/transaction.h"
+#include "rpcjsoncache.h"
 #include "rpcserver.h"
 #include "script/script.h"
 #include "script/script_error.h"
@@ -110,6 +111,25 @@ UniValue TxJoinSplitToJSON(const CTransaction& tx) {
     return vjoinsplit;
 }
 
+/** The fields of TxToJSON that depend on the active chain */
+static void TxBlockToJSON(const uint256& hashBlock, UniValue& entry)
+{
+    if (!hashBlock.IsNull()) {
+        entry.push_back(Pair("blockhash", hashBlock.GetHex()));
+        BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+        if (mi != mapBlockIndex.end() && (*mi).second) {
+            CBlockIndex* pindex = (*mi).second;
+            if (chainActive.Contains(pindex)) {
+                entry.push_back(Pair("confirmations", 1 + chainActive.Height() - pindex->nHeight));
+                entry.push_back(Pair("time", pindex->GetBlockTime()));
+                entry.push_back(Pair("blocktime", pindex->GetBlockTime()));
+            }
+            else
+                entry.push_back(Pair("confirmations", 0));
+        }
+    }
+}
+
 void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
 {
     entry.push_back(Pair("txid", tx.GetHash().GetHex()));
@@ -148,20 +168,7 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
     UniValue vjoinsplit = TxJoinSplitToJSON(tx);
     entry.push_back(Pair("vjoinsplit", vjoinsplit));
 
-    if (!hashBlock.IsNull()) {
-        entry.push_back(Pair("blockhash", hashBlock.GetHex()));
-        BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
-        if (mi != mapBlockIndex.end() && (*mi).second) {
-            CBlockIndex* pindex = (*mi).second;
-            if (chainActive.Contains(pindex)) {
-                entry.push_back(Pair("confirmations", 1 + chainActive.Height() - pindex->nHeight));
-                entry.push_back(Pair("time", pindex->GetBlockTime()));
-                entry.push_back(Pair("blocktime", pindex->GetBlockTime()));
-            }
-            else
-                entry.push_back(Pair("confirmations", 0));
-        }
-    }
+    TxBlockToJSON(hashBlock, entry);
 }
 
 UniValue getrawtransaction(const UniValue& params, bool fHelp)
@@ -281,6 +288,40 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
     return result;
 }
 
+/**
+ * Verbose getrawtransaction, written from the JSON cache. Only mined
+ * transactions are cached, along with their block, which is how the
+ * confirmations are computed on a cache hit.
+ */
+bool getrawtransactionjson(const UniValue& params, JSONChunks& chunks)
+{
+    if (params.size() != 2 || params[1].get_int() == 0)
+        return false;
+
+    LOCK(cs_main);
+
+    uint256 hash = ParseHashV(params[0], "parameter 1");
+
+    CRPCJSONCache::Entry entry;
+    if (!rpcJSONCache.Get(CRPCJSONCache::TRANSACTION, hash, 1, entry)) {
+        CTransaction tx;
+        if (!GetTransaction(hash, tx, entry.hashBlock, true))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available about transaction");
+
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("hex", EncodeHexTx(tx)));
+        TxToJSON(tx, uint256(), result);
+        entry.members = JSONMembers(result);
+        if (!entry.hashBlock.IsNull())
+            rpcJSONCache.Put(CRPCJSONCache::TRANSACTION, hash, 1, entry);
+    }
+
+    UniValue tail(UniValue::VOBJ);
+    TxBlockToJSON(entry.hashBlock, tail);
+    AppendJSONObject(chunks, UniValue(UniValue::VOBJ), entry.members, tail);
+    return true;
+}
+
 UniValue gettxoutproof(const UniValue& params, bool fHelp)
 {
     if (fHelp || (params.size() != 1 && params.size() != 2))
@@ -269,6 +269,7 @@ static const CRPCCommand vRPCCommands[] =
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true  },
     { "network",            "getconnectioncount",     &getconnectioncount,     true  },
     { "network",            "getnettotals",           &getnettotals,           true  },
+    { "network",            "getmessagestats",        &getmessagestats,        true  },
     { "network",            "getpeerinfo",            &getpeerinfo,            true  },
     { "network",            "ping",                   &ping,                   true  },
     { "network",            "setban",                 &setban,                 true  },
@@ -281,17 +282,26 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "getblockcount",          &getblockcount,          true  },
     { "blockchain",         "getblock",               &getblock,               true  },
     { "blockchain",         "getblockhash",           &getblockhash,           true  },
+    { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
     { "blockchain",         "getblockheader",         &getblockheader,         true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
+    { "blockchain",         "getdbstats",             &getdbstats,             true  },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
+    { "blockchain",         "getsigcacheinfo",        &getsigcacheinfo,        true  },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
     { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
 
+    /* Address index */
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        true  },
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      true  },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        true  },
+
     /* Mining */
 #ifdef ENABLE_WALLET
     { "mining",             "getblocktemplate",       &getblocktemplate,       true  },
@@ -402,6 +412,16 @@ static const CRPCCommand vRPCCommands[] =
 #endif // ENABLE_WALLET
 };
 
+/**
+ * Commands that can also write their result as JSON text
+ */
+static const CRPCJSONCommand vRPCJSONCommands[] =
+{ //  name                      actor
+  //  ------------------------  -----------------------
+    { "getblock",               &getblockjson            },
+    { "getrawtransaction",      &getrawtransactionjson   },
+};
+
 CRPCTable::CRPCTable()
 {
     unsigned int vcidx;
@@ -581,6 +601,50 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
     g_rpcSignals.PostCommand(*pcmd);
 }
 
+bool CRPCTable::executeJSON(const std::string &strMethod, const UniValue &params, JSONChunks& chunks, UniValue& result) const
+{
+    const CRPCJSONCommand *pjsoncmd = NULL;
+    for (unsigned int i = 0; i < (sizeof(vRPCJSONCommands) / sizeof(vRPCJSONCommands[0])); i++) {
+        if (vRPCJSONCommands[i].name == strMethod)
+            pjsoncmd = &vRPCJSONCommands[i];
+    }
+    if (!pjsoncmd) {
+        result = execute(strMethod, params);
+        return false;
+    }
+
+    // Return immediately if in warmup
+    {
+        LOCK(cs_rpcWarmup);
+        if (fRPCInWarmup)
+            throw JSONRPCError(RPC_IN_WARMUP, rpcWarmupStatus);
+    }
+
+    // Find method
+    const CRPCCommand *pcmd = tableRPC[strMethod];
+    if (!pcmd)
+        throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found");
+
+    g_rpcSignals.PreCommand(*pcmd);
+
+    bool fJSON;
+    try
+    {
+        // Execute, with the regular actor for the calls the JSON text
+        // actor leaves to it
+        fJSON = pjsoncmd->actor(params, chunks);
+        if (!fJSON)
+            result = pcmd->actor(params, false);
+    }
+    catch (const std::exception& e)
+    {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+
+    g_rpcSignals.PostCommand(*pcmd);
+    return fJSON;
+}
+
 std::string HelpExampleCli(const std::string& methodname, const std::string& args)
 {
     return "> zen-cli " + methodname + " " + args + "\n";
@@ -15,6 +15,7 @@
 #include <stdint.h>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include <boost/function.hpp>
 
@@ -119,6 +120,17 @@ void RPCRunLater(const std::string& name, boost::function<void(void)> func, int6
 
 typedef UniValue(*rpcfn_type)(const UniValue& params, bool fHelp);
 
+/** JSON text of a result, as pieces to be sent one after the other */
+typedef std::vector<std::shared_ptr<const std::string> > JSONChunks;
+
+/**
+ * Writes the result of a call as JSON text directly, for results large
+ * enough that building them as a UniValue costs more than the call itself.
+ * Returns false, and leaves the call to the regular actor, for the requests
+ * it does not handle, including help and parameter count errors.
+ */
+typedef bool(*rpcjsonfn_type)(const UniValue& params, JSONChunks& chunks);
+
 class CRPCCommand
 {
 public:
@@ -128,6 +140,13 @@ public:
     bool okSafeMode;
 };
 
+class CRPCJSONCommand
+{
+public:
+    std::string name;
+    rpcjsonfn_type actor;
+};
+
 /**
  * Bitcoin RPC command dispatcher.
  */
@@ -148,6 +167,18 @@ public:
      * @throws an exception (UniValue) when an error happens.
      */
     UniValue execute(const std::string &method, const UniValue &params) const;
+
+    /**
+     * Execute a method, with its JSON text actor if it has one that handles
+     * the call, with its regular actor otherwise.
+     * @param method   Method to execute
+     * @param params   UniValue Array of arguments (JSON objects)
+     * @param chunks   Filled with the JSON text of the result, if written by the JSON text actor
+     * @param result   Set to the result otherwise
+     * @returns true if the result was written into chunks.
+     * @throws an exception (UniValue) when an error happens.
+     */
+    bool executeJSON(const std::string &method, const UniValue &params, JSONChunks& chunks, UniValue& result) const;
 };
 
 extern const CRPCTable tableRPC;
@@ -179,6 +210,7 @@ extern UniValue addnode(const UniValue& params, bool fHelp);
 extern UniValue disconnectnode(const UniValue& params, bool fHelp);
 extern UniValue getaddednodeinfo(const UniValue& params, bool fHelp);
 extern UniValue getnettotals(const UniValue& params, bool fHelp);
+extern UniValue getmessagestats(const UniValue& params, bool fHelp);
 extern UniValue setban(const UniValue& params, bool fHelp);
 extern UniValue listbanned(const UniValue& params, bool fHelp);
 extern UniValue clearbanned(const UniValue& params, bool fHelp);
@@ -247,6 +279,7 @@ extern UniValue zc_raw_receive(const UniValue& params, bool fHelp);
 extern UniValue zc_sample_joinsplit(const UniValue& params, bool fHelp);
 
 extern UniValue getrawtransaction(const UniValue& params, bool fHelp); // in rcprawtransaction.cpp
+extern bool getrawtransactionjson(const UniValue& params, JSONChunks& chunks);
 extern UniValue listunspent(const UniValue& params, bool fHelp);
 extern UniValue lockunspent(const UniValue& params, bool fHelp);
 extern UniValue listlockunspent(const UniValue& params, bool fHelp);
@@ -264,16 +297,25 @@ extern UniValue getbestblockhash(const UniValue& params, bool fHelp);
 extern UniValue getdifficulty(const UniValue& params, bool fHelp);
 extern UniValue settxfee(const UniValue& params, bool fHelp);
 extern UniValue getmempoolinfo(const UniValue& params, bool fHelp);
+extern UniValue getsigcacheinfo(const UniValue& params, bool fHelp);
 extern UniValue getrawmempool(const UniValue& params, bool fHelp);
 extern UniValue getblockhash(const UniValue& params, bool fHelp);
 extern UniValue getblockheader(const UniValue& params, bool fHelp);
 extern UniValue getblock(const UniValue& params, bool fHelp);
+extern bool getblockjson(const UniValue& params, JSONChunks& chunks);
 extern UniValue gettxoutsetinfo(const UniValue& params, bool fHelp);
 extern UniValue gettxout(const UniValue& params, bool fHelp);
 extern UniValue verifychain(const UniValue& params, bool fHelp);
 extern UniValue getchaintips(const UniValue& params, bool fHelp);
 extern UniValue invalidateblock(const UniValue& params, bool fHelp);
 extern UniValue reconsiderblock(const UniValue& params, bool fHelp);
+extern UniValue getblockhashes(const UniValue& params, bool fHelp);
+extern UniValue getspentinfo(const UniValue& params, bool fHelp);
+extern UniValue getdbstats(const UniValue& params, bool fHelp);
+
+extern UniValue getaddresstxids(const UniValue& params, bool fHelp); // in rpcmisc.cpp
+extern UniValue getaddressbalance(const UniValue& params, bool fHelp);
+extern UniValue getaddressutxos(const UniValue& params, bool fHelp);
 
 extern UniValue getblocksubsidy(const UniValue& params, bool fHelp);
 
@@ -5,13 +5,14 @@
 
 #include "sigcache.h"
 
+#include "crypto/sha256.h"
+#include "cuckoocache.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
 #include "util.h"
 
-#include <boost/thread.hpp>
-#include <boost/tuple/tuple_comparison.hpp>
+#include <atomic>
 
 namespace {
 
@@ -19,72 +20,90 @@ namespace {
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * Entries are salted digests of (signature hash, signature, public key), so
+ * that their positions in the table cannot be predicted by peers.
  */
 class CSignatureCache
 {
 private:
-     //! sigdata_type is (signature hash, signature, public key):
-    typedef boost::tuple<uint256, std::vector<unsigned char>, CPubKey> sigdata_type;
-    std::set< sigdata_type> setValid;
-    boost::shared_mutex cs_sigcache;
+    //! Salt for the entry digests, random per process
+    uint256 nonce;
+    CCuckooCache setValid;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
 
 public:
-    bool
-    Get(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    CSignatureCache() : nHits(0), nMisses(0) {}
+
+    void Setup(size_t nBytes)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        GetRandBytes(nonce.begin(), 32);
+        setValid.Setup(nBytes);
+    }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        std::set<sigdata_type>::iterator mi = setValid.find(k);
-        if (mi != setValid.end())
-            return true;
-        return false;
+    uint256 ComputeEntry(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey) const
+    {
+        uint256 entry;
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(pubkey.begin(), pubkey.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+        return entry;
     }
 
-    void Set(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    bool Get(const uint256& entry)
     {
-        // DoS prevention: limit cache size to less than 10MB
-        // (~200 bytes per cache entry times 50,000 entries)
-        // Since there are a maximum of 20,000 signature operations per block
-        // 50,000 is a reasonable default.
-        int64_t nMaxCacheSize = GetArg("-maxsigcachesize", 50000);
-        if (nMaxCacheSize <= 0) return;
-
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-
-        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
-        {
-            // Evict a random entry. Random because that helps
-            // foil would-be DoS attackers who might try to pre-generate
-            // and re-use a set of valid signatures just-slightly-greater
-            // than our cache size.
-            uint256 randomHash = GetRandHash();
-            std::vector<unsigned char> unused;
-            std::set<sigdata_type>::iterator it =
-                setValid.lower_bound(sigdata_type(randomHash, unused, unused));
-            if (it == setValid.end())
-                it = setValid.begin();
-            setValid.erase(*it);
-        }
-
-        sigdata_type k(hash, vchSig, pubKey);
-        setValid.insert(k);
+        bool fHit = setValid.Contains(entry);
+        if (fHit)
+            nHits++;
+        else
+            nMisses++;
+        return fHit;
+    }
+
+    void Set(const uint256& entry)
+    {
+        setValid.Insert(entry);
+    }
+
+    void GetStats(CSignatureCacheStats& stats) const
+    {
+        stats.nEntries = setValid.Size();
+        stats.nCapacity = setValid.Capacity();
+        stats.nBytes = setValid.DynamicMemoryUsage();
+        stats.nHits = nHits;
+        stats.nMisses = nMisses;
     }
 };
 
+CSignatureCache signatureCache;
+
+}
+
+void InitSignatureCache()
+{
+    int64_t nMaxCacheSize = std::max((int64_t)0, std::min(GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE), MAX_MAX_SIG_CACHE_SIZE));
+    signatureCache.Setup((size_t)nMaxCacheSize << 20);
+    CSignatureCacheStats stats;
+    signatureCache.GetStats(stats);
+    LogPrintf("Using %zu MiB out of %d requested for signature cache, able to store %zu elements\n",
+              stats.nBytes >> 20, nMaxCacheSize, stats.nCapacity);
+}
+
+void GetSignatureCacheStats(CSignatureCacheStats& stats)
+{
+    signatureCache.GetStats(stats);
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
-    static CSignatureCache signatureCache;
+    uint256 entry = signatureCache.ComputeEntry(sighash, vchSig, pubkey);
 
-    if (signatureCache.Get(sighash, vchSig, pubkey))
+    if (signatureCache.Get(entry))
         return true;
 
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
         return false;
 
     if (store)
-        signatureCache.Set(sighash, vchSig, pubkey);
+        signatureCache.Set(entry);
     return true;
 }
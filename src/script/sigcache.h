@@ -8,10 +8,25 @@
 
 #include "script/interpreter.h"
 
+#include <stdint.h>
 #include <vector>
 
 class CPubKey;
 
+//! -maxsigcachesize default, in MiB
+static const int64_t DEFAULT_MAX_SIG_CACHE_SIZE = 32;
+//! Upper bound for -maxsigcachesize, in MiB
+static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+
+struct CSignatureCacheStats
+{
+    size_t nEntries;
+    size_t nCapacity;
+    size_t nBytes;
+    uint64_t nHits;
+    uint64_t nMisses;
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -23,4 +38,8 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+/** Size the signature cache according to -maxsigcachesize */
+void InitSignatureCache();
+void GetSignatureCacheStats(CSignatureCacheStats& stats);
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -0,0 +1,81 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SPENTINDEX_H
+#define BITCOIN_SPENTINDEX_H
+
+#include "amount.h"
+#include "serialize.h"
+#include "uint256.h"
+
+/** Spent index key: a transparent output that has been spent */
+struct CSpentIndexKey {
+    uint256 txid;
+    unsigned int outputIndex;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(txid);
+        READWRITE(outputIndex);
+    }
+
+    CSpentIndexKey(const uint256& t, unsigned int i) : txid(t), outputIndex(i) {}
+
+    CSpentIndexKey() { SetNull(); }
+
+    void SetNull()
+    {
+        txid.SetNull();
+        outputIndex = 0;
+    }
+};
+
+/**
+ * Spent index value: the input spending an output, and the amount and
+ * address (if any) of the spent output. A null value erases the entry.
+ */
+struct CSpentIndexValue {
+    uint256 txid;
+    unsigned int inputIndex;
+    int blockHeight;
+    CAmount satoshis;
+    unsigned int addressType;
+    uint160 addressHash;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(txid);
+        READWRITE(inputIndex);
+        READWRITE(blockHeight);
+        READWRITE(satoshis);
+        READWRITE(addressType);
+        READWRITE(addressHash);
+    }
+
+    CSpentIndexValue(const uint256& t, unsigned int i, int h, CAmount s, unsigned int type, const uint160& a) :
+        txid(t), inputIndex(i), blockHeight(h), satoshis(s), addressType(type), addressHash(a) {}
+
+    CSpentIndexValue() { SetNull(); }
+
+    void SetNull()
+    {
+        txid.SetNull();
+        inputIndex = 0;
+        blockHeight = 0;
+        satoshis = 0;
+        addressType = 0;
+        addressHash.SetNull();
+    }
+
+    bool IsNull() const
+    {
+        return txid.IsNull();
+    }
+};
+
+#endif // BITCOIN_SPENTINDEX_H
@@ -334,6 +334,56 @@ public:
 
 
 
+/**
+ * Stream reading from bytes owned elsewhere, such as a memory mapped file,
+ * so that they can be deserialized without first being copied into a
+ * CDataStream. The bytes must outlive the reader.
+ */
+class CByteReader
+{
+private:
+    const char* pbegin;
+    const char* pend;
+    int nType;
+    int nVersion;
+
+public:
+    CByteReader(const char* pbeginIn, const char* pendIn, int nTypeIn, int nVersionIn) :
+        pbegin(pbeginIn), pend(pendIn), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    size_t size() const          { return pend - pbegin; }
+    bool empty() const           { return pbegin == pend; }
+    bool eof() const             { return pbegin == pend; }
+
+    int GetType() const          { return nType; }
+    int GetVersion() const       { return nVersion; }
+
+    CByteReader& read(char* pch, size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CByteReader::read(): end of data");
+        memcpy(pch, pbegin, nSize);
+        pbegin += nSize;
+        return (*this);
+    }
+
+    CByteReader& ignore(size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CByteReader::ignore(): end of data");
+        pbegin += nSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CByteReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
 /** Non-refcounted RAII wrapper for FILE*
  *
  * Will automatically close the file when it goes out of scope if not null.
@@ -0,0 +1,182 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+#define BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <stddef.h>
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Memory resource carving small blocks out of large chunks.
+ *
+ * Freed blocks are kept in a free list per size and reused; the chunks are
+ * only returned when the resource is destroyed. This removes the per-node
+ * malloc overhead of node-based containers, and keeps nodes allocated
+ * together close in memory. Chunks grow geometrically, so that short-lived
+ * containers holding a few entries stay cheap. Not thread safe.
+ */
+class CPoolResource
+{
+public:
+    //! Alignment, and granularity of the block sizes
+    static const size_t ALIGNMENT = sizeof(void*);
+    //! Larger blocks are served by operator new
+    static const size_t MAX_BLOCK_SIZE = 256;
+    static const size_t MIN_CHUNK_SIZE = 4096;
+    static const size_t MAX_CHUNK_SIZE = 256 * 1024;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    FreeBlock* freeLists[MAX_BLOCK_SIZE / ALIGNMENT + 1];
+    std::vector<void*> vChunks;
+    char* pos;
+    char* end;
+    size_t nNextChunkSize;
+    size_t nChunkBytes;
+
+    static size_t SizeClass(size_t bytes) { return (bytes + ALIGNMENT - 1) / ALIGNMENT; }
+
+    void AllocateChunk()
+    {
+        // Leftovers of the current chunk go to the free list of their size
+        if (end - pos >= (ptrdiff_t)ALIGNMENT)
+            Deallocate(pos, end - pos);
+        void* chunk = ::operator new(nNextChunkSize);
+        vChunks.push_back(chunk);
+        pos = static_cast<char*>(chunk);
+        end = pos + nNextChunkSize;
+        nChunkBytes += nNextChunkSize;
+        if (nNextChunkSize < MAX_CHUNK_SIZE)
+            nNextChunkSize *= 2;
+    }
+
+    CPoolResource(const CPoolResource&);
+    CPoolResource& operator=(const CPoolResource&);
+
+public:
+    CPoolResource() : pos(NULL), end(NULL), nNextChunkSize(MIN_CHUNK_SIZE), nChunkBytes(0)
+    {
+        for (size_t i = 0; i <= MAX_BLOCK_SIZE / ALIGNMENT; i++)
+            freeLists[i] = NULL;
+    }
+
+    ~CPoolResource()
+    {
+        for (void* chunk : vChunks)
+            ::operator delete(chunk);
+    }
+
+    static bool IsPooled(size_t bytes, size_t alignment)
+    {
+        return bytes <= MAX_BLOCK_SIZE && alignment <= ALIGNMENT;
+    }
+
+    void* Allocate(size_t bytes)
+    {
+        size_t nClass = SizeClass(bytes);
+        if (freeLists[nClass] != NULL) {
+            FreeBlock* block = freeLists[nClass];
+            freeLists[nClass] = block->next;
+            return block;
+        }
+        if ((size_t)(end - pos) < nClass * ALIGNMENT)
+            AllocateChunk();
+        void* ret = pos;
+        pos += nClass * ALIGNMENT;
+        return ret;
+    }
+
+    void Deallocate(void* p, size_t bytes)
+    {
+        size_t nClass = SizeClass(bytes);
+        if (nClass > MAX_BLOCK_SIZE / ALIGNMENT) {
+            // A chunk leftover larger than any block; split it
+            while (bytes >= MAX_BLOCK_SIZE) {
+                Deallocate(p, MAX_BLOCK_SIZE);
+                p = static_cast<char*>(p) + MAX_BLOCK_SIZE;
+                bytes -= MAX_BLOCK_SIZE;
+            }
+            if (bytes >= ALIGNMENT)
+                Deallocate(p, bytes / ALIGNMENT * ALIGNMENT);
+            return;
+        }
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        block->next = freeLists[nClass];
+        freeLists[nClass] = block;
+    }
+
+    //! Memory held in chunks, whether handed out or free
+    size_t ChunkBytes() const { return nChunkBytes; }
+    size_t ChunkCount() const { return vChunks.size(); }
+};
+
+/**
+ * Allocator drawing single objects from a CPoolResource; arrays (such as the
+ * bucket array of a hash table) come from operator new.
+ *
+ * A default-constructed allocator creates a resource of its own, which is
+ * shared by its rebound copies. The resource moves along with the contents
+ * when a container is swapped or move-assigned, and a copied container gets
+ * a new one, so each resource only ever serves one container at a time.
+ */
+template <typename T>
+class CPoolAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    typedef std::true_type propagate_on_container_swap;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::false_type propagate_on_container_copy_assignment;
+
+    template <typename U>
+    struct rebind {
+        typedef CPoolAllocator<U> other;
+    };
+
+    std::shared_ptr<CPoolResource> resource;
+
+    CPoolAllocator() : resource(std::make_shared<CPoolResource>()) {}
+    CPoolAllocator(const CPoolAllocator& other) : resource(other.resource) {}
+    template <typename U>
+    CPoolAllocator(const CPoolAllocator<U>& other) : resource(other.resource) {}
+
+    CPoolAllocator select_on_container_copy_construction() const { return CPoolAllocator(); }
+
+    T* allocate(size_t n)
+    {
+        if (n == 1 && CPoolResource::IsPooled(sizeof(T), alignof(T)))
+            return static_cast<T*>(resource->Allocate(sizeof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        if (n == 1 && CPoolResource::IsPooled(sizeof(T), alignof(T)))
+            resource->Deallocate(p, sizeof(T));
+        else
+            ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const CPoolAllocator<U>& other) const { return resource == other.resource; }
+    template <typename U>
+    bool operator!=(const CPoolAllocator<U>& other) const { return resource != other.resource; }
+};
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_POOL_H
@@ -0,0 +1,116 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindex.h"
+#include "spentindex.h"
+#include "timestampindex.h"
+#include "txdb.h"
+#include "utilstrencodings.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(addressindex_read_write)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 hashA = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    uint160 hashB = uint160(ParseHex("1102030405060708090a0b0c0d0e0f1011121314"));
+    uint256 txid1 = uint256S("01");
+    uint256 txid2 = uint256S("02");
+
+    // Heights above 255 check that entries are ordered by height rather than
+    // by the little-endian bytes of the height
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vWrite;
+    vWrite.push_back(std::make_pair(CAddressIndexKey(ADDRESSINDEX_PUBKEYHASH, hashA, 256, 1, txid2, 0, true), -50));
+    vWrite.push_back(std::make_pair(CAddressIndexKey(ADDRESSINDEX_PUBKEYHASH, hashA, 1, 0, txid1, 0, false), 50));
+    vWrite.push_back(std::make_pair(CAddressIndexKey(ADDRESSINDEX_PUBKEYHASH, hashB, 2, 0, txid1, 1, false), 7));
+    vWrite.push_back(std::make_pair(CAddressIndexKey(ADDRESSINDEX_SCRIPTHASH, hashA, 3, 0, txid1, 2, false), 9));
+    BOOST_CHECK(db.WriteAddressIndex(vWrite));
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vRead;
+    BOOST_CHECK(db.ReadAddressIndex(hashA, ADDRESSINDEX_PUBKEYHASH, vRead));
+    BOOST_CHECK_EQUAL(vRead.size(), 2U);
+    BOOST_CHECK_EQUAL(vRead[0].first.blockHeight, 1);
+    BOOST_CHECK_EQUAL(vRead[0].second, 50);
+    BOOST_CHECK_EQUAL(vRead[1].first.blockHeight, 256);
+    BOOST_CHECK(vRead[1].first.spending);
+    BOOST_CHECK(vRead[1].first.txhash == txid2);
+
+    // Height range
+    vRead.clear();
+    BOOST_CHECK(db.ReadAddressIndex(hashA, ADDRESSINDEX_PUBKEYHASH, vRead, 2, 1000));
+    BOOST_CHECK_EQUAL(vRead.size(), 1U);
+    BOOST_CHECK_EQUAL(vRead[0].first.blockHeight, 256);
+
+    // Disconnecting erases the entries again
+    BOOST_CHECK(db.EraseAddressIndex(vWrite));
+    vRead.clear();
+    BOOST_CHECK(db.ReadAddressIndex(hashA, ADDRESSINDEX_PUBKEYHASH, vRead));
+    BOOST_CHECK(vRead.empty());
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_unspent_and_spent)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 hash = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    uint256 txid1 = uint256S("01");
+    uint256 txid2 = uint256S("02");
+    CScript script = CScript() << OP_TRUE;
+
+    // An output created and spent within the same block ends up erased
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vUnspent;
+    vUnspent.push_back(std::make_pair(CAddressUnspentKey(ADDRESSINDEX_PUBKEYHASH, hash, txid1, 0), CAddressUnspentValue(10, script, 5)));
+    vUnspent.push_back(std::make_pair(CAddressUnspentKey(ADDRESSINDEX_PUBKEYHASH, hash, txid1, 1), CAddressUnspentValue(20, script, 5)));
+    vUnspent.push_back(std::make_pair(CAddressUnspentKey(ADDRESSINDEX_PUBKEYHASH, hash, txid1, 0), CAddressUnspentValue()));
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(vUnspent));
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vRead;
+    BOOST_CHECK(db.ReadAddressUnspentIndex(hash, ADDRESSINDEX_PUBKEYHASH, vRead));
+    BOOST_CHECK_EQUAL(vRead.size(), 1U);
+    BOOST_CHECK_EQUAL(vRead[0].first.index, 1U);
+    BOOST_CHECK_EQUAL(vRead[0].second.satoshis, 20);
+    BOOST_CHECK(vRead[0].second.script == script);
+
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > vSpent;
+    vSpent.push_back(std::make_pair(CSpentIndexKey(txid1, 0), CSpentIndexValue(txid2, 3, 6, 10, ADDRESSINDEX_PUBKEYHASH, hash)));
+    BOOST_CHECK(db.UpdateSpentIndex(vSpent));
+    CSpentIndexValue value;
+    BOOST_CHECK(db.ReadSpentIndex(CSpentIndexKey(txid1, 0), value));
+    BOOST_CHECK(value.txid == txid2);
+    BOOST_CHECK_EQUAL(value.inputIndex, 3U);
+    BOOST_CHECK_EQUAL(value.blockHeight, 6);
+    BOOST_CHECK(!db.ReadSpentIndex(CSpentIndexKey(txid1, 1), value));
+
+    vSpent[0].second.SetNull();
+    BOOST_CHECK(db.UpdateSpentIndex(vSpent));
+    BOOST_CHECK(!db.ReadSpentIndex(CSpentIndexKey(txid1, 0), value));
+}
+
+BOOST_AUTO_TEST_CASE(timestampindex_range)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint256 hash1 = uint256S("01");
+    uint256 hash2 = uint256S("02");
+    uint256 hash3 = uint256S("03");
+    BOOST_CHECK(db.WriteTimestampIndex(CTimestampIndexKey(0x100, hash2)));
+    BOOST_CHECK(db.WriteTimestampIndex(CTimestampIndexKey(0x1ff, hash3)));
+    BOOST_CHECK(db.WriteTimestampIndex(CTimestampIndexKey(0x0ff, hash1)));
+
+    std::vector<uint256> hashes;
+    BOOST_CHECK(db.ReadTimestampIndex(0x1ff, 0x0ff, hashes));
+    BOOST_CHECK_EQUAL(hashes.size(), 2U);
+    BOOST_CHECK(hashes[0] == hash1);
+    BOOST_CHECK(hashes[1] == hash2);
+
+    BOOST_CHECK(db.EraseTimestampIndex(CTimestampIndexKey(0x0ff, hash1)));
+    hashes.clear();
+    BOOST_CHECK(db.ReadTimestampIndex(0x200, 0, hashes));
+    BOOST_CHECK_EQUAL(hashes.size(), 2U);
+    BOOST_CHECK(hashes[0] == hash2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
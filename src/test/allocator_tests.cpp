@@ -4,9 +4,12 @@
 
 #include "util.h"
 
+#include "support/allocators/pool.h"
 #include "support/allocators/secure.h"
 #include "test/test_bitcoin.h"
 
+#include <map>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(allocator_tests, BasicTestingSetup)
@@ -117,4 +120,55 @@ BOOST_AUTO_TEST_CASE(test_LockedPageManagerBase)
     BOOST_CHECK((last_unlock_len & (test_page_size-1)) == 0); // always unlock entire pages
 }
 
+BOOST_AUTO_TEST_CASE(pool_resource_reuse)
+{
+    CPoolResource resource;
+    BOOST_CHECK_EQUAL(resource.ChunkBytes(), 0U);
+
+    // Blocks of a size are reused once freed
+    void* a = resource.Allocate(40);
+    void* b = resource.Allocate(40);
+    BOOST_CHECK(a != b);
+    BOOST_CHECK_EQUAL(resource.ChunkCount(), 1U);
+    resource.Deallocate(a, 40);
+    BOOST_CHECK(resource.Allocate(40) == a);
+    // Sizes round up to the alignment
+    resource.Deallocate(b, 40);
+    BOOST_CHECK(resource.Allocate(33) == b);
+
+    // Chunks grow geometrically
+    for (int i = 0; i < 1000; i++)
+        resource.Allocate(CPoolResource::MAX_BLOCK_SIZE);
+    BOOST_CHECK(resource.ChunkCount() > 1);
+    BOOST_CHECK(resource.ChunkBytes() >= 1000 * CPoolResource::MAX_BLOCK_SIZE);
+    BOOST_CHECK(resource.ChunkBytes() < 2 * 1000 * CPoolResource::MAX_BLOCK_SIZE + 2 * CPoolResource::MIN_CHUNK_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(pool_allocator_containers)
+{
+    typedef std::map<int, int, std::less<int>, CPoolAllocator<std::pair<const int, int> > > PoolMap;
+    PoolMap m;
+    for (int i = 0; i < 10000; i++)
+        m[i] = i;
+    size_t nBytes = m.get_allocator().resource->ChunkBytes();
+    BOOST_CHECK(nBytes > 0);
+
+    // Freed nodes are reused rather than growing the pool
+    for (int i = 0; i < 10000; i += 2)
+        m.erase(i);
+    for (int i = 0; i < 10000; i += 2)
+        m[-i - 1] = i;
+    BOOST_CHECK_EQUAL(m.get_allocator().resource->ChunkBytes(), nBytes);
+
+    // The pool moves along with the contents on swap, a copy gets its own
+    PoolMap other;
+    other.swap(m);
+    BOOST_CHECK_EQUAL(other.size(), 10000U);
+    BOOST_CHECK_EQUAL(other.get_allocator().resource->ChunkBytes(), nBytes);
+    BOOST_CHECK_EQUAL(m.get_allocator().resource->ChunkBytes(), 0U);
+    PoolMap copy(other);
+    BOOST_CHECK(copy == other);
+    BOOST_CHECK(copy.get_allocator() != other.get_allocator());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
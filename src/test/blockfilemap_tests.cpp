@@ -0,0 +1,76 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+#include "clientversion.h"
+#include "main.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilemap_tests, TestingSetup)
+
+static CBlock MakeBlock(int nTxs)
+{
+    CBlock block;
+    block.nTime = nTxs;
+    for (int i = 0; i < nTxs; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout.n = i;
+        mtx.vout.resize(1);
+        mtx.vout[0].nValue = i;
+        block.vtx.push_back(mtx);
+    }
+    return block;
+}
+
+static std::string Serialized(const CBlock& block)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    return ss.str();
+}
+
+BOOST_AUTO_TEST_CASE(blockfilemap_read)
+{
+    CBlock block1 = MakeBlock(10);
+    CBlock block2 = MakeBlock(1000);
+    CDiskBlockPos pos1(99, 0);
+    BOOST_CHECK(WriteBlockToDisk(block1, pos1, Params().MessageStart()));
+
+    CBlockFileMap map;
+    CRawBlock raw1;
+    BOOST_CHECK(map.GetBlock(pos1, raw1));
+    BOOST_CHECK_EQUAL(std::string(raw1.begin(), raw1.end()), Serialized(block1));
+
+    CBlock read1;
+    CByteReader reader = raw1.GetReader(SER_DISK, CLIENT_VERSION);
+    reader >> read1;
+    BOOST_CHECK(reader.empty());
+    BOOST_CHECK(read1.GetHash() == block1.GetHash());
+    BOOST_CHECK(read1.vtx.back().GetHash() == block1.vtx.back().GetHash());
+    BOOST_CHECK_THROW(reader >> read1, std::ios_base::failure);
+
+    // Appended past the end of the mapping; the earlier view stays valid
+    CDiskBlockPos pos2(99, pos1.nPos + raw1.size());
+    BOOST_CHECK(WriteBlockToDisk(block2, pos2, Params().MessageStart()));
+    CRawBlock raw2;
+    BOOST_CHECK(map.GetBlock(pos2, raw2));
+    BOOST_CHECK_EQUAL(std::string(raw2.begin(), raw2.end()), Serialized(block2));
+    map.Release(99);
+    BOOST_CHECK_EQUAL(std::string(raw1.begin(), raw1.end()), Serialized(block1));
+
+    // Past the end of the file
+    CRawBlock raw3;
+    BOOST_CHECK(!map.GetBlock(CDiskBlockPos(99, pos2.nPos + raw2.size() + 8), raw3));
+    BOOST_CHECK(!map.GetBlock(CDiskBlockPos(98, 8), raw3));
+
+    // Through main, whether or not the file can be mapped here
+    CRawBlock raw4;
+    BOOST_CHECK(ReadRawBlockFromDisk(raw4, pos2));
+    BOOST_CHECK_EQUAL(std::string(raw4.begin(), raw4.end()), Serialized(block2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -64,4 +64,69 @@ BOOST_AUTO_TEST_CASE(May15)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(read_resets_checked)
+{
+    CBlock block;
+    block.nBits = 1;
+    block.vtx.resize(1);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+
+    // A block read over one that passed CheckBlock must be checked again
+    CBlock reused;
+    reused.vtx.resize(2);
+    reused.BuildMerkleTree();
+    reused.fChecked = true;
+    ss >> reused;
+    BOOST_CHECK(!reused.fChecked);
+    BOOST_CHECK(reused.vMerkleTree.empty());
+    BOOST_CHECK_EQUAL(reused.vtx.size(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(large_block_hashes)
+{
+    // Big enough for the lower merkle levels to be split over the merkle
+    // hashing queue
+    CBlock block;
+    for (int i = 0; i < 5000; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout.n = i;
+        mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(i % 200, 0x01);
+        mtx.vout.resize(1);
+        mtx.nLockTime = i;
+        block.vtx.push_back(mtx);
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+    CBlock parsed;
+    ss >> parsed;
+
+    BOOST_CHECK_EQUAL(parsed.vtx.size(), block.vtx.size());
+    std::vector<uint256> vLevel;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        BOOST_CHECK(parsed.vtx[i].GetHash() == CTransaction(CMutableTransaction(block.vtx[i])).GetHash());
+        vLevel.push_back(block.vtx[i].GetHash());
+    }
+
+    // Merkle root computed one pair at a time
+    while (vLevel.size() > 1) {
+        std::vector<uint256> vNext;
+        for (size_t i = 0; i < vLevel.size(); i += 2) {
+            const uint256& right = vLevel[std::min(i + 1, vLevel.size() - 1)];
+            vNext.push_back(Hash(BEGIN(vLevel[i]), END(vLevel[i]), BEGIN(right), END(right)));
+        }
+        vLevel.swap(vNext);
+    }
+    BOOST_CHECK(parsed.BuildMerkleTree() == vLevel[0]);
+
+    // The queue is used only with -par above 1; without threads of its own,
+    // the calling thread does all the checks
+    int nScriptCheckThreadsSaved = nScriptCheckThreads;
+    nScriptCheckThreads = 2;
+    BOOST_CHECK(parsed.BuildMerkleTree(NULL, HashMerkleLevel) == vLevel[0]);
+    nScriptCheckThreads = nScriptCheckThreadsSaved;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
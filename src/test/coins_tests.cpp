@@ -10,6 +10,7 @@
 #include "test/test_bitcoin.h"
 #include "consensus/validation.h"
 #include "main.h"
+#include "txdb.h"
 #include "undo.h"
 #include "pubkey.h"
 
@@ -839,4 +840,98 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     }
 }
 
+BOOST_AUTO_TEST_CASE(coins_cache_add_fetched)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+
+    uint256 txidCached = GetRandHash();
+    uint256 txidFetched = GetRandHash();
+    uint256 nf = GetRandHash();
+    cache.ModifyCoins(txidCached)->vout.resize(1, CTxOut(1, CScript()));
+
+    std::vector<uint256> txids, nullifiers, anchors;
+    txids.push_back(txidCached);
+    txids.push_back(txidFetched);
+    nullifiers.push_back(nf);
+    anchors.push_back(ZCIncrementalMerkleTree::empty_root());
+    cache.FilterCached(txids, nullifiers, anchors);
+    BOOST_CHECK_EQUAL(txids.size(), 1U);
+    BOOST_CHECK(txids[0] == txidFetched);
+    BOOST_CHECK_EQUAL(nullifiers.size(), 1U);
+    BOOST_CHECK_EQUAL(anchors.size(), 1U);
+
+    // Fetched entries are used as if the cache had read them itself, and
+    // never replace what it has
+    CCoins coins;
+    coins.vout.resize(2, CTxOut(2, CScript()));
+    cache.AddFetchedCoins(txidFetched, coins);
+    coins.vout.resize(3, CTxOut(3, CScript()));
+    cache.AddFetchedCoins(txidCached, coins);
+    cache.AddFetchedNullifier(nf, true);
+    ZCIncrementalMerkleTree tree;
+    appendRandomCommitment(tree);
+    cache.AddFetchedAnchor(tree.root(), tree);
+    cache.SelfTest();
+
+    BOOST_CHECK_EQUAL(cache.AccessCoins(txidFetched)->vout.size(), 2U);
+    BOOST_CHECK_EQUAL(cache.AccessCoins(txidCached)->vout.size(), 1U);
+    BOOST_CHECK(cache.GetNullifier(nf));
+    ZCIncrementalMerkleTree fetched;
+    BOOST_CHECK(cache.GetAnchorAt(tree.root(), fetched));
+    BOOST_CHECK(fetched.root() == tree.root());
+
+    // Unmodified, so a flush does not write them to the base
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!base.HaveCoins(txidFetched));
+    BOOST_CHECK(!base.GetNullifier(nf));
+}
+
+BOOST_FIXTURE_TEST_CASE(coins_db_background_flush, TestingSetup)
+{
+    CCoinsViewDB db(1 << 20, true);
+    db.StartBackgroundFlush();
+
+    uint256 txid = GetRandHash();
+    uint256 nf = GetRandHash();
+    uint256 hashBlock = GetRandHash();
+    {
+        CCoinsViewCache cache(&db);
+        {
+            CCoinsModifier coins = cache.ModifyCoins(txid);
+            coins->vout.resize(1);
+            coins->vout[0].nValue = 42;
+        }
+        cache.SetNullifier(nf, true);
+        cache.SetBestBlock(hashBlock);
+        BOOST_CHECK(cache.Flush());
+    }
+
+    // Whether or not the write has been committed yet, the flushed state is visible
+    CCoins coins;
+    BOOST_CHECK(db.GetCoins(txid, coins));
+    BOOST_CHECK_EQUAL(coins.vout[0].nValue, 42);
+    BOOST_CHECK(db.GetNullifier(nf));
+    BOOST_CHECK(db.GetBestBlock() == hashBlock);
+
+    // Spending the coins queues their erasure behind the first write
+    {
+        CCoinsViewCache cache(&db);
+        cache.ModifyCoins(txid)->Spend(0);
+        cache.SetBestBlock(GetRandHash());
+        BOOST_CHECK(cache.Flush());
+    }
+    BOOST_CHECK(!db.HaveCoins(txid));
+
+    BOOST_CHECK(db.WaitForFlush());
+    BOOST_CHECK(!db.HaveCoins(txid));
+    BOOST_CHECK(db.GetNullifier(nf));
+
+    CCoinsFlushStats stats;
+    db.GetFlushStats(stats);
+    BOOST_CHECK(!stats.fPending);
+    BOOST_CHECK_EQUAL(stats.nFlushes, 2U);
+    BOOST_CHECK_EQUAL(stats.nBackgroundFlushes, 2U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -15,6 +15,7 @@
 #include <vector>
 
 #include <boost/assign/list_of.hpp>
+#include <boost/foreach.hpp>
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(crypto_tests, BasicTestingSetup)
@@ -109,7 +110,14 @@ BOOST_AUTO_TEST_CASE(sha1_testvectors) {
     TestSHA1(test1, "b7755760681cbfd971451668f32af5774f4656b5");
 }
 
-BOOST_AUTO_TEST_CASE(sha256_testvectors) {
+static const sha256_implementation::UseImplementation SHA256_IMPLEMENTATIONS[] = {
+    sha256_implementation::STANDARD,
+    sha256_implementation::USE_AVX2,
+    sha256_implementation::USE_SHANI,
+    sha256_implementation::USE_ALL,
+};
+
+void TestSHA256Vectors() {
     TestSHA256("", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
     TestSHA256("abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
     TestSHA256("message digest",
@@ -131,6 +139,44 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+BOOST_AUTO_TEST_CASE(sha256_testvectors) {
+    // Implementations the CPU lacks fall back to the portable one
+    BOOST_FOREACH(sha256_implementation::UseImplementation use, SHA256_IMPLEMENTATIONS) {
+        BOOST_TEST_MESSAGE("Using SHA256 implementation " << SHA256AutoDetect(use));
+        TestSHA256Vectors();
+    }
+    SHA256AutoDetect();
+}
+
+BOOST_AUTO_TEST_CASE(sha256_batch) {
+    BOOST_FOREACH(sha256_implementation::UseImplementation use, SHA256_IMPLEMENTATIONS) {
+        BOOST_TEST_MESSAGE("Using SHA256 implementation " << SHA256AutoDetect(use));
+        // Cover whole 8-way batches as well as the remainders
+        for (size_t blocks = 0; blocks <= 34; blocks++) {
+            std::vector<unsigned char> in(64 * blocks), out(32 * blocks), expected(32 * blocks);
+            for (size_t i = 0; i < in.size(); i++)
+                in[i] = insecure_rand();
+
+            for (size_t i = 0; i < blocks; i++) {
+                unsigned char single[CSHA256::OUTPUT_SIZE];
+                CSHA256().Write(&in[64 * i], 64).Finalize(single);
+                CSHA256().Write(single, sizeof(single)).Finalize(&expected[32 * i]);
+            }
+            SHA256D64(out.data(), in.data(), blocks);
+            BOOST_CHECK(out == expected);
+
+            for (size_t i = 0; i < blocks; i++) {
+                CSHA256 hasher;
+                hasher.Write(&in[64 * i], 64);
+                hasher.FinalizeNoPadding(&expected[32 * i]);
+            }
+            SHA256Compress64(out.data(), in.data(), blocks);
+            BOOST_CHECK(out == expected);
+        }
+    }
+    SHA256AutoDetect();
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
@@ -0,0 +1,111 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cuckoocache.h"
+
+#include "random.h"
+#include "test/test_bitcoin.h"
+
+#include <atomic>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(cuckoocache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(cuckoocache_disabled)
+{
+    CCuckooCache cache;
+    uint256 entry = GetRandHash();
+    cache.Insert(entry);
+    BOOST_CHECK(!cache.Contains(entry));
+
+    cache.Setup(0);
+    cache.Insert(entry);
+    BOOST_CHECK(!cache.Contains(entry));
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_insert_contains)
+{
+    CCuckooCache cache;
+    cache.Setup(1 << 20);
+    BOOST_CHECK_EQUAL(cache.Capacity(), (1U << 20) / 32);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), 1U << 20);
+
+    // At half load nearly everything fits
+    std::vector<uint256> entries;
+    for (size_t i = 0; i < cache.Capacity() / 2; i++) {
+        entries.push_back(GetRandHash());
+        cache.Insert(entries.back());
+    }
+    size_t nFound = 0;
+    for (const uint256& entry : entries)
+        nFound += cache.Contains(entry);
+    BOOST_CHECK(nFound > entries.size() * 95 / 100);
+    BOOST_CHECK_EQUAL(cache.Size(), nFound);
+
+    // Inserting twice does not take another slot
+    cache.Insert(entries.front());
+    BOOST_CHECK_EQUAL(cache.Size(), nFound);
+
+    BOOST_CHECK(!cache.Contains(GetRandHash()));
+    // The null digest marks empty slots and is never cached
+    cache.Insert(uint256());
+    BOOST_CHECK(!cache.Contains(uint256()));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_bounded)
+{
+    CCuckooCache cache;
+    cache.Setup(1 << 12);
+
+    // Overfilling evicts entries but never grows the table
+    std::vector<uint256> entries;
+    for (size_t i = 0; i < cache.Capacity() * 4; i++) {
+        entries.push_back(GetRandHash());
+        cache.Insert(entries.back());
+    }
+    BOOST_CHECK(cache.Size() <= cache.Capacity());
+    size_t nFound = 0;
+    for (const uint256& entry : entries)
+        nFound += cache.Contains(entry);
+    BOOST_CHECK(nFound <= cache.Capacity());
+    BOOST_CHECK(nFound > cache.Capacity() / 2);
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_concurrent_readers)
+{
+    CCuckooCache cache;
+    cache.Setup(1 << 16);
+
+    std::vector<uint256> entries;
+    for (size_t i = 0; i < cache.Capacity() / 4; i++) {
+        entries.push_back(GetRandHash());
+        cache.Insert(entries.back());
+    }
+
+    // Lookups of entries that are never inserted do not hit, however
+    // they interleave with concurrent inserts
+    std::vector<uint256> absent;
+    for (int i = 0; i < 1000; i++)
+        absent.push_back(GetRandHash());
+    std::atomic<bool> fFalseHit(false);
+    boost::thread_group readers;
+    for (int t = 0; t < 4; t++) {
+        readers.create_thread([&]() {
+            for (int n = 0; n < 20; n++)
+                for (const uint256& entry : absent)
+                    if (cache.Contains(entry))
+                        fFalseHit = true;
+        });
+    }
+    for (size_t i = 0; i < cache.Capacity(); i++)
+        cache.Insert(GetRandHash());
+    readers.join_all();
+    BOOST_CHECK(!fFalseHit);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
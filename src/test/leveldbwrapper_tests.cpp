@@ -0,0 +1,64 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "leveldbwrapper.h"
+#include "txdb.h"
+#include "util.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(leveldbwrapper_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(leveldbwrapper_options)
+{
+    CLevelDBOptions options = GetLevelDBOptions("chainstate", 64 << 20);
+    BOOST_CHECK_EQUAL(options.GetBlockCacheSize(), 32U << 20);
+    BOOST_CHECK_EQUAL(options.GetWriteBufferSize(), 16U << 20);
+    BOOST_CHECK_EQUAL(options.nMaxFileSize, (size_t)DEFAULT_LEVELDB_MAX_FILE_SIZE << 20);
+    BOOST_CHECK_EQUAL(options.nBloomBits, DEFAULT_LEVELDB_BLOOM_BITS);
+
+    // Options are per database and clamped to their range
+    mapArgs["-chainstatedbcachesplit"] = "150";
+    mapArgs["-chainstatedbwritebuffer"] = "8";
+    mapArgs["-chainstatedbmaxfilesize"] = "0";
+    mapArgs["-blockindexdbbloombits"] = "0";
+    options = GetLevelDBOptions("chainstate", 64 << 20);
+    BOOST_CHECK_EQUAL(options.GetBlockCacheSize(), 64U << 20);
+    BOOST_CHECK_EQUAL(options.GetWriteBufferSize(), 8U << 20);
+    BOOST_CHECK_EQUAL(options.nMaxFileSize, 1U << 20);
+    BOOST_CHECK_EQUAL(options.nBloomBits, DEFAULT_LEVELDB_BLOOM_BITS);
+    BOOST_CHECK_EQUAL(GetLevelDBOptions("blockindex", 64 << 20).nBloomBits, 0);
+    mapArgs.erase("-chainstatedbcachesplit");
+    mapArgs.erase("-chainstatedbwritebuffer");
+    mapArgs.erase("-chainstatedbmaxfilesize");
+    mapArgs.erase("-blockindexdbbloombits");
+}
+
+BOOST_AUTO_TEST_CASE(leveldbwrapper_stats)
+{
+    CLevelDBWrapper db(GetTempPath() / "leveldbwrapper_stats", CLevelDBOptions(1 << 20), true);
+
+    CLevelDBBatch batch;
+    BOOST_CHECK_EQUAL(batch.SizeEstimate(), 0U);
+    for (int i = 0; i < 100; i++)
+        batch.Write(std::make_pair('a', i), i);
+    BOOST_CHECK(batch.SizeEstimate() > 0);
+    BOOST_CHECK(db.WriteBatch(batch));
+    BOOST_CHECK(db.Write('b', 1));
+
+    int value = 0;
+    BOOST_CHECK(db.Read(std::make_pair('a', 42), value));
+    BOOST_CHECK_EQUAL(value, 42);
+
+    CLevelDBStats stats;
+    db.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nWrites, 2U);
+    BOOST_CHECK(stats.nMaxWriteMicros <= stats.nWriteMicros);
+    BOOST_CHECK(!db.GetProperty("leveldb.stats").empty());
+    BOOST_CHECK(db.GetProperty("leveldb.nonexistent").empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,7 +3,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainparams.h"
+#include "consensus/validation.h"
 #include "main.h"
+#include "random.h"
 
 #include "test/test_bitcoin.h"
 
@@ -101,4 +103,53 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     BOOST_CHECK(Test());
 }
 
+BOOST_AUTO_TEST_CASE(message_stats_histogram)
+{
+    CMessageStats stats;
+    stats.Add(0, 5);
+    stats.Add(9, 0);
+    stats.Add(10, 0);
+    stats.Add(999, 0);
+    stats.Add(1000, 0);
+    stats.Add(5000000, 20);
+
+    BOOST_CHECK_EQUAL(stats.nCount, 6U);
+    BOOST_CHECK_EQUAL(stats.nTotalMicros, 5002018);
+    BOOST_CHECK_EQUAL(stats.nMaxMicros, 5000000);
+    BOOST_CHECK_EQUAL(stats.nTotalWaitMicros, 25);
+    BOOST_CHECK_EQUAL(stats.nMaxWaitMicros, 20);
+    BOOST_CHECK_EQUAL(stats.vBuckets[0], 2U);
+    BOOST_CHECK_EQUAL(stats.vBuckets[1], 1U);
+    BOOST_CHECK_EQUAL(stats.vBuckets[2], 1U);
+    BOOST_CHECK_EQUAL(stats.vBuckets[3], 1U);
+    BOOST_CHECK_EQUAL(stats.vBuckets[4], 0U);
+    BOOST_CHECK_EQUAL(stats.vBuckets[CMessageStats::NUM_BUCKETS - 1], 1U);
+}
+
+BOOST_AUTO_TEST_CASE(mempool_verified_proofs)
+{
+    CMutableTransaction mtx;
+    mtx.nVersion = 2;
+    mtx.vjoinsplit.resize(1);
+    mtx.vjoinsplit[0].nullifiers[0] = GetRandHash();
+    mtx.vjoinsplit[0].nullifiers[1] = GetRandHash();
+    CTransaction tx(mtx);
+
+    // The test parameters have no verifying key, so verifying the proof throws
+    LOCK(cs_main);
+    CValidationState state1;
+    BOOST_CHECK_THROW(AcceptToMemoryPool(mempool, state1, tx, false, NULL), std::runtime_error);
+
+    // Proofs verified by a message check thread are not verified again; the
+    // transaction is then dropped for predating the chain split
+    AddVerifiedProofs(tx.GetHash());
+    CValidationState state2;
+    BOOST_CHECK(!AcceptToMemoryPool(mempool, state2, tx, false, NULL));
+    BOOST_CHECK(state2.IsValid());
+
+    // Only once
+    CValidationState state3;
+    BOOST_CHECK_THROW(AcceptToMemoryPool(mempool, state3, tx, false, NULL), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
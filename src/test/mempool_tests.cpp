@@ -101,4 +101,127 @@ BOOST_AUTO_TEST_CASE(MempoolRemoveTest)
     removed.clear();
 }
 
+static CMutableTransaction MempoolTestTx(const uint256& prevHash, int nOutputs = 1)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_11;
+    tx.vin[0].prevout.hash = prevHash;
+    tx.vin[0].prevout.n = 0;
+    tx.vout.resize(nOutputs);
+    for (int i = 0; i < nOutputs; i++) {
+        tx.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx.vout[i].nValue = 10000LL;
+    }
+    return tx;
+}
+
+BOOST_AUTO_TEST_CASE(MempoolAncestorDescendantStateTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    std::list<CTransaction> removed;
+
+    // Chain of three: parent <- child <- grandchild
+    CMutableTransaction txParent = MempoolTestTx(uint256S("0x01"));
+    CMutableTransaction txChild = MempoolTestTx(txParent.GetHash());
+    CMutableTransaction txGrandChild = MempoolTestTx(txChild.GetHash());
+    pool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 1000, 0, 0.0, 1));
+    pool.addUnchecked(txChild.GetHash(), CTxMemPoolEntry(txChild, 2000, 0, 0.0, 1));
+    pool.addUnchecked(txGrandChild.GetHash(), CTxMemPoolEntry(txGrandChild, 3000, 0, 0.0, 1));
+
+    CTxMemPool::txiter itParent = pool.mapTx.find(txParent.GetHash());
+    CTxMemPool::txiter itChild = pool.mapTx.find(txChild.GetHash());
+    CTxMemPool::txiter itGrandChild = pool.mapTx.find(txGrandChild.GetHash());
+    uint64_t nSize = itParent->GetTxSize();
+    BOOST_CHECK_EQUAL(itParent->GetCountWithDescendants(), 3);
+    BOOST_CHECK_EQUAL(itParent->GetSizeWithDescendants(), 3 * nSize);
+    BOOST_CHECK_EQUAL(itParent->GetModFeesWithDescendants(), 6000);
+    BOOST_CHECK_EQUAL(itParent->GetCountWithAncestors(), 1);
+    BOOST_CHECK_EQUAL(itChild->GetCountWithDescendants(), 2);
+    BOOST_CHECK_EQUAL(itGrandChild->GetCountWithAncestors(), 3);
+    BOOST_CHECK_EQUAL(itGrandChild->GetModFeesWithAncestors(), 6000);
+
+    // Prioritising the grandchild shows up in the packages it belongs to
+    pool.PrioritiseTransaction(txGrandChild.GetHash(), txGrandChild.GetHash().ToString(), 0.0, 500);
+    BOOST_CHECK_EQUAL(itParent->GetModFeesWithDescendants(), 6500);
+    BOOST_CHECK_EQUAL(itGrandChild->GetModifiedFee(), 3500);
+    BOOST_CHECK_EQUAL(itGrandChild->GetModFeesWithAncestors(), 6500);
+
+    // The ancestor limits are enforced on new entries
+    CMutableTransaction txGreatGrandChild = MempoolTestTx(txGrandChild.GetHash());
+    CTxMemPool::setEntries setAncestors;
+    std::string errString;
+    CTxMemPoolEntry entry(txGreatGrandChild, 0, 0, 0.0, 1);
+    BOOST_CHECK(pool.CalculateMemPoolAncestors(entry, setAncestors, 4, 1000000, 4, 1000000, errString));
+    BOOST_CHECK_EQUAL(setAncestors.size(), 3);
+    setAncestors.clear();
+    BOOST_CHECK(!pool.CalculateMemPoolAncestors(entry, setAncestors, 3, 1000000, 4, 1000000, errString));
+    setAncestors.clear();
+    BOOST_CHECK(!pool.CalculateMemPoolAncestors(entry, setAncestors, 4, 1000000, 3, 1000000, errString));
+
+    // Mining the parent leaves its descendants with one ancestor less
+    pool.remove(txParent, removed, false);
+    BOOST_CHECK_EQUAL(removed.size(), 1);
+    BOOST_CHECK_EQUAL(pool.size(), 2);
+    BOOST_CHECK_EQUAL(itChild->GetCountWithAncestors(), 1);
+    BOOST_CHECK_EQUAL(itGrandChild->GetCountWithAncestors(), 2);
+    BOOST_CHECK_EQUAL(itGrandChild->GetModFeesWithAncestors(), 5500);
+    BOOST_CHECK_EQUAL(itChild->GetModFeesWithDescendants(), 5500);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
+{
+    CTxMemPool pool(CFeeRate(1000));
+
+    CMutableTransaction tx1 = MempoolTestTx(uint256S("0x01"));
+    CMutableTransaction tx2 = MempoolTestTx(uint256S("0x02"));
+    pool.addUnchecked(tx1.GetHash(), CTxMemPoolEntry(tx1, 10000, 0, 0.0, 1));
+    pool.addUnchecked(tx2.GetHash(), CTxMemPoolEntry(tx2, 5000, 0, 0.0, 1));
+    // A zero-fee parent whose child pays for both
+    CMutableTransaction tx3 = MempoolTestTx(uint256S("0x03"));
+    CMutableTransaction tx4 = MempoolTestTx(tx3.GetHash());
+    pool.addUnchecked(tx3.GetHash(), CTxMemPoolEntry(tx3, 0, 0, 0.0, 1));
+    pool.addUnchecked(tx4.GetHash(), CTxMemPoolEntry(tx4, 20000, 0, 0.0, 1));
+    BOOST_CHECK_EQUAL(pool.GetMinFee(1).GetFeePerK(), 0);
+
+    // Within the limit nothing is evicted
+    pool.TrimToSize(pool.DynamicMemoryUsage());
+    BOOST_CHECK_EQUAL(pool.size(), 4);
+
+    // The package with the lowest feerate goes first: tx2, not tx3
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(!pool.exists(tx2.GetHash()));
+    BOOST_CHECK(pool.exists(tx3.GetHash()));
+    BOOST_CHECK(pool.exists(tx4.GetHash()));
+
+    // Eviction bumps the minimum fee to the evicted feerate plus the
+    // minimum relay fee
+    CTxMemPool::txiter it1 = pool.mapTx.find(tx1.GetHash());
+    CAmount nEvictedFeePerK = CFeeRate(5000, it1->GetTxSize()).GetFeePerK();
+    BOOST_CHECK_EQUAL(pool.GetMinFee(1).GetFeePerK(), nEvictedFeePerK + 1000);
+
+    // Packages are evicted whole
+    pool.TrimToSize(1);
+    BOOST_CHECK_EQUAL(pool.size(), 0);
+    BOOST_CHECK_EQUAL(pool.mapNextTx.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolExpireTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+
+    CMutableTransaction txOld = MempoolTestTx(uint256S("0x01"));
+    CMutableTransaction txOldChild = MempoolTestTx(txOld.GetHash());
+    CMutableTransaction txNew = MempoolTestTx(uint256S("0x02"));
+    pool.addUnchecked(txOld.GetHash(), CTxMemPoolEntry(txOld, 0, 100, 0.0, 1));
+    pool.addUnchecked(txOldChild.GetHash(), CTxMemPoolEntry(txOldChild, 0, 300, 0.0, 1));
+    pool.addUnchecked(txNew.GetHash(), CTxMemPoolEntry(txNew, 0, 200, 0.0, 1));
+
+    BOOST_CHECK_EQUAL(pool.Expire(100), 0);
+    // Expiring a transaction takes its descendants, however recent
+    BOOST_CHECK_EQUAL(pool.Expire(150), 2);
+    BOOST_CHECK_EQUAL(pool.size(), 1);
+    BOOST_CHECK(pool.exists(txNew.GetHash()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,8 +4,10 @@
 
 #include "rpcserver.h"
 #include "rpcclient.h"
+#include "rpcjsoncache.h"
 
 #include "base58.h"
+#include "main.h"
 #include "netbase.h"
 
 #include "test/test_bitcoin.h"
@@ -295,4 +297,69 @@ BOOST_AUTO_TEST_CASE(rpc_ban)
     BOOST_CHECK_EQUAL(adr.get_str(), "2001:4d48:ac57:400:cacf:e9ff:fe1d:9c63/ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff");
 }
 
+BOOST_AUTO_TEST_CASE(rpc_json_cache)
+{
+    CRPCJSONCache cache(1000);
+    CRPCJSONCache::Entry entry;
+    uint256 hash1 = uint256S("01");
+    uint256 hash2 = uint256S("02");
+
+    // Entries are evicted least recently used first
+    for (int i = 0; i < 4; i++) {
+        entry.members = std::make_shared<const std::string>(std::string(50, 'a' + i));
+        cache.Put(CRPCJSONCache::BLOCK, i < 2 ? hash1 : hash2, i % 2 + 1, entry);
+    }
+    BOOST_CHECK_EQUAL(cache.Size(), 4U);
+    BOOST_CHECK(cache.Get(CRPCJSONCache::BLOCK, hash1, 1, entry));
+    BOOST_CHECK_EQUAL(*entry.members, std::string(50, 'a'));
+    BOOST_CHECK(!cache.Get(CRPCJSONCache::TRANSACTION, hash1, 1, entry));
+    cache.SetMaxBytes(3 * cache.Bytes() / 4);
+    BOOST_CHECK_EQUAL(cache.Size(), 3U);
+    BOOST_CHECK(cache.Get(CRPCJSONCache::BLOCK, hash1, 1, entry));
+    BOOST_CHECK(!cache.Get(CRPCJSONCache::BLOCK, hash1, 2, entry));
+
+    // Results too large for the cache are not kept
+    entry.members = std::make_shared<const std::string>(std::string(1000, 'x'));
+    cache.Put(CRPCJSONCache::TRANSACTION, hash1, 1, entry);
+    BOOST_CHECK(!cache.Get(CRPCJSONCache::TRANSACTION, hash1, 1, entry));
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+    BOOST_CHECK_EQUAL(cache.Bytes(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_getblock_json)
+{
+    std::string strHash = chainActive.Genesis()->GetBlockHash().GetHex();
+
+    // The JSON text, fresh and from the cache, is the same as getblock's
+    for (int verbosity = 1; verbosity <= 2; verbosity++) {
+        UniValue expected = CallRPC("getblock " + strHash + " " + std::to_string(verbosity));
+        for (int i = 0; i < 2; i++) {
+            UniValue params(UniValue::VARR);
+            params.push_back(strHash);
+            params.push_back(verbosity);
+            JSONChunks chunks;
+            BOOST_CHECK(getblockjson(params, chunks));
+            std::string strJSON;
+            for (const std::shared_ptr<const std::string>& chunk : chunks)
+                strJSON += *chunk;
+            BOOST_CHECK_EQUAL(strJSON, expected.write());
+        }
+    }
+
+    // The hex encoded block is left to getblock
+    UniValue params(UniValue::VARR);
+    params.push_back(strHash);
+    params.push_back(false);
+    JSONChunks chunks;
+    BOOST_CHECK(!getblockjson(params, chunks));
+    // without looking the block up
+    params.setArray();
+    params.push_back(uint256().GetHex());
+    params.push_back(0);
+    BOOST_CHECK(!getblockjson(params, chunks));
+    BOOST_CHECK_THROW(CallRPC("getblock " + strHash + " 3"), runtime_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@
 #include "test_bitcoin.h"
 
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 
 #include "key.h"
 #include "main.h"
@@ -33,6 +34,7 @@ extern void noui_connect();
 BasicTestingSetup::BasicTestingSetup()
 {
         assert(init_and_check_sodium() != -1);
+        SHA256AutoDetect();
         ECC_Start();
         pzcashParams = ZCJoinSplit::Unopened();
         SetupEnvironment();
@@ -68,6 +70,8 @@ TestingSetup::TestingSetup()
         nScriptCheckThreads = 3;
         for (int i=0; i < nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i < nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadMerkleCheck);
         RegisterNodeSignals(GetNodeSignals());
 }
 
@@ -84,6 +88,7 @@ TestingSetup::~TestingSetup()
         UnloadBlockIndex();
         delete pcoinsTip;
         delete pcoinsdbview;
+        pcoinsdbview = NULL;
         delete pblocktree;
 #ifdef ENABLE_WALLET
         bitdb.Flush(true);
@@ -0,0 +1,67 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TIMESTAMPINDEX_H
+#define BITCOIN_TIMESTAMPINDEX_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+/**
+ * Timestamp index key: a block of the active chain by header time. The
+ * time is serialized big-endian, so that entries iterate in time order.
+ */
+struct CTimestampIndexKey {
+    unsigned int timestamp;
+    uint256 blockHash;
+
+    CTimestampIndexKey(unsigned int time, const uint256& hash) : timestamp(time), blockHash(hash) {}
+
+    CTimestampIndexKey() { SetNull(); }
+
+    void SetNull()
+    {
+        timestamp = 0;
+        blockHash.SetNull();
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return 36;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        ser_writedata32be(s, timestamp);
+        blockHash.Serialize(s, nType, nVersion);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        timestamp = ser_readdata32be(s);
+        blockHash.Unserialize(s, nType, nVersion);
+    }
+};
+
+/** Prefix of CTimestampIndexKey selecting the blocks from a time on */
+struct CTimestampIndexIteratorKey {
+    unsigned int timestamp;
+
+    CTimestampIndexIteratorKey(unsigned int time) : timestamp(time) {}
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return 4;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        ser_writedata32be(s, timestamp);
+    }
+};
+
+#endif // BITCOIN_TIMESTAMPINDEX_H
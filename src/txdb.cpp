@@ -10,9 +10,12 @@
 #include "main.h"
 #include "pow.h"
 #include "uint256.h"
+#include "util.h"
+#include "utiltime.h"
 
 #include <stdint.h>
 
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -23,6 +26,10 @@ static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_ADDRESSINDEX = 'd';
+static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_SPENTINDEX = 'p';
+static const char DB_TIMESTAMPINDEX = 'S';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_BEST_ANCHOR = 'a';
@@ -65,11 +72,134 @@ void static BatchWriteHashBestAnchor(CLevelDBBatch &batch, const uint256 &hash)
     batch.Write(DB_BEST_ANCHOR, hash);
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe) {
+CLevelDBOptions GetLevelDBOptions(const std::string& strName, size_t nCacheSize)
+{
+    CLevelDBOptions options(nCacheSize);
+    std::string strPrefix = "-" + strName + "db";
+    options.nBlockCachePercent = std::max(0, std::min(100, (int)GetArg(strPrefix + "cachesplit", DEFAULT_LEVELDB_BLOCK_CACHE_PERCENT)));
+    options.nWriteBufferSize = std::max((int64_t)0, GetArg(strPrefix + "writebuffer", 0)) << 20;
+    options.nMaxFileSize = std::max((int64_t)1, std::min((int64_t)1024, GetArg(strPrefix + "maxfilesize", DEFAULT_LEVELDB_MAX_FILE_SIZE))) << 20;
+    options.nBloomBits = std::max(0, std::min(64, (int)GetArg(strPrefix + "bloombits", DEFAULT_LEVELDB_BLOOM_BITS)));
+    return options;
+}
+
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(GetDataDir() / "chainstate", GetLevelDBOptions("chainstate", nCacheSize), fMemory, fWipe),
+    fPending(false), fWriteFailed(false), fStopWriter(false), flushStats() {
+}
+
+CCoinsViewDB::~CCoinsViewDB() {
+    if (writerThread.joinable()) {
+        {
+            boost::unique_lock<boost::mutex> lock(csPending);
+            fStopWriter = true;
+            condPending.notify_all();
+        }
+        // The writer commits a pending write before it exits
+        writerThread.join();
+    }
+}
+
+void CCoinsViewDB::StartBackgroundFlush() {
+    if (writerThread.joinable())
+        return;
+    boost::function<void()> writer = boost::bind(&CCoinsViewDB::ThreadWriteCoins, this);
+    writerThread = boost::thread(boost::bind(&TraceThread<boost::function<void()> >, "coinsflush", writer));
+}
+
+void CCoinsViewDB::ThreadWriteCoins() {
+    boost::unique_lock<boost::mutex> lock(csPending);
+    while (true) {
+        while (!fStopWriter && !(fPending && !fWriteFailed))
+            condPending.wait(lock);
+        if (!fPending || fWriteFailed)
+            return;
+
+        // Nothing modifies the pending entries until fPending is reset, lookups only read them
+        lock.unlock();
+        int64_t nStart = GetTimeMicros();
+        size_t nEntries = 0;
+        bool fOk = false;
+        try {
+            fOk = WriteCoins(pendingCoins, hashPendingBlock, hashPendingAnchor, pendingAnchors, pendingNullifiers, nEntries);
+        } catch (const std::runtime_error& e) {
+            LogPrintf("Error writing to the coin database: %s\n", e.what());
+        }
+        int64_t nFlushMicros = GetTimeMicros() - nStart;
+        lock.lock();
+
+        if (fOk) {
+            // Release the pools of the maps as well
+            CCoinsMap().swap(pendingCoins);
+            pendingAnchors.clear();
+            CNullifiersMap().swap(pendingNullifiers);
+            hashPendingBlock.SetNull();
+            hashPendingAnchor.SetNull();
+            fPending = false;
+            RecordFlush(nEntries, nFlushMicros, true);
+        } else {
+            // Keep answering lookups from the entries; the next flush reports the failure
+            fWriteFailed = true;
+        }
+        condPending.notify_all();
+    }
+}
+
+bool CCoinsViewDB::WaitForFlush() {
+    int64_t nStart = GetTimeMicros();
+    boost::unique_lock<boost::mutex> lock(csPending);
+    if (!fPending)
+        return !fWriteFailed;
+    while (fPending && !fWriteFailed)
+        condPending.wait(lock);
+    int64_t nWaitMicros = GetTimeMicros() - nStart;
+    flushStats.nLastWaitMicros += nWaitMicros;
+    flushStats.nTotalWaitMicros += nWaitMicros;
+    return !fWriteFailed;
+}
+
+void CCoinsViewDB::RecordFlush(size_t nEntries, int64_t nFlushMicros, bool fBackground) {
+    flushStats.nFlushes++;
+    if (fBackground)
+        flushStats.nBackgroundFlushes++;
+    flushStats.nLastFlushTime = GetTime();
+    flushStats.nLastFlushEntries = nEntries;
+    flushStats.nLastFlushMicros = nFlushMicros;
+    flushStats.nTotalFlushMicros += nFlushMicros;
+    LogPrint("coindb", "Committed %u entries to coin database in %.2fms%s\n", (unsigned int)nEntries,
+             nFlushMicros * 0.001, fBackground ? " in the background" : "");
+}
+
+void CCoinsViewDB::GetFlushStats(CCoinsFlushStats &stats) const {
+    boost::unique_lock<boost::mutex> lock(csPending);
+    stats = flushStats;
+    stats.fPending = fPending;
+}
+
+std::vector<std::pair<std::string, uint64_t> > CCoinsViewDB::EstimateSizes() const
+{
+    std::vector<std::pair<std::string, uint64_t> > vSizes;
+    vSizes.push_back(make_pair("coins", db.EstimateSize(DB_COINS, (char)(DB_COINS + 1))));
+    vSizes.push_back(make_pair("nullifiers", db.EstimateSize(DB_NULLIFIER, (char)(DB_NULLIFIER + 1))));
+    vSizes.push_back(make_pair("anchors", db.EstimateSize(DB_ANCHOR, (char)(DB_ANCHOR + 1))));
+    return vSizes;
 }
 
 
 bool CCoinsViewDB::GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree) const {
+    {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        if (fPending) {
+            CAnchorsMap::const_iterator it = pendingAnchors.find(rt);
+            if (it != pendingAnchors.end()) {
+                if (!it->second.entered)
+                    return false;
+                tree = it->second.tree;
+                return true;
+            }
+        }
+    }
+
     if (rt == ZCIncrementalMerkleTree::empty_root()) {
         ZCIncrementalMerkleTree new_tree;
         tree = new_tree;
@@ -82,6 +212,15 @@ bool CCoinsViewDB::GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree)
 }
 
 bool CCoinsViewDB::GetNullifier(const uint256 &nf) const {
+    {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        if (fPending) {
+            CNullifiersMap::const_iterator it = pendingNullifiers.find(nf);
+            if (it != pendingNullifiers.end())
+                return it->second.entered;
+        }
+    }
+
     bool spent = false;
     bool read = db.Read(make_pair(DB_NULLIFIER, nf), spent);
 
@@ -89,14 +228,40 @@ bool CCoinsViewDB::GetNullifier(const uint256 &nf) const {
 }
 
 bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
+    {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        if (fPending) {
+            // Pruned entries are about to be erased from the database
+            CCoinsMap::const_iterator it = pendingCoins.find(txid);
+            if (it != pendingCoins.end()) {
+                if (it->second.coins.IsPruned())
+                    return false;
+                coins = it->second.coins;
+                return true;
+            }
+        }
+    }
     return db.Read(make_pair(DB_COINS, txid), coins);
 }
 
 bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
+    {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        if (fPending) {
+            CCoinsMap::const_iterator it = pendingCoins.find(txid);
+            if (it != pendingCoins.end())
+                return !it->second.coins.IsPruned();
+        }
+    }
     return db.Exists(make_pair(DB_COINS, txid));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        if (fPending && !hashPendingBlock.IsNull())
+            return hashPendingBlock;
+    }
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -104,6 +269,11 @@ uint256 CCoinsViewDB::GetBestBlock() const {
 }
 
 uint256 CCoinsViewDB::GetBestAnchor() const {
+    {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        if (fPending && !hashPendingAnchor.IsNull())
+            return hashPendingAnchor;
+    }
     uint256 hashBestAnchor;
     if (!db.Read(DB_BEST_ANCHOR, hashBestAnchor))
         return ZCIncrementalMerkleTree::empty_root();
@@ -115,35 +285,72 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
                               const uint256 &hashAnchor,
                               CAnchorsMap &mapAnchors,
                               CNullifiersMap &mapNullifiers) {
+    int64_t nStart = GetTimeMicros();
+    if (writerThread.joinable()) {
+        boost::unique_lock<boost::mutex> lock(csPending);
+        while (fPending && !fWriteFailed)
+            condPending.wait(lock);
+        if (fWriteFailed)
+            return false;
+        // The pending maps are empty, so this leaves the caller's maps cleared
+        pendingCoins.swap(mapCoins);
+        pendingAnchors.swap(mapAnchors);
+        pendingNullifiers.swap(mapNullifiers);
+        hashPendingBlock = hashBlock;
+        hashPendingAnchor = hashAnchor;
+        fPending = true;
+        flushStats.nLastWaitMicros = GetTimeMicros() - nStart;
+        flushStats.nTotalWaitMicros += flushStats.nLastWaitMicros;
+        LogPrint("coindb", "Queued %u transactions for the coin database writer after %.2fms\n",
+                 (unsigned int)pendingCoins.size(), flushStats.nLastWaitMicros * 0.001);
+        condPending.notify_all();
+        return true;
+    }
+
+    size_t nEntries = 0;
+    bool fOk = WriteCoins(mapCoins, hashBlock, hashAnchor, mapAnchors, mapNullifiers, nEntries);
+    mapCoins.clear();
+    mapAnchors.clear();
+    mapNullifiers.clear();
+    int64_t nFlushMicros = GetTimeMicros() - nStart;
+
+    boost::unique_lock<boost::mutex> lock(csPending);
+    flushStats.nLastWaitMicros = nFlushMicros;
+    flushStats.nTotalWaitMicros += nFlushMicros;
+    RecordFlush(nEntries, nFlushMicros, false);
+    return fOk;
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins,
+                              const uint256 &hashBlock,
+                              const uint256 &hashAnchor,
+                              const CAnchorsMap &mapAnchors,
+                              const CNullifiersMap &mapNullifiers,
+                              size_t &nEntries) {
     CLevelDBBatch batch;
     size_t count = 0;
     size_t changed = 0;
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             BatchWriteCoins(batch, it->first, it->second.coins);
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
     }
+    nEntries = changed;
 
-    for (CAnchorsMap::iterator it = mapAnchors.begin(); it != mapAnchors.end();) {
+    for (CAnchorsMap::const_iterator it = mapAnchors.begin(); it != mapAnchors.end(); it++) {
         if (it->second.flags & CAnchorsCacheEntry::DIRTY) {
             BatchWriteAnchor(batch, it->first, it->second.tree, it->second.entered);
-            // TODO: changed++?
+            nEntries++;
         }
-        CAnchorsMap::iterator itOld = it++;
-        mapAnchors.erase(itOld);
     }
 
-    for (CNullifiersMap::iterator it = mapNullifiers.begin(); it != mapNullifiers.end();) {
+    for (CNullifiersMap::const_iterator it = mapNullifiers.begin(); it != mapNullifiers.end(); it++) {
         if (it->second.flags & CNullifiersCacheEntry::DIRTY) {
             BatchWriteNullifier(batch, it->first, it->second.entered);
-            // TODO: changed++?
+            nEntries++;
         }
-        CNullifiersMap::iterator itOld = it++;
-        mapNullifiers.erase(itOld);
     }
 
     if (!hashBlock.IsNull())
@@ -155,7 +362,24 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
     return db.WriteBatch(batch);
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "blocks" / "index", GetLevelDBOptions("blockindex", nCacheSize), fMemory, fWipe) {
+}
+
+std::vector<std::pair<std::string, uint64_t> > CBlockTreeDB::EstimateSizes() const
+{
+    static const std::pair<const char*, char> prefixes[] = {
+        make_pair("blockindex", DB_BLOCK_INDEX),
+        make_pair("blockfiles", DB_BLOCK_FILES),
+        make_pair("txindex", DB_TXINDEX),
+        make_pair("addressindex", DB_ADDRESSINDEX),
+        make_pair("addressunspentindex", DB_ADDRESSUNSPENTINDEX),
+        make_pair("spentindex", DB_SPENTINDEX),
+        make_pair("timestampindex", DB_TIMESTAMPINDEX),
+    };
+    std::vector<std::pair<std::string, uint64_t> > vSizes;
+    for (const auto& prefix : prefixes)
+        vSizes.push_back(make_pair(prefix.first, EstimateSize(prefix.second, (char)(prefix.second + 1))));
+    return vSizes;
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -246,6 +470,10 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex &dbindex) {
+    return Read(make_pair(DB_BLOCK_INDEX, blockhash), dbindex);
+}
+
 bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
     return Read(make_pair(DB_TXINDEX, txid), pos);
 }
@@ -257,6 +485,166 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value) {
+    return Read(make_pair(DB_SPENTINDEX, key), value);
+}
+
+bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (it->second.IsNull())
+            batch.Erase(make_pair(DB_SPENTINDEX, it->first));
+        else
+            batch.Write(make_pair(DB_SPENTINDEX, it->first), it->second);
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >&vect) {
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (it->second.IsNull())
+            batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+        else
+            batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndex(const uint160 &addressHash, unsigned int type,
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect) {
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash));
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CAddressUnspentKey indexKey;
+            ssKey >> chType;
+            if (chType != DB_ADDRESSUNSPENTINDEX)
+                break;
+            ssKey >> indexKey;
+            if (indexKey.type != type || indexKey.hashBytes != addressHash)
+                break;
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            CAddressUnspentValue nValue;
+            ssValue >> nValue;
+            vect.push_back(make_pair(indexKey, nValue));
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressIndex(const uint160 &addressHash, unsigned int type,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                    int start, int end) {
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    if (start > 0)
+        ssKeySet << make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start));
+    else
+        ssKeySet << make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash));
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CAddressIndexKey indexKey;
+            ssKey >> chType;
+            if (chType != DB_ADDRESSINDEX)
+                break;
+            ssKey >> indexKey;
+            if (indexKey.type != type || indexKey.hashBytes != addressHash)
+                break;
+            if (end > 0 && indexKey.blockHeight > end)
+                break;
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            CAmount nValue;
+            ssValue >> nValue;
+            addressIndex.push_back(make_pair(indexKey, nValue));
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
+    CLevelDBBatch batch;
+    batch.Write(make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseTimestampIndex(const CTimestampIndexKey &timestampIndex) {
+    CLevelDBBatch batch;
+    batch.Erase(make_pair(DB_TIMESTAMPINDEX, timestampIndex));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadTimestampIndex(unsigned int high, unsigned int low, std::vector<uint256> &hashes) {
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low));
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CTimestampIndexKey indexKey;
+            ssKey >> chType;
+            if (chType != DB_TIMESTAMPINDEX)
+                break;
+            ssKey >> indexKey;
+            if (indexKey.timestamp >= high)
+                break;
+            hashes.push_back(indexKey.blockHash);
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -271,6 +659,9 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
 
 bool CBlockTreeDB::LoadBlockIndexGuts()
 {
+    int64_t nStart = GetTimeMillis();
+    size_t nEntries = 0;
+    size_t nSolutionBytes = 0;
     boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
 
     CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
@@ -305,9 +696,12 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
                 pindexNew->nTime          = diskindex.nTime;
                 pindexNew->nBits          = diskindex.nBits;
                 pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nSolution      = diskindex.nSolution;
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
+                // The solution stays on disk and is read on demand.
+                pindexNew->TrimSolution();
+                nSolutionBytes += diskindex.nSolution.size();
+                nEntries++;
 
                 if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus()))
                     return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
@@ -321,5 +715,8 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
         }
     }
 
+    LogPrintf("%s: loaded %u block index entries in %dms, %u KiB of Equihash solutions left on disk\n",
+              __func__, nEntries, GetTimeMillis() - nStart, nSolutionBytes / 1024);
+
     return true;
 }
@@ -6,16 +6,23 @@
 #ifndef BITCOIN_TXDB_H
 #define BITCOIN_TXDB_H
 
+#include "addressindex.h"
 #include "coins.h"
 #include "leveldbwrapper.h"
+#include "spentindex.h"
+#include "sync.h"
+#include "timestampindex.h"
 
 #include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <boost/thread.hpp>
+
 class CBlockFileInfo;
 class CBlockIndex;
+class CDiskBlockIndex;
 struct CDiskTxPos;
 class uint256;
 
@@ -25,14 +32,74 @@ static const int64_t nDefaultDbCache = 100;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! -backgroundflush default
+static const bool DEFAULT_BACKGROUND_FLUSH = false;
+
+/** Tuning of the database strName ("chainstate" or "blockindex") from its -<name>db* options */
+CLevelDBOptions GetLevelDBOptions(const std::string& strName, size_t nCacheSize);
+
+/** Counters and timings of the writes of the coin database */
+struct CCoinsFlushStats
+{
+    uint64_t nFlushes;
+    uint64_t nBackgroundFlushes;
+    //! whether a background write is queued or running
+    bool fPending;
+    //! when the last write was committed (unix time, 0 if none yet)
+    int64_t nLastFlushTime;
+    //! dirty coins, anchors and nullifiers in the last write
+    uint64_t nLastFlushEntries;
+    //! time it took to build and commit the last write
+    int64_t nLastFlushMicros;
+    //! time the flushing thread was blocked by the last flush
+    int64_t nLastWaitMicros;
+    int64_t nTotalFlushMicros;
+    int64_t nTotalWaitMicros;
+};
 
-/** CCoinsView backed by the LevelDB coin database (chainstate/) */
+/**
+ * CCoinsView backed by the LevelDB coin database (chainstate/)
+ *
+ * With StartBackgroundFlush(), BatchWrite takes over the flushed entries and
+ * returns, and a writer thread commits them. Until then lookups are answered
+ * from those entries, so the views above see the flushed state throughout.
+ * Only one write is pending at a time: a BatchWrite while one is in progress
+ * first waits for it. The coins, anchors, nullifiers and best block marker of
+ * a flush are committed in a single batch, so after a crash the database is
+ * at either the previous or the new best block.
+ */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CLevelDBWrapper db;
+
+    //! flushed entries waiting for the writer thread (protected by csPending)
+    mutable CWaitableCriticalSection csPending;
+    CConditionVariable condPending;
+    CCoinsMap pendingCoins;
+    CAnchorsMap pendingAnchors;
+    CNullifiersMap pendingNullifiers;
+    uint256 hashPendingBlock;
+    uint256 hashPendingAnchor;
+    bool fPending;
+    bool fWriteFailed;
+    bool fStopWriter;
+    CCoinsFlushStats flushStats;
+    boost::thread writerThread;
+
+    bool WriteCoins(const CCoinsMap &mapCoins,
+                    const uint256 &hashBlock,
+                    const uint256 &hashAnchor,
+                    const CAnchorsMap &mapAnchors,
+                    const CNullifiersMap &mapNullifiers,
+                    size_t &nEntries);
+    void ThreadWriteCoins();
+    //! Account for a committed write (csPending must be held)
+    void RecordFlush(size_t nEntries, int64_t nFlushMicros, bool fBackground);
+
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CCoinsViewDB();
 
     bool GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree) const;
     bool GetNullifier(const uint256 &nf) const;
@@ -46,6 +113,16 @@ public:
                     CAnchorsMap &mapAnchors,
                     CNullifiersMap &mapNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+
+    //! Commit subsequent BatchWrites from a writer thread
+    void StartBackgroundFlush();
+    //! Wait until no write is pending; false if a background write failed
+    bool WaitForFlush();
+    void GetFlushStats(CCoinsFlushStats &stats) const;
+
+    const CLevelDBWrapper& GetDB() const { return db; }
+    //! Approximate size on disk of each kind of entry
+    std::vector<std::pair<std::string, uint64_t> > EstimateSizes() const;
 };
 
 /** Access to the block database (blocks/index/) */
@@ -53,17 +130,33 @@ class CBlockTreeDB : public CLevelDBWrapper
 {
 public:
     CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    //! Approximate size on disk of each kind of entry
+    std::vector<std::pair<std::string, uint64_t> > EstimateSizes() const;
 private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
 public:
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
+    bool ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex &dbindex);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindex);
     bool ReadReindexing(bool &fReindex);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
+    bool ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value);
+    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &vect);
+    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    bool ReadAddressUnspentIndex(const uint160 &addressHash, unsigned int type,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    bool ReadAddressIndex(const uint160 &addressHash, unsigned int type,
+                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                          int start = 0, int end = 0);
+    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
+    bool EraseTimestampIndex(const CTimestampIndexKey &timestampIndex);
+    bool ReadTimestampIndex(unsigned int high, unsigned int low, std::vector<uint256> &vect);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts();
@@ -0,0 +1,78 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "asyncrpcoperation_common.h"
+
+#include "consensus/validation.h"
+#include "core_io.h"
+#include "init.h"
+#include "main.h"
+#include "net.h"
+#include "rpcprotocol.h"
+#include "script/interpreter.h"
+#include "script/sign.h"
+#include "script/standard.h"
+#include "wallet.h"
+
+void SignTransparentInputs(CMutableTransaction& mtx)
+{
+    if (mtx.vin.empty())
+        return;
+
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    if (pwalletMain->IsLocked())
+        throw JSONRPCError(RPC_WALLET_UNLOCK_NEEDED, "Error: Please enter the wallet passphrase with walletpassphrase first.");
+
+    for (unsigned int i = 0; i < mtx.vin.size(); i++) {
+        const COutPoint& prevout = mtx.vin[i].prevout;
+        const CWalletTx* wtx = pwalletMain->GetWalletTx(prevout.hash);
+        if (wtx == NULL || prevout.n >= wtx->vout.size())
+            throw JSONRPCError(RPC_WALLET_ERROR, strprintf("Failed to sign transaction: input %u (%s) is not in the wallet", i, prevout.ToString()));
+        const CScript& prevPubKey = wtx->vout[prevout.n].scriptPubKey;
+
+        mtx.vin[i].scriptSig.clear();
+        SignSignature(*pwalletMain, prevPubKey, mtx, i, SIGHASH_ALL);
+
+        ScriptError serror = SCRIPT_ERR_OK;
+        if (!VerifyScript(mtx.vin[i].scriptSig, prevPubKey, STANDARD_NONCONTEXTUAL_SCRIPT_VERIFY_FLAGS, MutableTransactionSignatureChecker(&mtx, i), &serror))
+            throw JSONRPCError(RPC_WALLET_ENCRYPTION_FAILED, strprintf("Failed to sign transaction: input %u: %s", i, ScriptErrorString(serror)));
+    }
+}
+
+UniValue SendTransaction(const CTransaction& tx, bool testmode)
+{
+    UniValue o(UniValue::VOBJ);
+
+    // Test mode does not send the transaction to the network.
+    if (testmode) {
+        o.push_back(Pair("test", 1));
+        o.push_back(Pair("txid", tx.GetHash().ToString()));
+        o.push_back(Pair("hex", EncodeHexTx(tx)));
+        return o;
+    }
+
+    {
+        LOCK(cs_main);
+        const CCoins* existingCoins = pcoinsTip->AccessCoins(tx.GetHash());
+        if (existingCoins && existingCoins->nHeight < 1000000000)
+            throw JSONRPCError(RPC_TRANSACTION_ALREADY_IN_CHAIN, "transaction already in block chain");
+
+        if (!mempool.exists(tx.GetHash())) {
+            // push to local node and sync with wallets
+            CValidationState state;
+            bool fMissingInputs;
+            if (!AcceptToMemoryPool(mempool, state, tx, false, &fMissingInputs, true)) {
+                if (state.IsInvalid())
+                    throw JSONRPCError(RPC_TRANSACTION_REJECTED, strprintf("%i: %s", state.GetRejectCode(), state.GetRejectReason()));
+                if (fMissingInputs)
+                    throw JSONRPCError(RPC_TRANSACTION_ERROR, "Missing inputs");
+                throw JSONRPCError(RPC_TRANSACTION_ERROR, state.GetRejectReason());
+            }
+        }
+    }
+    RelayTransaction(tx);
+
+    o.push_back(Pair("txid", tx.GetHash().ToString()));
+    return o;
+}
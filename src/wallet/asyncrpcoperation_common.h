@@ -0,0 +1,27 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ASYNCRPCOPERATION_COMMON_H
+#define ASYNCRPCOPERATION_COMMON_H
+
+#include "primitives/transaction.h"
+
+#include <univalue.h>
+
+/**
+ * Sign the transparent inputs of a transaction built by an asynchronous
+ * operation, with the keys of the wallet holding the outputs they spend.
+ * Throws a JSONRPCError naming the input that could not be signed.
+ */
+void SignTransparentInputs(CMutableTransaction& mtx);
+
+/**
+ * Submit a signed transaction to the memory pool and relay it to the peers,
+ * like sendrawtransaction; in test mode it is only described. Returns the
+ * result object of the operation. Throws a JSONRPCError with the reason the
+ * transaction was rejected.
+ */
+UniValue SendTransaction(const CTransaction& tx, bool testmode);
+
+#endif // ASYNCRPCOPERATION_COMMON_H
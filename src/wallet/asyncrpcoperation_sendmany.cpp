@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "asyncrpcoperation_sendmany.h"
+#include "asyncrpcoperation_common.h"
 #include "asyncrpcqueue.h"
 #include "amount.h"
 #include "core_io.h"
@@ -146,6 +147,9 @@ void AsyncRPCOperation_sendmany::main() {
         set_error_message("unknown error");
     }
 
+    // Wait for the proofs still being computed after a failure
+    proofs_.clear();
+
 #ifdef ENABLE_MINING
   #ifdef ENABLE_WALLET
     GenerateBitcoins(GetBoolArg("-gen",false), pwalletMain, GetArg("-genproclimit", 1));
@@ -337,9 +341,7 @@ bool AsyncRPCOperation_sendmany::main_impl() {
                     );
         }
         
-        UniValue obj(UniValue::VOBJ);
-        obj.push_back(Pair("rawtxn", EncodeHexTx(tx_)));
-        sign_send_raw_transaction(obj);
+        sign_send_transaction(tx_);
         return true;
     }
     /**
@@ -445,7 +447,8 @@ bool AsyncRPCOperation_sendmany::main_impl() {
             }
             obj = perform_joinsplit(info);
         }
-        sign_send_raw_transaction(obj);
+        complete_joinsplits();
+        sign_send_transaction(tx_);
         return true;
     }
     /**
@@ -718,75 +721,25 @@ bool AsyncRPCOperation_sendmany::main_impl() {
     assert(zOutputsDeque.size() == 0);
     assert(vpubNewProcessed);
 
-    sign_send_raw_transaction(obj);
+    complete_joinsplits();
+    sign_send_transaction(tx_);
     return true;
 }
 
 
 /**
- * Sign and send a raw transaction.
- * Raw transaction as hex string should be in object field "rawtxn"
+ * Sign the transparent inputs of the transaction with the wallet keys and
+ * submit it to the mempool directly, without going through the RPC handlers
+ * and a hex encoding of the transaction for each step.
  */
-void AsyncRPCOperation_sendmany::sign_send_raw_transaction(UniValue obj)
-{   
-    // Sign the raw transaction
-    UniValue rawtxnValue = find_value(obj, "rawtxn");
-    if (rawtxnValue.isNull()) {
-        throw JSONRPCError(RPC_WALLET_ERROR, "Missing hex data for raw transaction");
-    }
-    std::string rawtxn = rawtxnValue.get_str();
-
-    UniValue params = UniValue(UniValue::VARR);
-    params.push_back(rawtxn);
-    UniValue signResultValue = signrawtransaction(params, false);
-    UniValue signResultObject = signResultValue.get_obj();
-    UniValue completeValue = find_value(signResultObject, "complete");
-    bool complete = completeValue.get_bool();
-    if (!complete) {
-        // TODO: #1366 Maybe get "errors" and print array vErrors into a string
-        throw JSONRPCError(RPC_WALLET_ENCRYPTION_FAILED, "Failed to sign transaction");
-    }
-
-    UniValue hexValue = find_value(signResultObject, "hex");
-    if (hexValue.isNull()) {
-        throw JSONRPCError(RPC_WALLET_ERROR, "Missing hex data for signed transaction");
-    }
-    std::string signedtxn = hexValue.get_str();
-
-    // Send the signed transaction
-    if (!testmode) {
-        params.clear();
-        params.setArray();
-        params.push_back(signedtxn);
-        UniValue sendResultValue = sendrawtransaction(params, false);
-        if (sendResultValue.isNull()) {
-            throw JSONRPCError(RPC_WALLET_ERROR, "Send raw transaction did not return an error or a txid.");
-        }
-
-        std::string txid = sendResultValue.get_str();
-
-        UniValue o(UniValue::VOBJ);
-        o.push_back(Pair("txid", txid));
-        set_result(o);
-    } else {
-        // Test mode does not send the transaction to the network.
-
-        CDataStream stream(ParseHex(signedtxn), SER_NETWORK, PROTOCOL_VERSION);
-        CTransaction tx;
-        stream >> tx;
-
-        UniValue o(UniValue::VOBJ);
-        o.push_back(Pair("test", 1));
-        o.push_back(Pair("txid", tx.GetHash().ToString()));
-        o.push_back(Pair("hex", signedtxn));
-        set_result(o);
-    }
+void AsyncRPCOperation_sendmany::sign_send_transaction(const CTransaction& tx)
+{
+    CMutableTransaction mtx(tx);
+    SignTransparentInputs(mtx);
 
     // Keep the signed transaction so we can hash to the same txid
-    CDataStream stream(ParseHex(signedtxn), SER_NETWORK, PROTOCOL_VERSION);
-    CTransaction tx;
-    stream >> tx;
-    tx_ = tx;
+    tx_ = CTransaction(mtx);
+    set_result(SendTransaction(tx_, testmode));
 }
 
 
@@ -930,7 +883,9 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
             FormatMoney(info.vjsout[0].value), FormatMoney(info.vjsout[1].value)
             );
 
-    // Generate the proof, this can take over a minute.
+    // Set up the JoinSplit; its proof, which can take over a minute, is
+    // computed concurrently with the following JoinSplits, as these only
+    // need its notes and commitments.
     boost::array<libzcash::JSInput, ZC_NUM_JS_INPUTS> inputs
             {info.vjsin[0], info.vjsin[1]};
     boost::array<libzcash::JSOutput, ZC_NUM_JS_OUTPUTS> outputs
@@ -942,6 +897,7 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
     boost::array<size_t, ZC_NUM_JS_INPUTS> inputMap;
     boost::array<size_t, ZC_NUM_JS_OUTPUTS> outputMap;
     #endif
+    JSProofWitness witness;
     JSDescription jsdesc = JSDescription::Randomized(
             *pzcashParams,
             joinSplitPubKey_,
@@ -952,40 +908,16 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
             outputMap,
             info.vpub_old,
             info.vpub_new,
-            !this->testmode);
+            false,
+            GetRandInt,
+            this->testmode ? NULL : &witness);
 
-    {
-        auto verifier = libzcash::ProofVerifier::Strict();
-        if (!(jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
-            throw std::runtime_error("error verifying joinsplit");
-        }
+    if (!this->testmode) {
+        start_proof(mtx.vjoinsplit.size(), jsdesc, witness);
     }
 
     mtx.vjoinsplit.push_back(jsdesc);
 
-    // Empty output script.
-    CScript scriptCode;
-    CTransaction signTx(mtx);
-    uint256 dataToBeSigned = SignatureHash(scriptCode, signTx, NOT_AN_INPUT, SIGHASH_ALL);
-
-    // Add the signature
-    if (!(crypto_sign_detached(&mtx.joinSplitSig[0], NULL,
-            dataToBeSigned.begin(), 32,
-            joinSplitPrivKey_
-            ) == 0))
-    {
-        throw std::runtime_error("crypto_sign_detached failed");
-    }
-
-    // Sanity check
-    if (!(crypto_sign_verify_detached(&mtx.joinSplitSig[0],
-            dataToBeSigned.begin(), 32,
-            mtx.joinSplitPubKey.begin()
-            ) == 0))
-    {
-        throw std::runtime_error("crypto_sign_verify_detached failed");
-    }
-
     CTransaction rawTx(mtx);
     tx_ = rawTx;
 
@@ -1031,6 +963,86 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
     return obj;
 }
 
+static CSemaphore& GetJoinSplitProofSemaphore()
+{
+    static CSemaphore semaphore(std::max(1, nJoinSplitThreads));
+    return semaphore;
+}
+
+void AsyncRPCOperation_sendmany::start_proof(size_t index, const JSDescription& jsdesc, const JSProofWitness& witness)
+{
+    assert(index == proofs_.size());
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        proofTimes_.push_back(-1);
+    }
+
+    std::string id = getId();
+    proofs_.push_back(std::async(std::launch::async, [this, index, jsdesc, witness, id]() {
+        // At most -joinsplitthreads proofs are computed at once, over all operations
+        CSemaphoreGrant grant(GetJoinSplitProofSemaphore());
+        int64_t nTimeStart = GetTimeMicros();
+
+        JSDescription proved(jsdesc);
+        proved.Prove(*pzcashParams, witness);
+
+        double seconds = (GetTimeMicros() - nTimeStart) * 0.000001;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            proofTimes_[index] = seconds;
+        }
+        LogPrint("zrpcunsafe", "%s: computed proof of joinsplit %d in %.2fs\n", id, index, seconds);
+        return proved.proof;
+    }));
+}
+
+/**
+ * Wait for the proofs of the transaction's JoinSplits, verify them and sign
+ * the JoinSplits into tx_.
+ */
+void AsyncRPCOperation_sendmany::complete_joinsplits()
+{
+    CMutableTransaction mtx(tx_);
+    assert(proofs_.size() == 0 || proofs_.size() == mtx.vjoinsplit.size());
+    for (size_t i = 0; i < proofs_.size(); i++) {
+        mtx.vjoinsplit[i].proof = proofs_[i].get();
+    }
+    proofs_.clear();
+
+    auto verifier = libzcash::ProofVerifier::Strict();
+    for (const JSDescription& jsdesc : mtx.vjoinsplit) {
+        if (!(jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
+            throw std::runtime_error("error verifying joinsplit");
+        }
+    }
+
+    // Empty output script.
+    CScript scriptCode;
+    CTransaction signTx(mtx);
+    uint256 dataToBeSigned = SignatureHash(scriptCode, signTx, NOT_AN_INPUT, SIGHASH_ALL);
+
+    // Add the signature
+    if (!(crypto_sign_detached(&mtx.joinSplitSig[0], NULL,
+            dataToBeSigned.begin(), 32,
+            joinSplitPrivKey_
+            ) == 0))
+    {
+        throw std::runtime_error("crypto_sign_detached failed");
+    }
+
+    // Sanity check
+    if (!(crypto_sign_verify_detached(&mtx.joinSplitSig[0],
+            dataToBeSigned.begin(), 32,
+            mtx.joinSplitPubKey.begin()
+            ) == 0))
+    {
+        throw std::runtime_error("crypto_sign_verify_detached failed");
+    }
+
+    CTransaction rawTx(mtx);
+    tx_ = rawTx;
+}
+
 void AsyncRPCOperation_sendmany::add_taddr_outputs_to_tx() {
 
     CMutableTransaction rawTx(tx_);
@@ -1100,11 +1112,32 @@ boost::array<unsigned char, ZC_MEMO_SIZE> AsyncRPCOperation_sendmany::get_memo_f
  */
 UniValue AsyncRPCOperation_sendmany::getStatus() const {
     UniValue v = AsyncRPCOperation::getStatus();
+    UniValue obj = v.get_obj();
+
+    // Time each JoinSplit proof took, or pending
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (!proofTimes_.empty()) {
+            UniValue arr(UniValue::VARR);
+            for (size_t i = 0; i < proofTimes_.size(); i++) {
+                UniValue proof(UniValue::VOBJ);
+                proof.push_back(Pair("joinsplit", (int)i));
+                if (proofTimes_[i] < 0) {
+                    proof.push_back(Pair("status", "pending"));
+                } else {
+                    proof.push_back(Pair("status", "done"));
+                    proof.push_back(Pair("seconds", proofTimes_[i]));
+                }
+                arr.push_back(proof);
+            }
+            obj.push_back(Pair("proofs", arr));
+        }
+    }
+
     if (contextinfo_.isNull()) {
-        return v;
+        return obj;
     }
 
-    UniValue obj = v.get_obj();
     obj.push_back(Pair("method", "z_sendmany"));
     obj.push_back(Pair("params", contextinfo_ ));
     return obj;
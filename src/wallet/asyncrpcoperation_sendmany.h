@@ -13,6 +13,7 @@
 #include "zcash/Address.hpp"
 #include "wallet.h"
 
+#include <future>
 #include <unordered_map>
 #include <tuple>
 
@@ -91,7 +92,12 @@ private:
     std::vector<SendManyInputJSOP> z_inputs_;
     
     CTransaction tx_;
-   
+
+    // Proofs of the JoinSplits of tx_ being computed, in JoinSplit order
+    std::vector<std::future<libzcash::ZCProof>> proofs_;
+    // Seconds each of these proofs took, -1 while pending (guarded by lock_)
+    std::vector<double> proofTimes_;
+
     void add_taddr_change_output_to_tx(CAmount amount);
     void add_taddr_outputs_to_tx();
     bool find_unspent_notes();
@@ -111,7 +117,13 @@ private:
         std::vector<boost::optional < ZCIncrementalWitness>> witnesses,
         uint256 anchor);
 
-    void sign_send_raw_transaction(UniValue obj);     // throws exception if there was an error
+    // Compute the proof of the JoinSplit at index of tx_ on a thread of its own
+    void start_proof(size_t index, const JSDescription& jsdesc, const JSProofWitness& witness);
+
+    // Add the proofs to the JoinSplits and sign them
+    void complete_joinsplits();
+
+    void sign_send_transaction(const CTransaction& tx);     // throws exception if there was an error
 
 };
 
@@ -173,8 +185,12 @@ public:
         return delegate->perform_joinsplit(info, witnesses, anchor);
     }
 
-    void sign_send_raw_transaction(UniValue obj) {
-        delegate->sign_send_raw_transaction(obj);
+    void complete_joinsplits() {
+        delegate->complete_joinsplits();
+    }
+
+    void sign_send_transaction(const CTransaction& tx) {
+        delegate->sign_send_transaction(tx);
     }
     
     void set_state(OperationStatus state) {
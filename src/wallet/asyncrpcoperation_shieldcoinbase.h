@@ -75,7 +75,7 @@ private:
     // JoinSplit without any input notes to spend
     UniValue perform_joinsplit(ShieldCoinbaseJSInfo &);
 
-    void sign_send_raw_transaction(UniValue obj);     // throws exception if there was an error
+    void sign_send_transaction(const CTransaction& tx);     // throws exception if there was an error
 
     void lock_utxos();
 
@@ -108,8 +108,8 @@ public:
         return delegate->perform_joinsplit(info);
     }
 
-    void sign_send_raw_transaction(UniValue obj) {
-        delegate->sign_send_raw_transaction(obj);
+    void sign_send_transaction(const CTransaction& tx) {
+        delegate->sign_send_transaction(tx);
     }
 
     void set_state(OperationStatus state) {
@@ -66,6 +66,11 @@ public:
     void MarkAffectedTransactionsDirty(const CTransaction& tx) {
         CWallet::MarkAffectedTransactionsDirty(tx);
     }
+    void SetRescanning(bool fRescanningIn, int nWitnessHeight) {
+        LOCK(cs_wallet);
+        fRescanning = fRescanningIn;
+        rescanProgress.nWitnessHeight = nWitnessHeight;
+    }
 };
 
 CWalletTx GetValidReceive(const libzcash::SpendingKey& sk, CAmount value, bool randomInputs) {
@@ -379,6 +384,34 @@ TEST(wallet_tests, FindMyNotes) {
     EXPECT_EQ(nd, noteMap[jsoutpt]);
 }
 
+TEST(wallet_tests, FindMyNotesBatch) {
+    CWallet wallet;
+
+    // Enough addresses to split trial decryption into several jobs
+    for (size_t i = 0; i < 2 * NOTE_DECRYPTION_BATCH_ADDRESSES; i++) {
+        wallet.AddSpendingKey(libzcash::SpendingKey::random());
+    }
+    auto sk = libzcash::SpendingKey::random();
+    wallet.AddSpendingKey(sk);
+
+    auto wtx = GetValidReceive(sk, 10, true);
+    auto note = GetNote(sk, wtx, 0, 1);
+    auto nullifier = note.nullifier(sk);
+    auto wtxOther = GetValidReceive(libzcash::SpendingKey::random(), 10, true);
+
+    std::vector<CTransaction> vtx {wtxOther, wtx};
+    auto vNoteMap = wallet.FindMyNotes(vtx);
+    ASSERT_EQ(2, vNoteMap.size());
+    EXPECT_EQ(0, vNoteMap[0].size());
+    EXPECT_EQ(2, vNoteMap[1].size());
+
+    JSOutPoint jsoutpt {wtx.GetHash(), 0, 1};
+    CNoteData nd {sk.address(), nullifier};
+    EXPECT_EQ(1, vNoteMap[1].count(jsoutpt));
+    EXPECT_EQ(nd, vNoteMap[1][jsoutpt]);
+    EXPECT_EQ(vNoteMap[1], wallet.FindMyNotes(wtx));
+}
+
 TEST(wallet_tests, FindMyNotesInEncryptedWallet) {
     TestWallet wallet;
     uint256 r {GetRandHash()};
@@ -734,6 +767,50 @@ TEST(wallet_tests, CachedWitnessesDecrementFirst) {
     }
 }
 
+TEST(wallet_tests, CachedWitnessesDuringRescan) {
+    TestWallet wallet;
+    ZCIncrementalMerkleTree tree;
+
+    auto sk = libzcash::SpendingKey::random();
+    wallet.AddSpendingKey(sk);
+
+    CBlock block1;
+    CBlockIndex index1(block1);
+    index1.nHeight = 1;
+    CreateValidBlock(wallet, sk, index1, block1, tree);
+
+    CBlock block2;
+    CBlockIndex index2(block2);
+    index2.nHeight = 2;
+    auto jsoutpt = CreateValidBlock(wallet, sk, index2, block2, tree);
+    const CNoteData& nd = wallet.mapWallet[jsoutpt.hash].mapNoteData[jsoutpt];
+    EXPECT_EQ(2, nd.witnessHeight);
+    EXPECT_EQ(1, nd.witnesses.size());
+
+    // A rescan is running, the witnesses being at the old tip
+    wallet.SetRescanning(true, 2);
+
+    // Blocks connected meanwhile are left to the rescan...
+    CBlock block3;
+    CBlockIndex index3(block3);
+    index3.nHeight = 3;
+    wallet.ChainTip(&index3, &block3, tree, true);
+    EXPECT_EQ(2, nd.witnessHeight);
+    EXPECT_EQ(1, nd.witnesses.size());
+
+    // ... and so is disconnecting them
+    wallet.ChainTip(&index3, &block3, tree, false);
+    EXPECT_EQ(2, nd.witnessHeight);
+    EXPECT_EQ(1, nd.witnesses.size());
+
+    // Blocks the witnesses were already brought to are still undone
+    wallet.ChainTip(&index2, &block2, tree, false);
+    EXPECT_EQ(1, nd.witnessHeight);
+    EXPECT_EQ(0, nd.witnesses.size());
+
+    wallet.SetRescanning(false, 0);
+}
+
 TEST(wallet_tests, CachedWitnessesCleanIndex) {
     TestWallet wallet;
     std::vector<CBlock> blocks;
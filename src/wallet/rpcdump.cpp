@@ -98,10 +98,6 @@ UniValue importprivkey(const UniValue& params, bool fHelp)
             + HelpExampleRpc("importprivkey", "\"mykey\", \"testing\", false")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
-
-    EnsureWalletIsUnlocked();
-
     string strSecret = params[0].get_str();
     string strLabel = "";
     if (params.size() > 1)
@@ -123,7 +119,12 @@ UniValue importprivkey(const UniValue& params, bool fHelp)
     CPubKey pubkey = key.GetPubKey();
     assert(key.VerifyPubKey(pubkey));
     CKeyID vchAddress = pubkey.GetID();
+    CBlockIndex* pindexRescan = NULL;
     {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+
+        EnsureWalletIsUnlocked();
+
         pwalletMain->MarkDirty();
         pwalletMain->SetAddressBook(vchAddress, strLabel, "receive");
 
@@ -140,11 +141,14 @@ UniValue importprivkey(const UniValue& params, bool fHelp)
         // whenever a key is imported, we need to scan the whole chain
         pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
 
-        if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
-        }
+        if (fRescan)
+            pindexRescan = chainActive.Genesis();
     }
 
+    // Rescan without holding the locks, see ScanForWalletTransactions
+    if (pindexRescan)
+        pwalletMain->ScanForWalletTransactions(pindexRescan, true);
+
     return CBitcoinAddress(vchAddress).ToString();
 }
 
@@ -171,8 +175,6 @@ UniValue importaddress(const UniValue& params, bool fHelp)
             + HelpExampleRpc("importaddress", "\"myaddress\", \"testing\", false")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
-
     CScript script;
 
     CBitcoinAddress address(params[0].get_str());
@@ -194,7 +196,10 @@ UniValue importaddress(const UniValue& params, bool fHelp)
     if (params.size() > 2)
         fRescan = params[2].get_bool();
 
+    CBlockIndex* pindexRescan = NULL;
     {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+
         if (::IsMine(*pwalletMain, script) == ISMINE_SPENDABLE)
             throw JSONRPCError(RPC_WALLET_ERROR, "The wallet already contains the private key for this address or script");
 
@@ -212,10 +217,14 @@ UniValue importaddress(const UniValue& params, bool fHelp)
             throw JSONRPCError(RPC_WALLET_ERROR, "Error adding address to wallet");
 
         if (fRescan)
-        {
-            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
-            pwalletMain->ReacceptWalletTransactions();
-        }
+            pindexRescan = chainActive.Genesis();
+    }
+
+    // Rescan without holding the locks, see ScanForWalletTransactions
+    if (pindexRescan)
+    {
+        pwalletMain->ScanForWalletTransactions(pindexRescan, true);
+        pwalletMain->ReacceptWalletTransactions();
     }
 
     return NullUniValue;
@@ -267,7 +276,12 @@ UniValue importwallet(const UniValue& params, bool fHelp)
 	return importwallet_impl(params, fHelp, false);
 }
 
-UniValue importwallet_impl(const UniValue& params, bool fHelp, bool fImportZKeys)
+/**
+ * Imports the keys of a wallet dump and returns where the rescan for them
+ * has to start. Leaves the rescan itself to importwallet_impl, which runs
+ * it without holding cs_main and cs_wallet.
+ */
+static bool ImportWalletKeys(const UniValue& params, bool fImportZKeys, CBlockIndex*& pindexRescan)
 {
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
@@ -372,7 +386,16 @@ UniValue importwallet_impl(const UniValue& params, bool fHelp, bool fImportZKeys
         pwalletMain->nTimeFirstKey = nTimeBegin;
 
     LogPrintf("Rescanning last %i blocks\n", chainActive.Height() - pindex->nHeight + 1);
-    pwalletMain->ScanForWalletTransactions(pindex);
+    pindexRescan = pindex;
+    return fGood;
+}
+
+UniValue importwallet_impl(const UniValue& params, bool fHelp, bool fImportZKeys)
+{
+    CBlockIndex* pindexRescan = NULL;
+    bool fGood = ImportWalletKeys(params, fImportZKeys, pindexRescan);
+
+    pwalletMain->ScanForWalletTransactions(pindexRescan);
     pwalletMain->MarkDirty();
 
     if (!fGood)
@@ -575,10 +598,6 @@ UniValue z_importkey(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_importkey", "\"mykey\", \"no\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
-
-    EnsureWalletIsUnlocked();
-
     // Whether to perform rescan after import
     bool fRescan = true;
     bool fIgnoreExistingKey = true;
@@ -608,16 +627,22 @@ UniValue z_importkey(const UniValue& params, bool fHelp)
     int nRescanHeight = 0;
     if (params.size() > 2)
         nRescanHeight = params[2].get_int();
-    if (nRescanHeight < 0 || nRescanHeight > chainActive.Height()) {
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
-    }
 
     string strSecret = params[0].get_str();
     CZCSpendingKey spendingkey(strSecret);
     auto key = spendingkey.Get();
     auto addr = key.address();
 
+    CBlockIndex* pindexRescan = NULL;
     {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+
+        EnsureWalletIsUnlocked();
+
+        if (nRescanHeight < 0 || nRescanHeight > chainActive.Height()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        }
+
         // Don't throw error in case a key is already there
         if (pwalletMain->HaveSpendingKey(addr)) {
             if (fIgnoreExistingKey) {
@@ -637,10 +662,14 @@ UniValue z_importkey(const UniValue& params, bool fHelp)
 
         // We want to scan for transactions and notes
         if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive[nRescanHeight], true);
+            pindexRescan = chainActive[nRescanHeight];
         }
     }
 
+    // Rescan without holding the locks, see ScanForWalletTransactions
+    if (pindexRescan)
+        pwalletMain->ScanForWalletTransactions(pindexRescan, true);
+
     return NullUniValue;
 }
 
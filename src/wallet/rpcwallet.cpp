@@ -2309,6 +2309,14 @@ UniValue getwalletinfo(const UniValue& params, bool fHelp)
             "  \"keypoolsize\": xxxx,        (numeric) how many new keys are pre-generated\n"
             "  \"unlocked_until\": ttt,      (numeric) the timestamp in seconds since epoch (midnight Jan 1 1970 GMT) that the wallet is unlocked for transfers, or 0 if the wallet is locked\n"
             "  \"paytxfee\": x.xxxx,         (numeric) the transaction fee configuration, set in ZEC/KB\n"
+            "  \"rescanning\": true|false,   (boolean) whether a wallet rescan is in progress\n"
+            "  \"rescan\": {                 (object, only while rescanning) progress of the rescan\n"
+            "    \"startheight\": n,         (numeric) the height the rescan started at\n"
+            "    \"height\": n,              (numeric) the height of the last block rescanned\n"
+            "    \"tipheight\": n,           (numeric) the height the rescan is catching up with\n"
+            "    \"progress\": x.xxx,        (numeric) the rescanned fraction of the blocks, between 0 and 1\n"
+            "    \"blockspersecond\": x.xx,  (numeric) the rescan throughput\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getwalletinfo", "")
@@ -2328,6 +2336,18 @@ UniValue getwalletinfo(const UniValue& params, bool fHelp)
     if (pwalletMain->IsCrypted())
         obj.push_back(Pair("unlocked_until", nWalletUnlockTime));
     obj.push_back(Pair("paytxfee",      ValueFromAmount(payTxFee.GetFeePerK())));
+    CRescanProgress progress;
+    bool fRescanning = pwalletMain->GetRescanProgress(progress);
+    obj.push_back(Pair("rescanning",    fRescanning));
+    if (fRescanning) {
+        UniValue rescan(UniValue::VOBJ);
+        rescan.push_back(Pair("startheight", progress.nStartHeight));
+        rescan.push_back(Pair("height", progress.nHeight));
+        rescan.push_back(Pair("tipheight", progress.nTipHeight));
+        rescan.push_back(Pair("progress", progress.Progress()));
+        rescan.push_back(Pair("blockspersecond", progress.BlocksPerSecond()));
+        obj.push_back(Pair("rescan", rescan));
+    }
     return obj;
 }
 
@@ -2575,6 +2595,19 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             "  }\n"
             "  ...\n"
             "]\n"
+            "\n"
+            "The sha256 (one stream) and sha256d64 (batched 64-byte blobs) types\n"
+            "use the implementation selected at startup, and also report its\n"
+            "\"bytespersecond\".\n"
+            "\n"
+            "The coinscache type takes an optional number of cached transactions\n"
+            "(default 1000000) and also reports how many fit in a GiB of -dbcache\n"
+            "(\"entriespergb\") and the inputs looked up and spent per second\n"
+            "(\"inputspersecond\").\n"
+            "\n"
+            "The parseblock type takes an optional number of transactions (default\n"
+            "2000) and of JoinSplits per transaction (default 1), and also reports\n"
+            "the transactions deserialized and hashed per second (\"txpersecond\").\n"
             );
     }
 
@@ -2588,6 +2621,8 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
     }
 
     std::vector<double> sample_times;
+    // Per-sample figures reported besides the running time, by some types
+    std::vector<std::pair<double, UniValue> > sample_results;
 
     if (benchmarktype == "createjoinsplit") {
         /* Load the proving now key so that it doesn't happen as part of the
@@ -2597,7 +2632,7 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
 
     JSDescription samplejoinsplit;
 
-    if (benchmarktype == "verifyjoinsplit") {
+    if (benchmarktype == "verifyjoinsplit" || benchmarktype == "verifyblock") {
         CDataStream ss(ParseHexV(params[2].get_str(), "js"), SER_NETWORK, PROTOCOL_VERSION);
         ss >> samplejoinsplit;
     }
@@ -2619,6 +2654,9 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             }
         } else if (benchmarktype == "verifyjoinsplit") {
             sample_times.push_back(benchmark_verify_joinsplit(samplejoinsplit));
+        } else if (benchmarktype == "verifyblock") {
+            int nJoinSplits = params.size() > 3 ? params[3].get_int() : 100;
+            sample_times.push_back(benchmark_verify_block_joinsplits(samplejoinsplit, nJoinSplits));
 #ifdef ENABLE_MINING
         } else if (benchmarktype == "solveequihash") {
             if (params.size() < 3) {
@@ -2631,11 +2669,44 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
 #endif
         } else if (benchmarktype == "verifyequihash") {
             sample_times.push_back(benchmark_verify_equihash());
+        } else if (benchmarktype == "sha256" || benchmarktype == "sha256d64") {
+            double time = benchmark_sha256(benchmarktype == "sha256d64");
+            UniValue result(UniValue::VOBJ);
+            result.push_back(Pair("bytespersecond", SHA256_BENCHMARK_BYTES / time));
+            sample_results.push_back(std::make_pair(time, result));
+        } else if (benchmarktype == "coinscache") {
+            int nEntries = params.size() > 2 ? params[2].get_int() : 1000000;
+            if (nEntries <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of entries");
+            }
+            size_t nUsage = 0;
+            double time = benchmark_coins_cache(nEntries, nUsage);
+            UniValue result(UniValue::VOBJ);
+            result.push_back(Pair("entriespergb", (uint64_t)(nEntries * (double)(1 << 30) / nUsage)));
+            result.push_back(Pair("inputspersecond", nEntries / time));
+            sample_results.push_back(std::make_pair(time, result));
+        } else if (benchmarktype == "parseblock") {
+            int nTxs = params.size() > 2 ? params[2].get_int() : 2000;
+            int nJoinSplits = params.size() > 3 ? params[3].get_int() : 1;
+            if (nTxs <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of transactions");
+            }
+            if (nJoinSplits < 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of JoinSplits");
+            }
+            double time = benchmark_parse_block(nTxs, nJoinSplits);
+            UniValue result(UniValue::VOBJ);
+            result.push_back(Pair("txpersecond", nTxs / time));
+            sample_results.push_back(std::make_pair(time, result));
         } else if (benchmarktype == "validatelargetx") {
             sample_times.push_back(benchmark_large_tx());
         } else if (benchmarktype == "trydecryptnotes") {
             int nAddrs = params[2].get_int();
             sample_times.push_back(benchmark_try_decrypt_notes(nAddrs));
+        } else if (benchmarktype == "trydecryptblocknotes") {
+            int nAddrs = params[2].get_int();
+            int nTxs = params.size() > 3 ? params[3].get_int() : 10;
+            sample_times.push_back(benchmark_try_decrypt_block_notes(nAddrs, nTxs));
         } else if (benchmarktype == "incnotewitnesses") {
             int nTxs = params[2].get_int();
             sample_times.push_back(benchmark_increment_note_witnesses(nTxs));
@@ -2650,6 +2721,12 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
         result.push_back(Pair("runningtime", time));
         results.push_back(result);
     }
+    for (const auto& sample : sample_results) {
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("runningtime", sample.first));
+        result.pushKVs(sample.second);
+        results.push_back(result);
+    }
 
     return results;
 }
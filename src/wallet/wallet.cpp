@@ -19,8 +19,11 @@
 #include "zcash/Note.hpp"
 #include "crypter.h"
 #include "chainparams.h"
+#include "checkqueue.h"
 
 #include <assert.h>
+#include <deque>
+#include <memory>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
@@ -38,6 +41,76 @@ unsigned int nTxConfirmTarget = DEFAULT_TX_CONFIRM_TARGET;
 bool bSpendZeroConfChange = true;
 bool fSendFreeTransactions = false;
 bool fPayAtLeastCustomFee = true;
+int nJoinSplitThreads = DEFAULT_JOINSPLIT_THREADS;
+
+/**
+ * One ciphertext to trial-decrypt, and where it came from.
+ */
+struct CNoteTrial
+{
+    const JSDescription* jsdesc;
+    uint256 hSig;
+    size_t nTx;
+    size_t nJoinSplit;
+    uint8_t n;
+};
+
+/**
+ * Closure trying a range of note decryptors against every ciphertext of a
+ * batch. Matches are reported as (trial index, decryptor index) pairs.
+ */
+class CNoteDecryptionCheck
+{
+private:
+    const std::vector<const NoteDecryptorMap::value_type*>* pvDecryptors;
+    const std::vector<CNoteTrial>* pvTrials;
+    size_t nBegin;
+    size_t nEnd;
+    std::vector<std::pair<size_t, size_t> >* pvMatches;
+
+public:
+    CNoteDecryptionCheck() : pvDecryptors(NULL), pvTrials(NULL), nBegin(0), nEnd(0), pvMatches(NULL) {}
+    CNoteDecryptionCheck(const std::vector<const NoteDecryptorMap::value_type*>& vDecryptors,
+                         const std::vector<CNoteTrial>& vTrials,
+                         size_t nBeginIn, size_t nEndIn,
+                         std::vector<std::pair<size_t, size_t> >& vMatches) :
+        pvDecryptors(&vDecryptors), pvTrials(&vTrials), nBegin(nBeginIn), nEnd(nEndIn), pvMatches(&vMatches) { }
+
+    bool operator()() {
+        ZCNoteDecryption::Plaintext plaintext;
+        for (size_t d = nBegin; d < nEnd; d++) {
+            const ZCNoteDecryption& dec = (*pvDecryptors)[d]->second;
+            for (size_t t = 0; t < pvTrials->size(); t++) {
+                const CNoteTrial& trial = (*pvTrials)[t];
+                if (dec.try_decrypt(trial.jsdesc->ciphertexts[trial.n],
+                                    trial.jsdesc->ephemeralKey,
+                                    trial.hSig,
+                                    trial.n,
+                                    plaintext)) {
+                    pvMatches->push_back(std::make_pair(t, d));
+                }
+            }
+        }
+        return true;
+    }
+
+    void swap(CNoteDecryptionCheck& check) {
+        std::swap(pvDecryptors, check.pvDecryptors);
+        std::swap(pvTrials, check.pvTrials);
+        std::swap(nBegin, check.nBegin);
+        std::swap(nEnd, check.nEnd);
+        std::swap(pvMatches, check.pvMatches);
+    }
+};
+
+static CCheckQueue<CNoteDecryptionCheck> notedecryptionqueue(1);
+//! Guards notedecryptionqueue, which serves one batch at a time
+static CCriticalSection cs_NoteDecryptionQueue;
+
+void ThreadNoteDecryption() {
+    RenameThread("zcash-notedec");
+    notedecryptionqueue.Thread();
+}
 
 /**
  * Fees smaller than this (in satoshi) are considered zero fee (for transaction creation)
@@ -371,6 +444,15 @@ bool CWallet::ChangeWalletPassphrase(const SecureString& strOldWalletPassphrase,
 void CWallet::ChainTip(const CBlockIndex *pindex, const CBlock *pblock,
                        ZCIncrementalMerkleTree tree, bool added)
 {
+    LOCK(cs_wallet);
+    if (fRescanning) {
+        // A running rescan walks up to the current tip by itself, so new
+        // blocks are left to it. Blocks the witnesses were already brought
+        // to still have to be undone here.
+        if (added || pindex->nHeight > rescanProgress.nWitnessHeight)
+            return;
+        rescanProgress.nWitnessHeight = pindex->nHeight - 1;
+    }
     if (added) {
         IncrementNoteWitnesses(pindex, pblock, tree);
     } else {
@@ -380,6 +462,13 @@ void CWallet::ChainTip(const CBlockIndex *pindex, const CBlock *pblock,
 
 void CWallet::SetBestChain(const CBlockLocator& loc)
 {
+    LOCK(cs_wallet);
+    if (fRescanning) {
+        // The witness cache is not in sync with loc until the rescan
+        // completes, which writes it out then
+        fRescanBestChainPending = true;
+        return;
+    }
     CWalletDB walletdb(strWalletFile);
     SetBestChainINTERNAL(walletdb, loc);
 }
@@ -643,6 +732,12 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
 {
     {
         LOCK(cs_wallet);
+        // Notes whose witnesses are behind the current height, and the subset
+        // of those that actually carry a witness. Both are gathered in a
+        // single pass over the wallet, so that each note commitment below
+        // only touches the live witnesses instead of every note we hold.
+        std::vector<CNoteData*> vBehind;
+        std::vector<CNoteData*> vWitnessed;
         for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
             for (mapNoteData_t::value_type& item : wtxItem.second.mapNoteData) {
                 CNoteData* nd = &(item.second);
@@ -665,6 +760,10 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                     if (nd->witnesses.size() > WITNESS_CACHE_SIZE) {
                         nd->witnesses.pop_back();
                     }
+                    vBehind.push_back(nd);
+                    if (nd->witnesses.size() > 0) {
+                        vWitnessed.push_back(nd);
+                    }
                 }
             }
         }
@@ -681,7 +780,8 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
 
         for (const CTransaction& tx : pblock->vtx) {
             auto hash = tx.GetHash();
-            bool txIsOurs = mapWallet.count(hash);
+            auto wtxIt = mapWallet.find(hash);
+            bool txIsOurs = wtxIt != mapWallet.end();
             for (size_t i = 0; i < tx.vjoinsplit.size(); i++) {
                 const JSDescription& jsdesc = tx.vjoinsplit[i];
                 for (uint8_t j = 0; j < jsdesc.commitments.size(); j++) {
@@ -689,25 +789,17 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                     tree.append(note_commitment);
 
                     // Increment existing witnesses
-                    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                        for (mapNoteData_t::value_type& item : wtxItem.second.mapNoteData) {
-                            CNoteData* nd = &(item.second);
-                            if (nd->witnessHeight < pindex->nHeight &&
-                                    nd->witnesses.size() > 0) {
-                                // Check the validity of the cache
-                                // See earlier comment about validity.
-                                assert(nWitnessCacheSize >= nd->witnesses.size());
-                                nd->witnesses.front().append(note_commitment);
-                            }
-                        }
+                    for (CNoteData* nd : vWitnessed) {
+                        nd->witnesses.front().append(note_commitment);
                     }
 
                     // If this is our note, witness it
                     if (txIsOurs) {
                         JSOutPoint jsoutpt {hash, i, j};
-                        if (mapWallet[hash].mapNoteData.count(jsoutpt) &&
-                                mapWallet[hash].mapNoteData[jsoutpt].witnessHeight < pindex->nHeight) {
-                            CNoteData* nd = &(mapWallet[hash].mapNoteData[jsoutpt]);
+                        auto ndIt = wtxIt->second.mapNoteData.find(jsoutpt);
+                        if (ndIt != wtxIt->second.mapNoteData.end() &&
+                                ndIt->second.witnessHeight < pindex->nHeight) {
+                            CNoteData* nd = &(ndIt->second);
                             if (nd->witnesses.size() > 0) {
                                 // We think this can happen because we write out the
                                 // witness cache state after every block increment or
@@ -724,6 +816,9 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                                           pindex->nHeight,
                                           tree.witness().root().GetHex());
                                 nd->witnesses.clear();
+                            } else {
+                                // Already in vWitnessed otherwise
+                                vWitnessed.push_back(nd);
                             }
                             nd->witnesses.push_front(tree.witness());
                             // Set height to one less than pindex so it gets incremented
@@ -737,16 +832,11 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
         }
 
         // Update witness heights
-        for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-            for (mapNoteData_t::value_type& item : wtxItem.second.mapNoteData) {
-                CNoteData* nd = &(item.second);
-                if (nd->witnessHeight < pindex->nHeight) {
-                    nd->witnessHeight = pindex->nHeight;
-                    // Check the validity of the cache
-                    // See earlier comment about validity.
-                    assert(nWitnessCacheSize >= nd->witnesses.size());
-                }
-            }
+        for (CNoteData* nd : vBehind) {
+            nd->witnessHeight = pindex->nHeight;
+            // Check the validity of the cache
+            // See earlier comment about validity.
+            assert(nWitnessCacheSize >= nd->witnesses.size());
         }
 
         // For performance reasons, we write out the witness cache in
@@ -762,6 +852,12 @@ void CWallet::DecrementNoteWitnesses(const CBlockIndex* pindex)
         for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
             for (mapNoteData_t::value_type& item : wtxItem.second.mapNoteData) {
                 CNoteData* nd = &(item.second);
+                // While rescanning, notes the rescan has not yet brought up
+                // to this block are left for it to catch up (see ChainTip)
+                if (fRescanning && nd->witnessHeight != -1 &&
+                        nd->witnessHeight < pindex->nHeight) {
+                    continue;
+                }
                 // Only increment witnesses that are not above the current height
                 if (nd->witnessHeight <= pindex->nHeight) {
                     // Check the validity of the cache
@@ -794,8 +890,9 @@ void CWallet::DecrementNoteWitnesses(const CBlockIndex* pindex)
                 // again.
                 // We don't set nWitnessCacheSize to zero at the start of the
                 // reindex because the on-disk blocks had already resulted in a
-                // chain that didn't trigger the assertion below.
-                if (nd->witnessHeight < pindex->nHeight) {
+                // chain that didn't trigger the assertion below. The same
+                // holds for notes a running rescan is still catching up.
+                if (!fRescanning && nd->witnessHeight < pindex->nHeight) {
                     assert(nWitnessCacheSize >= nd->witnesses.size());
                 }
             }
@@ -1143,13 +1240,13 @@ bool CWallet::UpdatedNoteData(const CWalletTx& wtxIn, CWalletTx& wtx)
  * pblock is optional, but should be provided if the transaction is known to be in a block.
  * If fUpdate is true, existing transactions will be updated.
  */
-bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate)
+bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, const mapNoteData_t* pnoteData)
 {
     {
         AssertLockHeld(cs_wallet);
         bool fExisted = mapWallet.count(tx.GetHash()) != 0;
         if (fExisted && !fUpdate) return false;
-        auto noteData = FindMyNotes(tx);
+        auto noteData = pnoteData ? *pnoteData : FindMyNotes(tx);
         if (fExisted || IsMine(tx) || IsFromMe(tx) || noteData.size() > 0)
         {
             CWalletTx wtx(this,tx);
@@ -1249,42 +1346,111 @@ boost::optional<uint256> CWallet::GetNoteNullifier(const JSDescription& jsdesc,
  * already have been cached in CWalletTx.mapNoteData.
  */
 mapNoteData_t CWallet::FindMyNotes(const CTransaction& tx) const
+{
+    return FindMyNotes(std::vector<const CTransaction*>(1, &tx))[0];
+}
+
+std::vector<mapNoteData_t> CWallet::FindMyNotes(const std::vector<CTransaction>& vtx) const
+{
+    std::vector<const CTransaction*> vptx;
+    vptx.reserve(vtx.size());
+    for (const CTransaction& tx : vtx) {
+        vptx.push_back(&tx);
+    }
+    return FindMyNotes(vptx);
+}
+
+/**
+ * Batch version of FindMyNotes, for all the transactions of e.g. a block.
+ *
+ * Trial decryption is spread over the note decryption threads, each job
+ * trying NOTE_DECRYPTION_BATCH_ADDRESSES of our addresses against every
+ * ciphertext of the batch. Failed attempts do not throw.
+ */
+std::vector<mapNoteData_t> CWallet::FindMyNotes(const std::vector<const CTransaction*>& vtx) const
 {
     LOCK(cs_SpendingKeyStore);
-    uint256 hash = tx.GetHash();
-
-    mapNoteData_t noteData;
-    for (size_t i = 0; i < tx.vjoinsplit.size(); i++) {
-        auto hSig = tx.vjoinsplit[i].h_sig(*pzcashParams, tx.joinSplitPubKey);
-        for (uint8_t j = 0; j < tx.vjoinsplit[i].ciphertexts.size(); j++) {
-            for (const NoteDecryptorMap::value_type& item : mapNoteDecryptors) {
-                try {
-                    auto address = item.first;
-                    JSOutPoint jsoutpt {hash, i, j};
-                    auto nullifier = GetNoteNullifier(
-                        tx.vjoinsplit[i],
-                        address,
-                        item.second,
-                        hSig, j);
-                    if (nullifier) {
-                        CNoteData nd {address, *nullifier};
-                        noteData.insert(std::make_pair(jsoutpt, nd));
-                    } else {
-                        CNoteData nd {address};
-                        noteData.insert(std::make_pair(jsoutpt, nd));
-                    }
-                    break;
-                } catch (const note_decryption_failed &err) {
-                    // Couldn't decrypt with this decryptor
-                } catch (const std::exception &exc) {
-                    // Unexpected failure
-                    LogPrintf("FindMyNotes(): Unexpected error while testing decrypt:\n");
-                    LogPrintf("%s\n", exc.what());
-                }
+
+    std::vector<mapNoteData_t> vNoteData(vtx.size());
+
+    std::vector<CNoteTrial> vTrials;
+    for (size_t nTx = 0; nTx < vtx.size(); nTx++) {
+        const CTransaction& tx = *vtx[nTx];
+        for (size_t i = 0; i < tx.vjoinsplit.size(); i++) {
+            auto hSig = tx.vjoinsplit[i].h_sig(*pzcashParams, tx.joinSplitPubKey);
+            for (uint8_t j = 0; j < tx.vjoinsplit[i].ciphertexts.size(); j++) {
+                vTrials.push_back(CNoteTrial {&tx.vjoinsplit[i], hSig, nTx, i, j});
+            }
+        }
+    }
+    if (vTrials.empty() || mapNoteDecryptors.empty()) {
+        return vNoteData;
+    }
+
+    std::vector<const NoteDecryptorMap::value_type*> vDecryptors;
+    vDecryptors.reserve(mapNoteDecryptors.size());
+    for (const NoteDecryptorMap::value_type& item : mapNoteDecryptors) {
+        vDecryptors.push_back(&item);
+    }
+
+    size_t nJobs = (vDecryptors.size() + NOTE_DECRYPTION_BATCH_ADDRESSES - 1) / NOTE_DECRYPTION_BATCH_ADDRESSES;
+    std::vector<std::vector<std::pair<size_t, size_t> > > vJobMatches(nJobs);
+    std::vector<CNoteDecryptionCheck> vChecks;
+    vChecks.reserve(nJobs);
+    for (size_t nJob = 0; nJob < nJobs; nJob++) {
+        size_t nBegin = nJob * NOTE_DECRYPTION_BATCH_ADDRESSES;
+        size_t nEnd = std::min(nBegin + NOTE_DECRYPTION_BATCH_ADDRESSES, vDecryptors.size());
+        vChecks.push_back(CNoteDecryptionCheck(vDecryptors, vTrials, nBegin, nEnd, vJobMatches[nJob]));
+    }
+
+    if (nJobs > 1 && nScriptCheckThreads) {
+        LOCK(cs_NoteDecryptionQueue);
+        CCheckQueueControl<CNoteDecryptionCheck> control(&notedecryptionqueue);
+        control.Add(vChecks);
+        control.Wait();
+    } else {
+        for (CNoteDecryptionCheck& check : vChecks) {
+            check();
+        }
+    }
+
+    // As before, the first of our addresses (in map order) that can
+    // decrypt a ciphertext owns the note.
+    std::vector<size_t> vOwner(vTrials.size(), vDecryptors.size());
+    for (const std::vector<std::pair<size_t, size_t> >& vMatches : vJobMatches) {
+        for (const std::pair<size_t, size_t>& match : vMatches) {
+            vOwner[match.first] = std::min(vOwner[match.first], match.second);
+        }
+    }
+
+    for (size_t t = 0; t < vTrials.size(); t++) {
+        if (vOwner[t] == vDecryptors.size()) {
+            continue;
+        }
+        const CNoteTrial& trial = vTrials[t];
+        const NoteDecryptorMap::value_type& item = *vDecryptors[vOwner[t]];
+        try {
+            auto address = item.first;
+            JSOutPoint jsoutpt {vtx[trial.nTx]->GetHash(), trial.nJoinSplit, trial.n};
+            auto nullifier = GetNoteNullifier(
+                *trial.jsdesc,
+                address,
+                item.second,
+                trial.hSig, trial.n);
+            if (nullifier) {
+                CNoteData nd {address, *nullifier};
+                vNoteData[trial.nTx].insert(std::make_pair(jsoutpt, nd));
+            } else {
+                CNoteData nd {address};
+                vNoteData[trial.nTx].insert(std::make_pair(jsoutpt, nd));
             }
+        } catch (const std::exception &exc) {
+            // Unexpected failure
+            LogPrintf("FindMyNotes(): Unexpected error while testing decrypt:\n");
+            LogPrintf("%s\n", exc.what());
         }
     }
-    return noteData;
+    return vNoteData;
 }
 
 bool CWallet::IsFromMe(const uint256& nullifier) const
@@ -1739,10 +1905,114 @@ void CWallet::WitnessNoteCommitment(std::vector<uint256> commitments,
     }
 }
 
+double CRescanProgress::Progress() const
+{
+    if (nTipHeight <= nStartHeight)
+        return 1.0;
+    return std::max(0.0, std::min(1.0, (double)(nHeight - nStartHeight + 1) / (nTipHeight - nStartHeight + 1)));
+}
+
+double CRescanProgress::BlocksPerSecond() const
+{
+    int64_t nElapsed = GetTimeMillis() - nStartTime;
+    return nElapsed > 0 ? nBlocks * 1000.0 / nElapsed : 0.0;
+}
+
+/**
+ * Read-ahead stage of ScanForWalletTransactions: reads the given blocks
+ * from disk and trial-decrypts their notes on its own thread, staying at
+ * most RESCAN_READ_AHEAD_BLOCKS blocks ahead of the consumer. Needs neither
+ * cs_main nor cs_wallet.
+ */
+class CRescanReader
+{
+public:
+    struct Item
+    {
+        CBlockIndex* pindex;
+        CBlock block;
+        std::vector<mapNoteData_t> vNoteData;
+    };
+
+private:
+    const CWallet& wallet;
+    const std::vector<CBlockIndex*> vIndex;
+    boost::mutex mutex;
+    boost::condition_variable condReady;
+    boost::condition_variable condRoom;
+    std::deque<std::unique_ptr<Item> > queue;
+    size_t nPopped;
+    bool fStop;
+    boost::thread thread;
+
+    void Loop()
+    {
+        RenameThread("zcash-rescan");
+        for (CBlockIndex* pindex : vIndex) {
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (!fStop && queue.size() >= RESCAN_READ_AHEAD_BLOCKS)
+                    condRoom.wait(lock);
+                if (fStop)
+                    return;
+            }
+            std::unique_ptr<Item> item(new Item);
+            item->pindex = pindex;
+            ReadBlockFromDisk(item->block, pindex);
+            // Trial-decrypt the notes of the whole block in one batch
+            item->vNoteData = wallet.FindMyNotes(item->block.vtx);
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                queue.push_back(std::move(item));
+            }
+            condReady.notify_one();
+        }
+    }
+
+public:
+    CRescanReader(const CWallet& walletIn, std::vector<CBlockIndex*>&& vIndexIn) :
+        wallet(walletIn), vIndex(std::move(vIndexIn)), nPopped(0), fStop(false),
+        thread(&CRescanReader::Loop, this) {}
+
+    ~CRescanReader()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            fStop = true;
+        }
+        condRoom.notify_one();
+        thread.join();
+    }
+
+    //! Next block in order, or NULL once all of them were returned
+    std::unique_ptr<Item> Pop()
+    {
+        std::unique_ptr<Item> item;
+        if (nPopped == vIndex.size())
+            return item;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.empty())
+                condReady.wait(lock);
+            item = std::move(queue.front());
+            queue.pop_front();
+        }
+        condRoom.notify_one();
+        nPopped++;
+        return item;
+    }
+};
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
+ *
+ * Blocks are read and trial-decrypted ahead by a CRescanReader, and only
+ * committed to the wallet under cs_main and cs_wallet, one block at a
+ * time, so that the node keeps running during long rescans. Blocks
+ * connected in the meantime are left to the rescan (see ChainTip), which
+ * only returns once it has caught up with the tip.
  */
 int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
@@ -1750,7 +2020,27 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
     int64_t nNow = GetTime();
     const CChainParams& chainParams = Params();
 
+    LOCK(cs_rescan);
+
+    // Clears fRescanning however the rescan ends, so that ChainTip does not
+    // keep deferring to a rescan left by an exception, such as
+    // boost::thread_interrupted at shutdown or a block read error. A pending
+    // best chain is then dropped, since the witnesses were not brought to it.
+    struct CRescanningGuard {
+        CWallet& wallet;
+        CRescanningGuard(CWallet& walletIn) : wallet(walletIn) {}
+        ~CRescanningGuard()
+        {
+            LOCK(wallet.cs_wallet);
+            wallet.fRescanning = false;
+            wallet.fRescanBestChainPending = false;
+        }
+    } rescanningGuard(*this);
+
     CBlockIndex* pindex = pindexStart;
+    std::vector<CBlockIndex*> vIndex;
+    double dProgressStart;
+    double dProgressTip;
     {
         LOCK2(cs_main, cs_wallet);
 
@@ -1760,39 +2050,98 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
             pindex = chainActive.Next(pindex);
 
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
-        double dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
-        while (pindex)
-        {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+        dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
+        dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
 
-            CBlock block;
-            ReadBlockFromDisk(block, pindex);
-            BOOST_FOREACH(CTransaction& tx, block.vtx)
+        for (CBlockIndex* pindexNext = pindex; pindexNext; pindexNext = chainActive.Next(pindexNext))
+            vIndex.push_back(pindexNext);
+
+        fRescanning = true;
+        rescanProgress = CRescanProgress();
+        rescanProgress.nStartHeight = pindex ? pindex->nHeight : chainActive.Height() + 1;
+        rescanProgress.nHeight = rescanProgress.nStartHeight - 1;
+        rescanProgress.nTipHeight = chainActive.Height();
+        rescanProgress.nStartTime = GetTimeMillis();
+        rescanProgress.nWitnessHeight = chainActive.Height();
+    }
+
+    CBlockIndex* pindexLast = NULL;
+    while (true)
+    {
+        {
+            CRescanReader reader(*this, std::move(vIndex));
+            while (std::unique_ptr<CRescanReader::Item> item = reader.Pop())
             {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
-                    ret++;
-            }
+                LOCK2(cs_main, cs_wallet);
+                // Stop at blocks a reorg took off the chain meanwhile, and
+                // resume from the fork below
+                if (!chainActive.Contains(item->pindex))
+                    break;
 
-            ZCIncrementalMerkleTree tree;
-            // This should never fail: we should always be able to get the tree
-            // state on the path to the tip of our chain
-            assert(pcoinsTip->GetAnchorAt(pindex->hashAnchor, tree));
-            // Increment note witness caches
-            IncrementNoteWitnesses(pindex, &block, tree);
+                const CBlock& block = item->block;
+                if (item->pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+                    ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), item->pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
 
-            pindex = chainActive.Next(pindex);
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex));
+                for (size_t i = 0; i < block.vtx.size(); i++)
+                {
+                    if (AddToWalletIfInvolvingMe(block.vtx[i], &block, fUpdate, &item->vNoteData[i]))
+                        ret++;
+                }
+
+                ZCIncrementalMerkleTree tree;
+                // This should never fail: we should always be able to get the tree
+                // state on the path to the tip of our chain
+                assert(pcoinsTip->GetAnchorAt(item->pindex->hashAnchor, tree));
+                // Increment note witness caches
+                IncrementNoteWitnesses(item->pindex, &block, tree);
+
+                pindexLast = item->pindex;
+                rescanProgress.nHeight = pindexLast->nHeight;
+                rescanProgress.nTipHeight = chainActive.Height();
+                rescanProgress.nWitnessHeight = std::max(rescanProgress.nWitnessHeight, pindexLast->nHeight);
+                rescanProgress.nBlocks++;
+
+                if (GetTime() >= nNow + 60) {
+                    nNow = GetTime();
+                    LogPrintf("Still rescanning. At block %d. Progress=%f (%.2f blocks/s)\n", pindexLast->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindexLast), rescanProgress.BlocksPerSecond());
+                }
             }
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+
+        // Catch up with the blocks connected, or reorganized, meanwhile
+        LOCK2(cs_main, cs_wallet);
+        CBlockIndex* pindexNext;
+        if (pindexLast)
+            pindexNext = chainActive.Next(chainActive.FindFork(pindexLast));
+        else
+            pindexNext = pindex ? chainActive[chainActive.FindFork(pindex)->nHeight] : NULL;
+        for (; pindexNext; pindexNext = chainActive.Next(pindexNext))
+            vIndex.push_back(pindexNext);
+        if (vIndex.empty()) {
+            // Still holding the locks, so ChainTip can take over again
+            // without missing a block
+            fRescanning = false;
+            if (fRescanBestChainPending) {
+                fRescanBestChainPending = false;
+                SetBestChain(chainActive.GetLocator());
+            }
+            LogPrintf("Rescanned %d blocks in %dms (%.2f blocks/s)\n", rescanProgress.nBlocks,
+                      GetTimeMillis() - rescanProgress.nStartTime, rescanProgress.BlocksPerSecond());
+            break;
+        }
     }
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     return ret;
 }
 
+bool CWallet::GetRescanProgress(CRescanProgress& progress) const
+{
+    LOCK(cs_wallet);
+    if (fRescanning)
+        progress = rescanProgress;
+    return fRescanning;
+}
+
 void CWallet::ReacceptWalletTransactions()
 {
     // If transactions aren't being broadcasted, don't let them into local mempool either
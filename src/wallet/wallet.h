@@ -42,6 +42,7 @@ extern unsigned int nTxConfirmTarget;
 extern bool bSpendZeroConfChange;
 extern bool fSendFreeTransactions;
 extern bool fPayAtLeastCustomFee;
+extern int nJoinSplitThreads;
 
 //! -paytxfee default
 static const CAmount DEFAULT_TRANSACTION_FEE = 0;
@@ -51,6 +52,8 @@ static const CAmount nHighTransactionFeeWarning = 0.01 * COIN;
 static const CAmount DEFAULT_TRANSACTION_MAXFEE = 0.1 * COIN;
 //! -txconfirmtarget default
 static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 2;
+//! -joinsplitthreads default
+static const int DEFAULT_JOINSPLIT_THREADS = 1;
 //! -maxtxfee will warn if called with a higher fee than this amount (in satoshis)
 static const CAmount nHighTransactionMaxFeeWarning = 100 * nHighTransactionFeeWarning;
 //! Largest (in bytes) free transaction we're willing to create
@@ -59,6 +62,13 @@ static const unsigned int MAX_FREE_TRANSACTION_CREATE_SIZE = 1000;
 //  Should be large enough that we can expect not to reorg beyond our cache
 //  unless there is some exceptional network disruption.
 static const unsigned int WITNESS_CACHE_SIZE = COINBASE_MATURITY;
+//! Number of wallet addresses tried by one note decryption job
+static const unsigned int NOTE_DECRYPTION_BATCH_ADDRESSES = 64;
+//! Number of blocks a wallet rescan reads and decrypts ahead of the wallet commit
+static const unsigned int RESCAN_READ_AHEAD_BLOCKS = 16;
+
+/** Run an instance of the note trial decryption thread */
+void ThreadNoteDecryption();
 
 class CAccountingEntry;
 class CBlockIndex;
@@ -575,6 +585,28 @@ public:
 };
 
 
+/** Progress of a running CWallet::ScanForWalletTransactions */
+struct CRescanProgress
+{
+    int nStartHeight;
+    //! Height of the last block committed to the wallet
+    int nHeight;
+    int nTipHeight;
+    //! Number of blocks committed so far
+    int nBlocks;
+    int64_t nStartTime;
+    /**
+     * Height up to which the note witnesses of the wallet have been
+     * incremented, by the rescan or by ChainTip before it started.
+     */
+    int nWitnessHeight;
+
+    CRescanProgress() : nStartHeight(0), nHeight(0), nTipHeight(0), nBlocks(0), nStartTime(0), nWitnessHeight(0) {}
+
+    double Progress() const;
+    double BlocksPerSecond() const;
+};
+
 
 /** 
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
@@ -628,6 +660,14 @@ public:
     void ClearNoteWitnessCache();
 
 protected:
+    //! Serializes calls to ScanForWalletTransactions
+    CCriticalSection cs_rescan;
+    //! Whether ScanForWalletTransactions is running, see ChainTip
+    bool fRescanning;
+    //! Whether SetBestChain was skipped while rescanning
+    bool fRescanBestChainPending;
+    CRescanProgress rescanProgress;
+
     /**
      * pindex is the new tip being connected.
      */
@@ -739,6 +779,8 @@ public:
         nTimeFirstKey = 0;
         fBroadcastTransactions = false;
         nWitnessCacheSize = 0;
+        fRescanning = false;
+        fRescanBestChainPending = false;
     }
 
     /**
@@ -900,13 +942,14 @@ public:
     void UpdateNullifierNoteMapWithTx(const CWalletTx& wtx);
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb);
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
-    bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
+    bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, const mapNoteData_t* pnoteData = NULL);
     void EraseFromWallet(const uint256 &hash);
     void WitnessNoteCommitment(
          std::vector<uint256> commitments,
          std::vector<boost::optional<ZCIncrementalWitness>>& witnesses,
          uint256 &final_anchor);
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
+    bool GetRescanProgress(CRescanProgress& progress) const;
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime);
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime);
@@ -945,6 +988,8 @@ public:
         const uint256& hSig,
         uint8_t n) const;
     mapNoteData_t FindMyNotes(const CTransaction& tx) const;
+    std::vector<mapNoteData_t> FindMyNotes(const std::vector<CTransaction>& vtx) const;
+    std::vector<mapNoteData_t> FindMyNotes(const std::vector<const CTransaction*>& vtx) const;
     bool IsFromMe(const uint256& nullifier) const;
     void GetNoteWitnesses(
          std::vector<JSOutPoint> notes,
@@ -198,7 +198,8 @@ public:
         uint64_t vpub_old,
         uint64_t vpub_new,
         const uint256& rt,
-        bool computeProof
+        bool computeProof,
+        uint252* out_phi
     ) {
         if (computeProof && !pk) {
             throw std::runtime_error("JoinSplit proving key not loaded");
@@ -260,6 +261,9 @@ public:
 
         // Sample phi
         uint252 phi = random_uint252();
+        if (out_phi) {
+            *out_phi = phi;
+        }
 
         // Compute notes for outputs
         for (size_t i = 0; i < NumOutputs; i++) {
@@ -316,6 +320,22 @@ public:
             return ZCProof();
         }
 
+        return proveDeferred(inputs, out_notes, phi, h_sig, vpub_old, vpub_new, rt);
+    }
+
+    ZCProof proveDeferred(
+        const boost::array<JSInput, NumInputs>& inputs,
+        const boost::array<Note, NumOutputs>& out_notes,
+        const uint252& phi,
+        const uint256& h_sig,
+        uint64_t vpub_old,
+        uint64_t vpub_new,
+        const uint256& rt
+    ) {
+        if (!pk) {
+            throw std::runtime_error("JoinSplit proving key not loaded");
+        }
+
         protoboard<FieldT> pb;
         {
             joinsplit_gadget<FieldT, NumInputs, NumOutputs> g(pb);
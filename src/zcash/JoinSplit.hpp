@@ -78,7 +78,20 @@ public:
         uint64_t vpub_old,
         uint64_t vpub_new,
         const uint256& rt,
-        bool computeProof = true
+        bool computeProof = true,
+        uint252* out_phi = nullptr
+    ) = 0;
+
+    // Computes the proof of a JoinSplit that prove() set up with computeProof
+    // false, from its inputs, its output notes and the phi it sampled.
+    virtual ZCProof proveDeferred(
+        const boost::array<JSInput, NumInputs>& inputs,
+        const boost::array<Note, NumOutputs>& notes,
+        const uint252& phi,
+        const uint256& h_sig,
+        uint64_t vpub_old,
+        uint64_t vpub_new,
+        const uint256& rt
     ) = 0;
 
     virtual bool verify(
@@ -113,26 +113,56 @@ typename NoteDecryption<MLEN>::Plaintext NoteDecryption<MLEN>::decrypt
         throw std::logic_error("Could not create DH secret");
     }
 
+    NoteDecryption<MLEN>::Plaintext plaintext;
+
+    if (!open(plaintext, ciphertext, dhsecret, epk, hSig, nonce)) {
+        throw note_decryption_failed();
+    }
+
+    return plaintext;
+}
+
+template<size_t MLEN>
+bool NoteDecryption<MLEN>::try_decrypt
+                           (const NoteDecryption<MLEN>::Ciphertext &ciphertext,
+                            const uint256 &epk,
+                            const uint256 &hSig,
+                            unsigned char nonce,
+                            NoteDecryption<MLEN>::Plaintext &plaintext
+                           ) const
+{
+    uint256 dhsecret;
+
+    if (crypto_scalarmult(dhsecret.begin(), sk_enc.begin(), epk.begin()) != 0) {
+        return false;
+    }
+
+    return open(plaintext, ciphertext, dhsecret, epk, hSig, nonce);
+}
+
+template<size_t MLEN>
+bool NoteDecryption<MLEN>::open(NoteDecryption<MLEN>::Plaintext &plaintext,
+                                const NoteDecryption<MLEN>::Ciphertext &ciphertext,
+                                const uint256 &dhsecret,
+                                const uint256 &epk,
+                                const uint256 &hSig,
+                                unsigned char nonce
+                               ) const
+{
     unsigned char K[NOTEENCRYPTION_CIPHER_KEYSIZE];
     KDF(K, dhsecret, epk, pk_enc, hSig, nonce);
 
     // The nonce is zero because we never reuse keys
     unsigned char cipher_nonce[crypto_aead_chacha20poly1305_IETF_NPUBBYTES] = {};
 
-    NoteDecryption<MLEN>::Plaintext plaintext;
-
     // Message length is always NOTEENCRYPTION_AUTH_BYTES less than
     // the ciphertext length.
-    if (crypto_aead_chacha20poly1305_ietf_decrypt(plaintext.begin(), NULL,
-                                             NULL,
-                                             ciphertext.begin(), NoteDecryption<MLEN>::CLEN,
-                                             NULL,
-                                             0,
-                                             cipher_nonce, K) != 0) {
-        throw note_decryption_failed();
-    }
-
-    return plaintext;
+    return crypto_aead_chacha20poly1305_ietf_decrypt(plaintext.begin(), NULL,
+                                                NULL,
+                                                ciphertext.begin(), NoteDecryption<MLEN>::CLEN,
+                                                NULL,
+                                                0,
+                                                cipher_nonce, K) == 0;
 }
 
 template<size_t MLEN>
@@ -61,6 +61,17 @@ public:
     typedef boost::array<unsigned char, CLEN> Ciphertext;
     typedef boost::array<unsigned char, MLEN> Plaintext;
 
+private:
+    // Derives the symmetric key from the DH secret and opens the ciphertext.
+    bool open(Plaintext &plaintext,
+              const Ciphertext &ciphertext,
+              const uint256 &dhsecret,
+              const uint256 &epk,
+              const uint256 &hSig,
+              unsigned char nonce
+             ) const;
+
+public:
     NoteDecryption() { }
     NoteDecryption(uint256 sk_enc);
 
@@ -70,6 +81,16 @@ public:
                       unsigned char nonce
                      ) const;
 
+    // Same as decrypt(), but reports a failed decryption through the
+    // return value instead of throwing note_decryption_failed. Used for
+    // trial decryption, where almost every attempt fails.
+    bool try_decrypt(const Ciphertext &ciphertext,
+                     const uint256 &epk,
+                     const uint256 &hSig,
+                     unsigned char nonce,
+                     Plaintext &plaintext
+                    ) const;
+
     friend inline bool operator==(const NoteDecryption& a, const NoteDecryption& b) {
         return a.sk_enc == b.sk_enc && a.pk_enc == b.pk_enc;
     }
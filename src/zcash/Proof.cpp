@@ -233,6 +233,17 @@ ProofVerifier ProofVerifier::Disabled() {
     return ProofVerifier(false);
 }
 
+ProofVerifier ProofVerifier::Batch() {
+    initialize_curve_params();
+    return ProofVerifier(true, true);
+}
+
+std::vector<ProofVerifier::DeferredCheck> ProofVerifier::TakeDeferredChecks() {
+    std::vector<DeferredCheck> checks;
+    checks.swap(deferred_checks);
+    return checks;
+}
+
 template<>
 bool ProofVerifier::check(
     const r1cs_ppzksnark_verification_key<curve_pp>& vk,
@@ -241,7 +252,15 @@ bool ProofVerifier::check(
     const r1cs_ppzksnark_proof<curve_pp>& proof
 )
 {
-    if (perform_verification) {
+    if (perform_verification && defer_verification) {
+        // The processed verification key is owned by the JoinSplit
+        // parameters, which outlive any verification context; the
+        // per-proof data is copied.
+        deferred_checks.push_back([&pvk, primary_input, proof]() {
+            return r1cs_ppzksnark_online_verifier_strong_IC<curve_pp>(pvk, primary_input, proof);
+        });
+        return true;
+    } else if (perform_verification) {
         return r1cs_ppzksnark_online_verifier_strong_IC<curve_pp>(pvk, primary_input, proof);
     } else {
         return true;
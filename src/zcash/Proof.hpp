@@ -4,6 +4,9 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <functional>
+#include <vector>
+
 namespace libzcash {
 
 const unsigned char G1_PREFIX_MASK = 0x02;
@@ -238,10 +241,18 @@ public:
 void initialize_curve_params();
 
 class ProofVerifier {
+public:
+    // A recorded proof verification, run later by the caller.
+    typedef std::function<bool()> DeferredCheck;
+
 private:
     bool perform_verification;
+    bool defer_verification;
+    std::vector<DeferredCheck> deferred_checks;
 
-    ProofVerifier(bool perform_verification) : perform_verification(perform_verification) { }
+    ProofVerifier(bool perform_verification, bool defer_verification = false) :
+        perform_verification(perform_verification),
+        defer_verification(defer_verification) { }
 
 public:
     // ProofVerifier should never be copied
@@ -259,6 +270,17 @@ public:
     // such as during reindexing.
     static ProofVerifier Disabled();
 
+    // Creates a verification context that records every proof
+    // instead of checking it, so that all proofs of a block can
+    // be verified together (e.g. in parallel on the check queue).
+    // check() always succeeds; the caller must run the checks
+    // returned by TakeDeferredChecks() before trusting the result.
+    static ProofVerifier Batch();
+
+    // Hands over the proof checks recorded so far, leaving the
+    // verifier empty.
+    std::vector<DeferredCheck> TakeDeferredChecks();
+
     template <typename VerificationKey,
               typename ProcessedVerificationKey,
               typename PrimaryInput,
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <future>
+#include <random>
 #include <thread>
 #include <unistd.h>
 #include <boost/filesystem.hpp>
@@ -9,11 +11,13 @@
 #include "primitives/transaction.h"
 #include "base58.h"
 #include "crypto/equihash.h"
+#include "crypto/sha256.h"
 #include "chainparams.h"
 #include "consensus/validation.h"
 #include "main.h"
 #include "miner.h"
 #include "pow.h"
+#include "random.h"
 #include "script/sign.h"
 #include "sodium.h"
 #include "streams.h"
@@ -42,6 +46,12 @@ double timer_stop(timeval &tv_start)
     return elapsed;
 }
 
+// The pay-to-pubkey-hash script of the outputs in the cache and block benchmarks
+static CScript benchmark_p2pkh_script()
+{
+    return CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0x42) << OP_EQUALVERIFY << OP_CHECKSIG;
+}
+
 double benchmark_sleep()
 {
     struct timeval tv_start;
@@ -126,6 +136,25 @@ double benchmark_verify_joinsplit(const JSDescription &joinsplit)
     return timer_stop(tv_start);
 }
 
+double benchmark_verify_block_joinsplits(const JSDescription &joinsplit, size_t nJoinSplits)
+{
+    // The proof check queue is shared with ConnectBlock, which holds cs_main
+    // while it uses it; take the lock before the timer starts, so waiting
+    // for a block being connected is not measured.
+    LOCK(cs_main);
+    uint256 pubKeyHash;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    // Same path as ConnectBlock: collect every proof of the "block",
+    // then verify them together on the proof check queue.
+    auto verifier = libzcash::ProofVerifier::Batch();
+    for (size_t i = 0; i < nJoinSplits; i++) {
+        joinsplit.Verify(*pzcashParams, verifier, pubKeyHash);
+    }
+    CheckDeferredProofs(verifier);
+    return timer_stop(tv_start);
+}
+
 #ifdef ENABLE_MINING
 double benchmark_solve_equihash()
 {
@@ -187,6 +216,88 @@ double benchmark_verify_equihash()
     return timer_stop(tv_start);
 }
 
+double benchmark_sha256(bool fBatch)
+{
+    // 64-byte blobs, as found in merkle and note commitment trees
+    std::vector<unsigned char> in(1 << 20), out(in.size() / 2);
+    randombytes_buf(in.data(), in.size());
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    CSHA256 hasher;
+    for (size_t nBytes = 0; nBytes < SHA256_BENCHMARK_BYTES; nBytes += in.size()) {
+        if (fBatch) {
+            SHA256D64(out.data(), in.data(), in.size() / 64);
+        } else {
+            hasher.Write(in.data(), in.size());
+        }
+    }
+    if (!fBatch) {
+        hasher.Finalize(out.data());
+    }
+    return timer_stop(tv_start);
+}
+
+double benchmark_coins_cache(size_t nEntries, size_t& nMemoryUsage)
+{
+    CCoinsView base;
+    CCoinsViewCache cache(&base);
+
+    // Transactions with two P2PKH outputs
+    std::vector<uint256> txids(nEntries);
+    randombytes_buf(txids.data(), txids.size() * sizeof(uint256));
+    CScript script = benchmark_p2pkh_script();
+    for (const uint256& txid : txids) {
+        CCoinsModifier coins = cache.ModifyCoins(txid);
+        coins->nVersion = 1;
+        coins->nHeight = 1;
+        coins->vout.resize(2, CTxOut(1000, script));
+    }
+    nMemoryUsage = cache.DynamicMemoryUsage();
+
+    // Look up and spend an output of each, in random order, as ConnectBlock
+    // does with the inputs of a block
+    std::shuffle(txids.begin(), txids.end(), std::mt19937(42));
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (const uint256& txid : txids) {
+        const CCoins* coins = cache.AccessCoins(txid);
+        assert(coins && coins->IsAvailable(0));
+        cache.ModifyCoins(txid)->Spend(0);
+    }
+    return timer_stop(tv_start);
+}
+
+double benchmark_parse_block(size_t nTxs, size_t nJoinSplits)
+{
+    // A block of distinct transactions, each spending one input to two
+    // P2PKH outputs and carrying nJoinSplits (empty) JoinSplits
+    CBlock block;
+    CScript script = benchmark_p2pkh_script();
+    for (size_t i = 0; i < nTxs; i++) {
+        CMutableTransaction mtx;
+        mtx.nVersion = 2;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 0x30) << std::vector<unsigned char>(33, 0x02);
+        mtx.vout.resize(2, CTxOut(1000, script));
+        mtx.vjoinsplit.resize(nJoinSplits);
+        block.vtx.push_back(mtx);
+    }
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+
+    // Same work as ProcessMessage and ReadBlockFromDisk, then CheckBlock
+    struct timeval tv_start;
+    timer_start(tv_start);
+    CBlock parsed;
+    ss >> parsed;
+    parsed.BuildMerkleTree(NULL, HashMerkleLevel);
+    double ret = timer_stop(tv_start);
+    assert(parsed.vtx.back().GetHash() == block.vtx.back().GetHash());
+    return ret;
+}
+
 double benchmark_large_tx()
 {
     // Number of inputs in the spending transaction that we will simulate
@@ -266,6 +377,26 @@ double benchmark_try_decrypt_notes(size_t nAddrs)
     return timer_stop(tv_start);
 }
 
+double benchmark_try_decrypt_block_notes(size_t nAddrs, size_t nTxs)
+{
+    CWallet wallet;
+    for (int i = 0; i < nAddrs; i++) {
+        auto sk = libzcash::SpendingKey::random();
+        wallet.AddSpendingKey(sk);
+    }
+
+    std::vector<CTransaction> vtx;
+    for (int i = 0; i < nTxs; i++) {
+        auto sk = libzcash::SpendingKey::random();
+        vtx.push_back(GetValidReceive(*pzcashParams, sk, 10, true));
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    auto vnd = wallet.FindMyNotes(vtx);
+    return timer_stop(tv_start);
+}
+
 double benchmark_increment_note_witnesses(size_t nTxs)
 {
     CWallet wallet;
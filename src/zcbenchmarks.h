@@ -11,9 +11,17 @@ extern std::vector<double> benchmark_create_joinsplit_threaded(int nThreads);
 extern double benchmark_solve_equihash();
 extern std::vector<double> benchmark_solve_equihash_threaded(int nThreads);
 extern double benchmark_verify_joinsplit(const JSDescription &joinsplit);
+extern double benchmark_verify_block_joinsplits(const JSDescription &joinsplit, size_t nJoinSplits);
 extern double benchmark_verify_equihash();
 extern double benchmark_large_tx();
+extern double benchmark_coins_cache(size_t nEntries, size_t& nMemoryUsage);
+extern double benchmark_parse_block(size_t nTxs, size_t nJoinSplits);
+
+//! Bytes hashed by each sample of benchmark_sha256
+static const size_t SHA256_BENCHMARK_BYTES = 16 << 20;
+extern double benchmark_sha256(bool fBatch);
 extern double benchmark_try_decrypt_notes(size_t nAddrs);
+extern double benchmark_try_decrypt_block_notes(size_t nAddrs, size_t nTxs);
 extern double benchmark_increment_note_witnesses(size_t nTxs);
 
 #endif